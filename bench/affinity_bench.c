@@ -0,0 +1,259 @@
+#include <gst/gst.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "camera.h"
+
+#ifdef __APPLE__
+#include <TargetConditionals.h>
+#endif
+
+// 스트리밍 스레드 CPU 고정(--cpus) 벤치마크.
+// clipper_main()과 같은 그래프의 카메라 여러 대를 videotestsrc(is-live=false) + 녹화(x264enc)로 동시에 EOS까지 돌리되,
+// 한 번은 스케줄러에 맡기고(unpinned) 한 번은 카메라마다 CPU 묶음에 고정해서(pinned) 처리량을 비교한다.
+// 실행 중에 프로세스의 스레드가 있던 CPU를 주기적으로 읽어 쓰인 CPU 수와 스레드가 CPU를 옮긴 횟수도 기록한다.
+//   affinity_bench --cameras 8
+//   affinity_bench --cameras 8 --cpus 0-7 --cpus-per-camera 1 --thread-nice 5
+
+#define DEFAULT_FRAMES 300
+#define DEFAULT_CAMERAS 4
+#define SAMPLE_INTERVAL_MS 100
+
+typedef struct _BenchRun {
+    GMainLoop* loop;
+    guint finished;
+    guint cameras;
+
+    // 스레드 배치 표본 (메인 루프 스레드)
+    GHashTable* last_cpu;           // tid → 마지막으로 본 CPU + 1
+    GHashTable* cpus_seen;          // 스레드가 한 번이라도 있었던 CPU
+    guint samples;
+    guint cpu_changes;              // 표본 사이에 스레드의 CPU가 바뀐 횟수
+} BenchRun;
+
+static void run_finished(Camera* camera, BenchRun* run) {
+    if (++run->finished == run->cameras)
+        g_main_loop_quit(run->loop);
+}
+
+// 파이프라인 로그(g_print)가 stdout의 JSON과 섞이지 않도록 stderr로 보냄
+static void print_to_stderr(const gchar* message) {
+    fputs(message, stderr);
+}
+
+static gdouble rusage_cpu_seconds(struct rusage* usage) {
+    return usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6 +
+        usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6;
+}
+
+// /proc/self/task/*/stat의 39번째 필드 (스레드가 마지막으로 실행된 CPU)
+static gboolean sample_timeout(BenchRun* run) {
+    GDir* dir = g_dir_open("/proc/self/task", 0, NULL);
+    const gchar* entry;
+
+    if (!dir)
+        return FALSE;
+    while ((entry = g_dir_read_name(dir))) {
+        gchar* path = g_strdup_printf("/proc/self/task/%s/stat", entry);
+        gchar* stat = NULL;
+
+        if (g_file_get_contents(path, &stat, NULL, NULL)) {
+            const gchar* rest = strrchr(stat, ')');
+            gchar** fields = rest ? g_strsplit(rest + 2, " ", 40) : NULL;
+
+            if (fields && g_strv_length(fields) > 36) {
+                gint tid = atoi(entry);
+                gint cpu = atoi(fields[36]);
+                gint last = GPOINTER_TO_INT(g_hash_table_lookup(run->last_cpu, GINT_TO_POINTER(tid)));
+
+                if (last > 0 && last - 1 != cpu)
+                    run->cpu_changes++;
+                g_hash_table_insert(run->last_cpu, GINT_TO_POINTER(tid), GINT_TO_POINTER(cpu + 1));
+                g_hash_table_add(run->cpus_seen, GINT_TO_POINTER(cpu + 1));
+            }
+            g_strfreev(fields);
+            g_free(stat);
+        }
+        g_free(path);
+    }
+    g_dir_close(dir);
+    run->samples++;
+    return TRUE;
+}
+
+// 카메라 cameras대를 동시에 EOS까지 돌리고 결과를 JSON 객체로 기록
+static gboolean run_cameras(ClipperConfig* config, const gchar* label, guint cameras, gint frames, GString* json) {
+    BenchRun run;
+    GPtrArray* list = g_ptr_array_new_with_free_func((GDestroyNotify)camera_free);
+    struct rusage usage_start, usage_end;
+    gint64 wall_start, wall_end;
+    gdouble wall_sec, cpu_sec;
+    guint64 total_frames = 0;
+    guint sample_id;
+    gboolean ok = TRUE;
+    guint i;
+
+    memset(&run, 0, sizeof(run));
+    run.loop = g_main_loop_new(NULL, FALSE);
+    run.cameras = cameras;
+    run.last_cpu = g_hash_table_new(NULL, NULL);
+    run.cpus_seen = g_hash_table_new(NULL, NULL);
+
+    for (i = 0; i < cameras; i++) {
+        gchar* name = g_strdup_printf("%s%u", label, i);
+        Camera* camera = camera_new(name, CAMERA_TEST_URI_PREFIX, config, (CameraFinishedFunc)run_finished, &run);
+
+        g_free(name);
+        if (!camera) {
+            ok = FALSE;
+            goto cleanup;
+        }
+        g_object_set(G_OBJECT(camera->test_source), "is-live", FALSE, "num-buffers", frames, NULL);
+        // 녹화 브랜치(x264enc)까지 흐르도록 녹화 상태로 시작
+        camera_start_recording(camera);
+        g_ptr_array_add(list, camera);
+    }
+
+    getrusage(RUSAGE_SELF, &usage_start);
+    wall_start = g_get_monotonic_time();
+    for (i = 0; i < list->len; i++) {
+        if (!camera_play(g_ptr_array_index(list, i))) {
+            ok = FALSE;
+            goto cleanup;
+        }
+    }
+    sample_id = g_timeout_add(SAMPLE_INTERVAL_MS, (GSourceFunc)sample_timeout, &run);
+    g_main_loop_run(run.loop);
+    g_source_remove(sample_id);
+    wall_end = g_get_monotonic_time();
+    getrusage(RUSAGE_SELF, &usage_end);
+
+    wall_sec = (wall_end - wall_start) / 1e6;
+    cpu_sec = rusage_cpu_seconds(&usage_end) - rusage_cpu_seconds(&usage_start);
+    for (i = 0; i < list->len; i++) {
+        guint frames_in, conversions;
+
+        camera_get_conversion_stats(g_ptr_array_index(list, i), &frames_in, &conversions);
+        total_frames += frames_in;
+    }
+    g_string_append_printf(json,
+        "{\"mode\":\"%s\",\"frames\":%" G_GUINT64_FORMAT ",\"wall_s\":%.3f,\"fps\":%.2f,\"fps_per_camera\":%.2f,"
+        "\"cpu_ms_per_frame\":%.3f,\"involuntary_switches\":%ld,\"cpus_used\":%u,\"thread_cpu_changes\":%u,\"samples\":%u,\"cameras\":[",
+        label, total_frames, wall_sec, total_frames / wall_sec, total_frames / wall_sec / cameras,
+        total_frames > 0 ? cpu_sec * 1000.0 / total_frames : 0.0,
+        usage_end.ru_nivcsw - usage_start.ru_nivcsw, g_hash_table_size(run.cpus_seen), run.cpu_changes, run.samples);
+    // 고정한 실행에서는 카메라별 배정 CPU와 EOS 직전에 살아 있던 스레드의 배치
+    for (i = 0; i < list->len; i++) {
+        Camera* camera = g_ptr_array_index(list, i);
+
+        g_string_append_printf(json, "%s{\"name\":\"%s\",\"affinity\":", i > 0 ? "," : "", camera->name);
+        if (camera->affinity)
+            affinity_pool_append_json(camera->affinity, json);
+        else
+            g_string_append(json, "null");
+        g_string_append_c(json, '}');
+    }
+    g_string_append(json, "]}");
+    g_printerr("%s: %u cameras, %" G_GUINT64_FORMAT " frames in %.2f s (%.1f fps), %u CPUs used, %u thread CPU changes\n",
+        label, cameras, total_frames, wall_sec, total_frames / wall_sec, g_hash_table_size(run.cpus_seen), run.cpu_changes);
+
+cleanup:
+    g_ptr_array_free(list, TRUE);
+    g_hash_table_destroy(run.last_cpu);
+    g_hash_table_destroy(run.cpus_seen);
+    g_main_loop_unref(run.loop);
+    return ok;
+}
+
+static int bench_main(int argc, char* argv[]) {
+    ClipperConfig config;
+    GOptionContext* context;
+    GError* error = NULL;
+    GString* json;
+    gint frames = DEFAULT_FRAMES;
+    gint cameras = DEFAULT_CAMERAS;
+    gchar* cpus = NULL;
+    gint cpus_per_camera = -1;
+    gint thread_nice = 0;
+    gint width = 1280, height = 720;
+    gboolean ok;
+    GOptionEntry entries[] = {
+        { "frames", 'n', 0, G_OPTION_ARG_INT, &frames, "Frames per camera and run", "N" },
+        { "cameras", 'c', 0, G_OPTION_ARG_INT, &cameras, "Cameras running at once", "N" },
+        { "cpus", 0, 0, G_OPTION_ARG_STRING, &cpus, "CPU list of the pinned run (default: all cores)", "LIST" },
+        { "cpus-per-camera", 0, 0, G_OPTION_ARG_INT, &cpus_per_camera, "CPUs per camera in the pinned run (default: cores / cameras, 0 = whole list)", "N" },
+        { "thread-nice", 0, 0, G_OPTION_ARG_INT, &thread_nice, "Nice value of streaming threads in the pinned run", "N" },
+        { "width", 0, 0, G_OPTION_ARG_INT, &width, "Test source width", "PX" },
+        { "height", 0, 0, G_OPTION_ARG_INT, &height, "Test source height", "PX" },
+        { NULL }
+    };
+
+    context = g_option_context_new("- streaming thread CPU pinning benchmark (unpinned vs pinned)");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+    if (frames <= 0 || cameras <= 0 || width <= 0 || height <= 0) {
+        g_printerr("Frame and camera counts and the resolution must be positive.\n");
+        return -1;
+    }
+    // 기본값: 모든 코어를 카메라 수로 나눔. --cpus만 주면 모든 카메라가 그 목록 전체를 씀
+    if (cpus_per_camera < 0)
+        cpus_per_camera = cpus ? 0 : MAX(g_get_num_processors() / cameras, 1);
+    if (!cpus)
+        cpus = g_strdup_printf("0-%d", g_get_num_processors() - 1);
+
+    g_set_print_handler(print_to_stderr);
+
+    // clipper_main()의 기본 설정과 동일, 재생 브랜치 없이 (서버 배포 조건)
+    memset(&config, 0, sizeof(config));
+    config.preroll = 0;
+    config.preroll_max_time = 10 * GST_SECOND;
+    config.preroll_max_bytes = 64 * 1024 * 1024;
+    config.record_mode = RECORD_MODE_CLIP;
+    config.fragment_duration = 1000;
+    config.output_dir = g_get_tmp_dir();
+    config.record_queue_max_bytes = 64 * 1024 * 1024;
+    config.record_queue_max_time = 2 * GST_SECOND;
+    config.headless = TRUE;
+    config.test_width = width;
+    config.test_height = height;
+
+    json = g_string_new(NULL);
+    g_string_append_printf(json,
+        "{\"benchmark\":\"affinity\",\"gstreamer\":\"%s\",\"cameras\":%d,\"cores\":%d,\"width\":%d,\"height\":%d,\"runs\":[",
+        gst_version_string(), cameras, g_get_num_processors(), width, height);
+    // 스케줄러에 맡긴 실행 → 같은 조건에서 카메라마다 CPU 묶음에 고정한 실행
+    ok = run_cameras(&config, "unpinned", (guint)cameras, frames, json);
+    if (ok && (ok = affinity_configure(cpus, (guint)cpus_per_camera, thread_nice))) {
+        g_string_append_c(json, ',');
+        ok = run_cameras(&config, "pinned", (guint)cameras, frames, json);
+        g_string_append(json, "],\"affinity\":");
+        affinity_append_json(json);
+        affinity_shutdown();
+    }
+    else {
+        g_string_append(json, "]");
+    }
+    g_string_append(json, "}\n");
+    fputs(json->str, stdout);
+    g_string_free(json, TRUE);
+    g_free(cpus);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+#if defined(__APPLE__) && TARGET_OS_MAC && !TARGET_OS_IPHONE
+    return gst_macos_main((GstMainFunc)bench_main, argc, argv, NULL);
+#else
+    return bench_main(argc, argv);
+#endif
+}
@@ -0,0 +1,462 @@
+#include <gst/gst.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "camera.h"
+
+#ifdef __APPLE__
+#include <TargetConditionals.h>
+#endif
+
+// clipper_main()과 같은 그래프를 videotestsrc(is-live=false) + fakesink(sync=false)로
+// 실시간 제약 없이 돌려서 카메라 하나가 얼마나 빨리 처리되는지 측정한다.
+
+#define DEFAULT_FRAMES 300
+#define DEFAULT_FRAME_POOL_MIN 4
+// 처음 이 비율의 프레임은 풀/캐시가 채워지는 구간으로 보고 정상 상태 할당/RSS 증가에서 제외
+#define WARMUP_DIVISOR 10
+
+typedef struct _Resolution {
+    const gchar* name;
+    gint width;
+    gint height;
+} Resolution;
+
+static const Resolution resolutions[] = {
+    { "720p", 1280, 720 },
+    { "1080p", 1920, 1080 },
+    { "4k", 3840, 2160 },
+};
+
+// --encoder-profile all 로 비교할 녹화 인코더 프로파일
+static const gchar* encoder_profiles[] = { "default", "low-latency", "throughput", "archival" };
+
+// 엘리먼트 하나의 처리 시간: sink 패드 도착 ~ 같은 스레드에서 src 패드로 push 할 때까지
+typedef struct _ElementTiming {
+    GstElement* element;
+    GThread* in_thread;
+    GstClockTime in_time;
+    guint64 buffers;
+    GstClockTime total;
+} ElementTiming;
+
+typedef struct _BenchRun {
+    GMainLoop* loop;
+    GPtrArray* timings;     // ElementTiming*
+    guint64 frames;
+    gboolean failed;
+
+    // --clip-churn: 실행 중에 클립 브랜치를 계속 붙였다 떼면서 재생 브랜치가 끊기는지 확인
+    Camera* camera;
+    guint churn_clip;       // 녹화 중인 클립 id
+    GstClockTime last_display;
+    GstClockTime max_display_gap;
+
+    // 정상 상태 구간 (워밍업 이후) 시작 시점의 할당 수 / RSS
+    guint64 warmup_frames;
+    guint steady_allocations;
+    glong steady_rss_kb;
+} BenchRun;
+
+static GstPadProbeReturn timing_sink_probe(GstPad* pad, GstPadProbeInfo* info, ElementTiming* timing) {
+    timing->in_thread = g_thread_self();
+    timing->in_time = gst_util_get_timestamp();
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn timing_src_probe(GstPad* pad, GstPadProbeInfo* info, ElementTiming* timing) {
+    // 비동기 출력(큐, aggregator)은 다른 스레드에서 push 되므로 제외
+    if (timing->in_thread == g_thread_self() && GST_CLOCK_TIME_IS_VALID(timing->in_time)) {
+        timing->total += gst_util_get_timestamp() - timing->in_time;
+        timing->buffers++;
+        timing->in_time = GST_CLOCK_TIME_NONE;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// 재생 싱크에 도착하는 프레임 사이의 최대 간격 (벽시계 기준)
+static GstPadProbeReturn display_gap_probe(GstPad* pad, GstPadProbeInfo* info, BenchRun* run) {
+    GstClockTime now = gst_util_get_timestamp();
+
+    if (GST_CLOCK_TIME_IS_VALID(run->last_display) && now - run->last_display > run->max_display_gap)
+        run->max_display_gap = now - run->last_display;
+    run->last_display = now;
+    return GST_PAD_PROBE_OK;
+}
+
+// 이전 클립을 멈추고(GOP 경계에서 닫힘) 새 클립을 시작: 겹치는 클립 2개가 계속 생겼다 사라짐
+static gboolean churn_timeout(BenchRun* run) {
+    if (run->churn_clip)
+        camera_stop_clip(run->camera, run->churn_clip);
+    run->churn_clip = camera_start_clip(run->camera, 0);
+    return G_SOURCE_CONTINUE;
+}
+
+// 현재 RSS (kB, /proc이 없으면 0)
+static glong current_rss_kb(void) {
+    gchar* statm = NULL;
+    glong pages = 0;
+
+    if (g_file_get_contents("/proc/self/statm", &statm, NULL, NULL)) {
+        sscanf(statm, "%*ld %ld", &pages);
+        g_free(statm);
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static GstPadProbeReturn frame_count_probe(GstPad* pad, GstPadProbeInfo* info, BenchRun* run) {
+    if (++run->frames == run->warmup_frames) {
+        run->steady_allocations = frame_pools_get_allocations(run->camera->frame_pools);
+        run->steady_rss_kb = current_rss_kb();
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// sink/src 정적 패드를 하나씩 가진 엘리먼트(변환/인코더/파서)에 타이밍 probe 설치
+static void attach_timing(const GValue* value, BenchRun* run) {
+    GstElement* element = g_value_get_object(value);
+    GstPad* sink_pad = gst_element_get_static_pad(element, "sink");
+    GstPad* src_pad = gst_element_get_static_pad(element, "src");
+
+    if (sink_pad && src_pad && !GST_IS_BIN(element)) {
+        ElementTiming* timing = g_new0(ElementTiming, 1);
+        timing->element = element;
+        timing->in_time = GST_CLOCK_TIME_NONE;
+        gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)timing_sink_probe, timing, NULL);
+        gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)timing_src_probe, timing, NULL);
+        g_ptr_array_add(run->timings, timing);
+    }
+    if (sink_pad)
+        gst_object_unref(sink_pad);
+    if (src_pad)
+        gst_object_unref(src_pad);
+}
+
+static void run_finished(Camera* camera, BenchRun* run) {
+    g_main_loop_quit(run->loop);
+}
+
+// 파이프라인 로그(g_print)가 stdout의 JSON과 섞이지 않도록 stderr로 보냄
+static void print_to_stderr(const gchar* message) {
+    fputs(message, stderr);
+}
+
+static gdouble rusage_cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static glong peak_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // macOS는 바이트 단위
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// 해상도 하나에 대해 파이프라인을 EOS까지 돌리고 결과를 JSON 객체로 기록
+// live가 참이면 실시간(30fps)으로 흘려서 엘리먼트별 지연(metrics)을 현실적인 조건에서 측정
+// uri가 있으면 videotestsrc 대신 그 파일/스트림을 끝까지 (해상도는 소스를 따름)
+static gboolean run_resolution(ClipperConfig* config, const Resolution* resolution, const gchar* uri, gint frames,
+    gboolean live, guint clip_churn_ms, GString* json, gdouble* cpu_ms_per_frame) {
+    BenchRun run;
+    Camera* camera;
+    GstIterator* it;
+    GstPad* tee_sink_pad;
+    gint64 wall_start, wall_end;
+    gdouble cpu_start, cpu_end, wall_sec;
+    guint converted_frames, conversions;
+    guint display_drops, record_overruns;
+    guint churn_id = 0;
+    guint steady_allocations = 0;
+    guint64 steady_frames = 0;
+    guint i;
+
+    memset(&run, 0, sizeof(run));
+    run.last_display = GST_CLOCK_TIME_NONE;
+    run.loop = g_main_loop_new(NULL, FALSE);
+    run.timings = g_ptr_array_new_with_free_func(g_free);
+    run.warmup_frames = MAX(frames / WARMUP_DIVISOR, 1);
+
+    config->test_width = resolution->width;
+    config->test_height = resolution->height;
+    camera = camera_new(resolution->name, uri ? uri : CAMERA_TEST_URI_PREFIX, config, (CameraFinishedFunc)run_finished, &run);
+    if (!camera) {
+        g_ptr_array_free(run.timings, TRUE);
+        g_main_loop_unref(run.loop);
+        return FALSE;
+    }
+
+    // 실시간 제약 제거 (live 모드에서는 카메라처럼 실시간 유지)
+    if (camera->test_source)
+        g_object_set(G_OBJECT(camera->test_source), "is-live", live, "num-buffers", frames, NULL);
+    if (camera->video_sink_display)
+        g_object_set(G_OBJECT(camera->video_sink_display), "sync", FALSE, NULL);
+
+    it = gst_bin_iterate_recurse(GST_BIN(camera->pipeline));
+    gst_iterator_foreach(it, (GstIteratorForeachFunction)attach_timing, &run);
+    gst_iterator_free(it);
+    run.camera = camera;
+    tee_sink_pad = gst_element_get_static_pad(camera->video_tee, "sink");
+    gst_pad_add_probe(tee_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)frame_count_probe, &run, NULL);
+    gst_object_unref(tee_sink_pad);
+
+    if (camera->video_sink_display) {
+        GstPad* display_pad = gst_element_get_static_pad(camera->video_sink_display, "sink");
+        gst_pad_add_probe(display_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)display_gap_probe, &run, NULL);
+        gst_object_unref(display_pad);
+    }
+
+    // 녹화 브랜치도 muxer/filesink까지 실제로 흐르도록 녹화 상태로 시작
+    if (clip_churn_ms > 0)
+        churn_id = g_timeout_add(clip_churn_ms, (GSourceFunc)churn_timeout, &run);
+    else
+        camera_start_recording(camera);
+
+    cpu_start = rusage_cpu_seconds();
+    wall_start = g_get_monotonic_time();
+    if (!camera_play(camera))
+        run.failed = TRUE;
+    else
+        g_main_loop_run(run.loop);
+    wall_end = g_get_monotonic_time();
+    cpu_end = rusage_cpu_seconds();
+    if (churn_id)
+        g_source_remove(churn_id);
+
+    wall_sec = (wall_end - wall_start) / 1e6;
+    camera_get_conversion_stats(camera, &converted_frames, &conversions);
+    camera_get_queue_stats(camera, &display_drops, &record_overruns);
+    *cpu_ms_per_frame = run.frames > 0 ? (cpu_end - cpu_start) * 1000.0 / run.frames : 0.0;
+    if (run.frames > run.warmup_frames) {
+        steady_frames = run.frames - run.warmup_frames;
+        steady_allocations = frame_pools_get_allocations(camera->frame_pools) - run.steady_allocations;
+    }
+    g_string_append_printf(json,
+        "{\"name\":\"%s\",\"encoder_profile\":\"%s\",\"width\":%d,\"height\":%d,\"frames\":%" G_GUINT64_FORMAT ","
+        "\"wall_s\":%.3f,\"fps\":%.2f,\"cpu_ms_per_frame\":%.3f,\"conversions_per_frame\":%.3f,\"peak_rss_kb\":%ld,\"ok\":%s,\"elements\":[",
+        resolution->name, config->passthrough ? "passthrough" : config->encoder_profile,
+        resolution->width, resolution->height, run.frames,
+        wall_sec, run.frames > 0 ? run.frames / wall_sec : 0.0,
+        *cpu_ms_per_frame,
+        converted_frames > 0 ? (gdouble)conversions / converted_frames : 0.0,
+        peak_rss_kb(), (run.failed || run.frames == 0) ? "false" : "true");
+    for (i = 0; i < run.timings->len; i++) {
+        ElementTiming* timing = g_ptr_array_index(run.timings, i);
+        g_string_append_printf(json,
+            "%s{\"name\":\"%s\",\"factory\":\"%s\",\"buffers\":%" G_GUINT64_FORMAT ",\"total_ms\":%.3f,\"avg_us\":%.2f}",
+            i > 0 ? "," : "", GST_ELEMENT_NAME(timing->element),
+            GST_OBJECT_NAME(gst_element_get_factory(timing->element)), timing->buffers,
+            (gdouble)timing->total / GST_MSECOND,
+            timing->buffers > 0 ? (gdouble)timing->total / GST_USECOND / timing->buffers : 0.0);
+    }
+    g_string_append(json, "]");
+    g_string_append_printf(json,
+        ",\"display_drops\":%u,\"record_overruns\":%u,\"max_display_gap_ms\":%.3f,"
+        "\"branch_adds\":%u,\"branch_add_avg_us\":%.1f,\"branch_add_max_us\":%" G_GINT64_FORMAT ","
+        "\"branch_removes\":%u,\"branch_remove_avg_us\":%.1f,\"branch_remove_max_us\":%" G_GINT64_FORMAT,
+        display_drops, record_overruns, (gdouble)run.max_display_gap / GST_MSECOND,
+        camera->branch_stats.adds,
+        camera->branch_stats.adds > 0 ? (gdouble)camera->branch_stats.add_us_total / camera->branch_stats.adds : 0.0,
+        camera->branch_stats.add_us_max,
+        camera->branch_stats.removes,
+        camera->branch_stats.removes > 0 ? (gdouble)camera->branch_stats.remove_us_total / camera->branch_stats.removes : 0.0,
+        camera->branch_stats.remove_us_max);
+    // 쓰지 않는 오디오/자막 디코더를 고르지 않은 수 (--decode-all이면 0)
+    g_string_append_printf(json, ",\"decode_all_streams\":%s,\"skipped_decoders\":%d,\"unused_buffers\":%d",
+        config->decode_all_streams ? "true" : "false", g_atomic_int_get(&camera->n_skipped_decoders),
+        g_atomic_int_get(&camera->n_unused_buffers));
+    // 시작 구간: 엘리먼트 생성 / 연결 / 프리롤 / 첫 프레임 (ms)
+    g_string_append_printf(json,
+        ",\"startup\":{\"create_ms\":%.3f,\"link_ms\":%.3f,\"preroll_ms\":%.3f,\"first_frame_ms\":%.3f}",
+        camera->startup.create_us / 1000.0, camera->startup.link_us / 1000.0, camera->startup.preroll_us / 1000.0,
+        g_atomic_int_get(&camera->startup.first_frame_us) / 1000.0);
+    // 워밍업 이후 프레임당 새 버퍼 할당과 RSS 증가 (풀을 돌려 쓰면 둘 다 0 근처)
+    g_string_append_printf(json, ",\"steady_allocs_per_frame\":%.3f,\"steady_rss_growth_kb\":%ld,\"frame_pools\":",
+        steady_frames > 0 ? (gdouble)steady_allocations / steady_frames : 0.0,
+        steady_frames > 0 ? current_rss_kb() - run.steady_rss_kb : 0);
+    frame_pools_append_json(camera->frame_pools, json);
+    if (camera->writer) {
+        // --async-writer: 쓰기/fdatasync 지연과 muxer가 미처리 바이트 상한에서 기다린 횟수 (record_overruns와 함께 봄)
+        g_string_append(json, ",\"writer\":");
+        file_writer_append_json(camera->writer, json);
+    }
+    if (camera->metrics) {
+        // 구간 지연(p50/p99): 인코더 lookahead/B-프레임으로 인한 프레임 지연은 여기서 보임
+        g_string_append(json, ",\"metrics\":");
+        metrics_append_json(camera->metrics, json);
+    }
+    g_string_append_c(json, '}');
+
+    g_printerr("%s/%s: %" G_GUINT64_FORMAT " frames in %.2f s (%.1f fps)\n",
+        resolution->name, config->passthrough ? "passthrough" : config->encoder_profile, run.frames, wall_sec, run.frames > 0 ? run.frames / wall_sec : 0.0);
+
+    camera_free(camera);
+    g_ptr_array_free(run.timings, TRUE);
+    g_main_loop_unref(run.loop);
+    return !run.failed;
+}
+
+int bench_main(int argc, char* argv[]) {
+    ClipperConfig config;
+    GOptionContext* context;
+    GError* error = NULL;
+    GString* json;
+    gint frames = DEFAULT_FRAMES;
+    gboolean passthrough = FALSE;
+    gchar* only = NULL;
+    gchar* json_path = NULL;
+    gchar* profile = NULL;
+    gboolean live = FALSE;
+    gboolean headless = FALSE;
+    gint clip_churn_ms = 0;
+    gint frame_pool_min = DEFAULT_FRAME_POOL_MIN;
+    gchar* uri = NULL;
+    gboolean async_writer = FALSE;
+    gint writer_sync_ms = 0;
+    gdouble cpu_ms_per_frame[2] = { 0, 0 };
+    gboolean ok = TRUE;
+    gboolean first = TRUE;
+    guint i, j;
+    GOptionEntry entries[] = {
+        { "frames", 'n', 0, G_OPTION_ARG_INT, &frames, "Frames per resolution", "N" },
+        { "passthrough", 0, 0, G_OPTION_ARG_NONE, &passthrough, "Benchmark the passthrough (no re-encode) graph", NULL },
+        { "resolution", 'r', 0, G_OPTION_ARG_STRING, &only, "Run only one resolution (720p, 1080p, 4k)", "NAME" },
+        { "encoder-profile", 'e', 0, G_OPTION_ARG_STRING, &profile, "Record encoder profile to measure, or 'all' to compare every profile", "PROFILE" },
+        { "live", 0, 0, G_OPTION_ARG_NONE, &live, "Run the source in real time and record per-hop latency (metrics probes)", NULL },
+        { "headless", 0, 0, G_OPTION_ARG_NONE, &headless, "Benchmark without the display branch", NULL },
+        { "clip-churn", 0, 0, G_OPTION_ARG_INT, &clip_churn_ms, "Start a new overlapping clip every MS milliseconds (branch add/remove under load)", "MS" },
+        { "frame-pool", 0, 0, G_OPTION_ARG_INT, &frame_pool_min, "Preallocated frames per proposed buffer pool (0 = only count allocations)", "N" },
+        { "uri", 'u', 0, G_OPTION_ARG_STRING, &uri, "Run a recorded file/stream instead of videotestsrc, once without and once with decoding unused streams", "URI" },
+        { "async-writer", 0, 0, G_OPTION_ARG_NONE, &async_writer, "Record through the batched writer thread instead of filesink", NULL },
+        { "writer-sync-ms", 0, 0, G_OPTION_ARG_INT, &writer_sync_ms, "Async writer: fdatasync every N ms (0 = never)", "MS" },
+        { "json", 'j', 0, G_OPTION_ARG_FILENAME, &json_path, "Write JSON results to FILE instead of stdout", "FILE" },
+        { NULL }
+    };
+
+    context = g_option_context_new("- clipper pipeline throughput benchmark");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+    if (frames <= 0) {
+        g_printerr("Frame count must be positive.\n");
+        return -1;
+    }
+    if (frame_pool_min < 0) {
+        g_printerr("Frame pool size must not be negative.\n");
+        return -1;
+    }
+    if (writer_sync_ms < 0) {
+        g_printerr("Writer sync interval must not be negative.\n");
+        return -1;
+    }
+    if (clip_churn_ms < 0) {
+        g_printerr("Clip churn interval must not be negative.\n");
+        return -1;
+    }
+    if (profile && g_strcmp0(profile, "all") != 0 && !camera_encoder_profile_is_valid(profile)) {
+        g_printerr("Unknown encoder profile '%s'.\n", profile);
+        return -1;
+    }
+
+    g_set_print_handler(print_to_stderr);
+
+    // clipper_main()의 기본 설정과 동일, 재생 싱크만 fakesink
+    memset(&config, 0, sizeof(config));
+    config.passthrough = passthrough;
+    config.preroll = 0;
+    config.preroll_max_time = 10 * GST_SECOND;
+    config.preroll_max_bytes = 64 * 1024 * 1024;
+    config.record_mode = RECORD_MODE_CLIP;
+    config.fragment_duration = 1000;
+    config.output_dir = g_get_tmp_dir();
+    config.display_sink = "fakesink";
+    config.display_queue_max_bytes = 16 * 1024 * 1024;
+    config.display_queue_max_time = 500 * GST_MSECOND;
+    config.record_queue_max_bytes = 64 * 1024 * 1024;
+    config.record_queue_max_time = 2 * GST_SECOND;
+    config.metrics = live;
+    config.headless = headless;
+    config.frame_pool_min = (guint)frame_pool_min;
+    // main_app의 기본값과 동일 (1 MiB 쓰기, 카메라당 32 MiB)
+    config.async_writer = async_writer;
+    config.writer_chunk_bytes = 1024 * 1024;
+    config.writer_max_inflight = 32 * 1024 * 1024;
+    config.writer_sync_interval = (GstClockTime)writer_sync_ms * GST_MSECOND;
+
+    json = g_string_new(NULL);
+    g_string_append_printf(json, "{\"benchmark\":\"clipper\",\"gstreamer\":\"%s\",\"passthrough\":%s,\"live\":%s,\"headless\":%s,\"async_writer\":%s,\"runs\":[",
+        gst_version_string(), passthrough ? "true" : "false", live ? "true" : "false", headless ? "true" : "false",
+        async_writer ? "true" : "false");
+    for (j = 0; j < G_N_ELEMENTS(encoder_profiles); j++) {
+        // passthrough 모드에는 녹화 인코더가 없으므로 한 번만 실행
+        if (passthrough || !profile ? j > 0 : (g_strcmp0(profile, "all") != 0 && g_strcmp0(profile, encoder_profiles[j]) != 0))
+            continue;
+        config.encoder_profile = encoder_profiles[j];
+        if (uri) {
+            // 같은 소스를 두 번: 쓰지 않는 스트림을 디코딩하지 않을 때 / 모두 디코딩할 때(이전 동작)
+            static const Resolution source = { "uri", 0, 0 };
+
+            for (i = 0; i < 2; i++) {
+                config.decode_all_streams = i == 1;
+                if (!first)
+                    g_string_append_c(json, ',');
+                first = FALSE;
+                ok = run_resolution(&config, &source, uri, frames, live, (guint)clip_churn_ms, json, &cpu_ms_per_frame[i]) && ok;
+            }
+            continue;
+        }
+        for (i = 0; i < G_N_ELEMENTS(resolutions); i++) {
+            if (only && g_ascii_strcasecmp(only, resolutions[i].name) != 0)
+                continue;
+            if (!first)
+                g_string_append_c(json, ',');
+            first = FALSE;
+            ok = run_resolution(&config, &resolutions[i], NULL, frames, live, (guint)clip_churn_ms, json, &cpu_ms_per_frame[0]) && ok;
+        }
+    }
+    g_string_append(json, "]");
+    // --uri: 쓰지 않는 스트림을 디코딩하지 않아 줄어든 프레임당 CPU (마지막 프로파일 기준)
+    if (uri)
+        g_string_append_printf(json, ",\"decoder_cpu_saved_ms_per_frame\":%.3f", cpu_ms_per_frame[1] - cpu_ms_per_frame[0]);
+    g_string_append(json, "}\n");
+
+    if (json_path) {
+        if (!g_file_set_contents(json_path, json->str, json->len, &error)) {
+            g_printerr("Could not write %s: %s\n", json_path, error->message);
+            g_error_free(error);
+            ok = FALSE;
+        }
+    }
+    else {
+        fputs(json->str, stdout);
+    }
+
+    g_string_free(json, TRUE);
+    g_free(only);
+    g_free(profile);
+    g_free(uri);
+    g_free(json_path);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+#if defined(__APPLE__) && TARGET_OS_MAC && !TARGET_OS_IPHONE
+    return gst_macos_main((GstMainFunc)bench_main, argc, argv, NULL);
+#else
+    return bench_main(argc, argv);
+#endif
+}
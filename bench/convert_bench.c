@@ -0,0 +1,219 @@
+#include <gst/gst.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "workers.h"
+
+#ifdef __APPLE__
+#include <TargetConditionals.h>
+#endif
+
+// videoconvert / videoscale의 n-threads 확장성 벤치마크.
+// 4K I420 → BGRx 변환(또는 4K → 1080p 축소)을 n-threads 1, 2, 4, ... N으로 돌려서
+// 프레임당 처리 시간과 1스레드 대비 속도 향상을 JSON으로 출력한다.
+//   convert_bench --max-threads 16
+//   convert_bench --element videoscale --max-threads 8
+//   convert_bench --cameras 8 --max-threads 8            카메라 8대가 workers 예산을 나눠 씀
+//   convert_bench --cameras 8 --max-threads 8 --no-budget 예산 없이 카메라마다 8스레드 (과다 구독 비교)
+
+#define DEFAULT_FRAMES 120
+#define DEFAULT_MAX_THREADS 8
+
+typedef struct _ConvertTiming {
+    GThread* in_thread;
+    GstClockTime in_time;
+    guint64 frames;
+    GstClockTime total;
+} ConvertTiming;
+
+static GstPadProbeReturn timing_sink_probe(GstPad* pad, GstPadProbeInfo* info, ConvertTiming* timing) {
+    timing->in_thread = g_thread_self();
+    timing->in_time = gst_util_get_timestamp();
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn timing_src_probe(GstPad* pad, GstPadProbeInfo* info, ConvertTiming* timing) {
+    if (timing->in_thread == g_thread_self() && GST_CLOCK_TIME_IS_VALID(timing->in_time)) {
+        timing->total += gst_util_get_timestamp() - timing->in_time;
+        timing->frames++;
+        timing->in_time = GST_CLOCK_TIME_NONE;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+static void attach_timing(GstElement* element, ConvertTiming* timing) {
+    GstPad* sink_pad = gst_element_get_static_pad(element, "sink");
+    GstPad* src_pad = gst_element_get_static_pad(element, "src");
+
+    timing->in_time = GST_CLOCK_TIME_NONE;
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)timing_sink_probe, timing, NULL);
+    gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)timing_src_probe, timing, NULL);
+    gst_object_unref(sink_pad);
+    gst_object_unref(src_pad);
+}
+
+// 카메라 수만큼 독립된 브랜치 (소스 생성은 큐 뒤의 변환과 다른 스레드에서)
+static gchar* build_description(const gchar* element, guint cameras, gint frames) {
+    GString* description = g_string_new(NULL);
+    guint i;
+
+    for (i = 0; i < cameras; i++) {
+        g_string_append_printf(description,
+            "videotestsrc num-buffers=%d ! video/x-raw,format=I420,width=3840,height=2160,framerate=30/1 ! queue max-size-buffers=4 ! ",
+            frames);
+        if (g_strcmp0(element, "videoscale") == 0)
+            g_string_append_printf(description, "videoscale name=work%u ! video/x-raw,width=1920,height=1080 ! ", i);
+        else
+            g_string_append_printf(description, "videoconvert name=work%u ! video/x-raw,format=BGRx ! ", i);
+        g_string_append(description, "fakesink sync=false ");
+    }
+    return g_string_free(description, FALSE);
+}
+
+// threads개를 원하는 카메라 cameras대를 EOS까지 돌리고 결과를 JSON 객체로 기록
+static gboolean run_threads(const gchar* element, guint cameras, gint frames, guint threads, gboolean budget,
+    gdouble* base_ms, GString* json) {
+    gchar* description = build_description(element, cameras, frames);
+    ConvertTiming* timings = g_new0(ConvertTiming, cameras);
+    GError* error = NULL;
+    GstElement* pipeline;
+    GstBus* bus;
+    GstMessage* msg;
+    gint64 wall_start, wall_end;
+    GstClockTime total = 0;
+    guint64 total_frames = 0;
+    guint granted = 0;
+    gdouble ms;
+    gboolean ok;
+    guint i;
+
+    pipeline = gst_parse_launch(description, &error);
+    g_free(description);
+    if (!pipeline) {
+        g_printerr("Could not build the %s pipeline: %s\n", element, error->message);
+        g_error_free(error);
+        g_free(timings);
+        return FALSE;
+    }
+    for (i = 0; i < cameras; i++) {
+        gchar* name = g_strdup_printf("work%u", i);
+        GstElement* work = gst_bin_get_by_name(GST_BIN(pipeline), name);
+        guint n = budget ? workers_acquire(threads) : threads;
+
+        g_object_set(G_OBJECT(work), "n-threads", n, NULL);
+        granted += n;
+        attach_timing(work, &timings[i]);
+        gst_object_unref(work);
+        g_free(name);
+    }
+
+    wall_start = g_get_monotonic_time();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    bus = gst_element_get_bus(pipeline);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    wall_end = g_get_monotonic_time();
+    ok = GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+    if (!ok) {
+        GError* err;
+        gst_message_parse_error(msg, &err, NULL);
+        g_printerr("Error from %s: %s\n", GST_OBJECT_NAME(msg->src), err->message);
+        g_error_free(err);
+    }
+    gst_message_unref(msg);
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    if (budget)
+        workers_release(granted - cameras);
+
+    for (i = 0; i < cameras; i++) {
+        total += timings[i].total;
+        total_frames += timings[i].frames;
+    }
+    ms = total_frames > 0 ? (gdouble)total / GST_MSECOND / total_frames : 0.0;
+    if (*base_ms == 0)
+        *base_ms = ms;
+    g_string_append_printf(json,
+        "{\"threads\":%u,\"granted_threads\":%u,\"frames\":%" G_GUINT64_FORMAT ",\"wall_s\":%.3f,\"fps\":%.2f,"
+        "\"ms_per_frame\":%.3f,\"speedup\":%.2f}",
+        threads, granted, total_frames, (wall_end - wall_start) / 1e6,
+        wall_end > wall_start ? total_frames * 1e6 / (wall_end - wall_start) : 0.0,
+        ms, ms > 0 ? *base_ms / ms : 0.0);
+    g_printerr("%s x%u, %u threads: %.3f ms/frame\n", element, cameras, threads, ms);
+    g_free(timings);
+    return ok;
+}
+
+static int bench_main(int argc, char* argv[]) {
+    GOptionContext* context;
+    GError* error = NULL;
+    GString* json;
+    gchar* element = NULL;
+    gint frames = DEFAULT_FRAMES;
+    gint max_threads = DEFAULT_MAX_THREADS;
+    gint cameras = 1;
+    gint worker_limit = 0;
+    gboolean no_budget = FALSE;
+    gdouble base_ms = 0;
+    gboolean ok = TRUE;
+    guint threads;
+    GOptionEntry entries[] = {
+        { "element", 'e', 0, G_OPTION_ARG_STRING, &element, "videoconvert (4K I420 to BGRx, default) or videoscale (4K to 1080p)", "NAME" },
+        { "frames", 'n', 0, G_OPTION_ARG_INT, &frames, "Frames per camera and thread count", "N" },
+        { "max-threads", 't', 0, G_OPTION_ARG_INT, &max_threads, "Measure n-threads 1, 2, 4, ... up to N", "N" },
+        { "cameras", 'c', 0, G_OPTION_ARG_INT, &cameras, "Convert this many 4K streams at once", "N" },
+        { "worker-threads", 0, 0, G_OPTION_ARG_INT, &worker_limit, "Extra threads shared by all cameras (0 = cores - 1)", "N" },
+        { "no-budget", 0, 0, G_OPTION_ARG_NONE, &no_budget, "Give every camera the requested threads (oversubscribe)", NULL },
+        { NULL }
+    };
+
+    context = g_option_context_new("- videoconvert/videoscale n-threads scaling benchmark");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+    if (frames <= 0 || max_threads <= 0 || cameras <= 0 || worker_limit < 0) {
+        g_printerr("Frame, thread and camera counts must be positive.\n");
+        return -1;
+    }
+    if (element && g_strcmp0(element, "videoconvert") != 0 && g_strcmp0(element, "videoscale") != 0) {
+        g_printerr("Unknown element '%s' (expected 'videoconvert' or 'videoscale').\n", element);
+        g_free(element);
+        return -1;
+    }
+    workers_set_limit((guint)worker_limit);
+
+    json = g_string_new(NULL);
+    // worker_limit: 카메라들이 나눠 쓰는 추가 스레드 상한 (--no-budget이면 0 = 제한 없음)
+    g_string_append_printf(json,
+        "{\"benchmark\":\"convert\",\"gstreamer\":\"%s\",\"element\":\"%s\",\"cameras\":%d,\"cores\":%d,\"worker_limit\":%u,\"runs\":[",
+        gst_version_string(), element ? element : "videoconvert", cameras, g_get_num_processors(),
+        no_budget ? 0 : workers_get_limit());
+    // 1, 2, 4, ... 마지막은 max_threads
+    for (threads = 1; ok; threads = MIN(threads * 2, (guint)max_threads)) {
+        if (threads > 1)
+            g_string_append_c(json, ',');
+        ok = run_threads(element ? element : "videoconvert", (guint)cameras, frames, threads, !no_budget, &base_ms, json);
+        if (threads == (guint)max_threads)
+            break;
+    }
+    g_string_append(json, "]}\n");
+    fputs(json->str, stdout);
+    g_string_free(json, TRUE);
+    g_free(element);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+#if defined(__APPLE__) && TARGET_OS_MAC && !TARGET_OS_IPHONE
+    return gst_macos_main((GstMainFunc)bench_main, argc, argv, NULL);
+#else
+    return bench_main(argc, argv);
+#endif
+}
@@ -0,0 +1,213 @@
+#include <gst/gst.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "camera.h"
+
+#ifdef __APPLE__
+#include <TargetConditionals.h>
+#endif
+
+// 움직임 감지 프레임 차분 커널 벤치마크.
+//   motion_bench                 스칼라 / SIMD 커널 속도 비교 (같은 결과인지 확인)
+//   motion_bench --pipeline 10   test:ball, test:black 카메라를 --motion으로 10초 돌려서
+//                                ball은 움직임을 찾고 black은 찾지 않는지 확인 (아니면 실패로 종료)
+
+#define DEFAULT_ITERATIONS 2000
+#define PIXEL_THRESHOLD 25
+// --pipeline 모드의 테스트 소스 크기와 움직임 면적 (분석 해상도 160x90에서 ball 반지름이 약 10픽셀)
+#define PIPELINE_WIDTH 320
+#define PIPELINE_HEIGHT 180
+#define PIPELINE_MIN_AREA 0.005
+
+typedef struct _FrameSize {
+    const gchar* name;
+    gint width;
+    gint height;
+} FrameSize;
+
+static const FrameSize frame_sizes[] = {
+    { "160x90", 160, 90 },
+    { "640x360", 640, 360 },
+    { "1080p", 1920, 1080 },
+};
+
+typedef guint32 (*CountFunc)(const guint8* a, const guint8* b, gsize n, guint8 threshold);
+
+// 결과가 최적화로 사라지지 않도록 합계를 돌려줌
+static gdouble time_kernel(CountFunc func, const guint8* a, const guint8* b, gsize n, gint iterations, guint64* sum) {
+    gint64 start = g_get_monotonic_time();
+    gint i;
+
+    for (i = 0; i < iterations; i++)
+        *sum += func(a, b, n, PIXEL_THRESHOLD);
+    return (g_get_monotonic_time() - start) * 1000.0 / iterations;
+}
+
+static gboolean run_kernels(gint iterations, GString* json) {
+    GRand* rand = g_rand_new_with_seed(1);
+    gboolean ok = TRUE;
+    guint i;
+
+    g_string_append_printf(json, "{\"benchmark\":\"motion\",\"kernel\":\"%s\",\"iterations\":%d,\"runs\":[",
+        motion_kernel_name(), iterations);
+    for (i = 0; i < G_N_ELEMENTS(frame_sizes); i++) {
+        gsize n = (gsize)frame_sizes[i].width * frame_sizes[i].height;
+        guint8* a = g_malloc(n);
+        guint8* b = g_malloc(n);
+        guint64 scalar_sum = 0, simd_sum = 0;
+        gdouble scalar_ns, simd_ns;
+        guint32 expected, actual;
+        gsize j;
+
+        // 노이즈 위에 일부 영역만 크게 바뀐 프레임 쌍
+        for (j = 0; j < n; j++) {
+            a[j] = (guint8)g_rand_int_range(rand, 0, 256);
+            b[j] = (guint8)CLAMP(a[j] + g_rand_int_range(rand, -8, 9), 0, 255);
+            if (j % 97 < 5)
+                b[j] = 255 - a[j];
+        }
+        expected = motion_count_changed_scalar(a, b, n, PIXEL_THRESHOLD);
+        actual = motion_count_changed(a, b, n, PIXEL_THRESHOLD);
+        if (expected != actual) {
+            g_printerr("%s: %s kernel counted %u changed pixels, scalar %u.\n",
+                frame_sizes[i].name, motion_kernel_name(), actual, expected);
+            ok = FALSE;
+        }
+        scalar_ns = time_kernel(motion_count_changed_scalar, a, b, n, iterations, &scalar_sum);
+        simd_ns = time_kernel(motion_count_changed, a, b, n, iterations, &simd_sum);
+        g_string_append_printf(json,
+            "%s{\"size\":\"%s\",\"pixels\":%" G_GSIZE_FORMAT ",\"changed\":%u,\"match\":%s,"
+            "\"scalar_ns\":%.0f,\"simd_ns\":%.0f,\"speedup\":%.2f,\"simd_gpixels_per_sec\":%.2f}",
+            i > 0 ? "," : "", frame_sizes[i].name, n, expected, expected == actual ? "true" : "false",
+            scalar_ns, simd_ns, simd_ns > 0 ? scalar_ns / simd_ns : 0.0, simd_ns > 0 ? n / simd_ns : 0.0);
+        if (scalar_sum != simd_sum)
+            ok = FALSE;
+        g_free(a);
+        g_free(b);
+    }
+    g_string_append(json, "]}\n");
+    g_rand_free(rand);
+    return ok;
+}
+
+static gboolean quit_timeout(GMainLoop* loop) {
+    g_main_loop_quit(loop);
+    return G_SOURCE_REMOVE;
+}
+
+static void camera_finished(Camera* camera, GMainLoop* loop) {
+    g_main_loop_quit(loop);
+}
+
+// 파이프라인 로그(g_print)가 stdout의 JSON과 섞이지 않도록 stderr로 보냄
+static void print_to_stderr(const gchar* message) {
+    fputs(message, stderr);
+}
+
+static gboolean run_pipeline(gint seconds, GString* json) {
+    static const gchar* uris[] = { CAMERA_TEST_URI_PREFIX "ball", CAMERA_TEST_URI_PREFIX "black" };
+    GMainLoop* loop = g_main_loop_new(NULL, FALSE);
+    Camera* cameras[G_N_ELEMENTS(uris)] = { NULL };
+    ClipperConfig config;
+    gboolean ok = TRUE;
+    guint i;
+
+    memset(&config, 0, sizeof(config));
+    config.preroll = 0;
+    config.preroll_max_time = 10 * GST_SECOND;
+    config.preroll_max_bytes = 16 * 1024 * 1024;
+    config.record_mode = RECORD_MODE_CLIP;
+    config.fragment_duration = 1000;
+    config.output_dir = g_get_tmp_dir();
+    config.headless = TRUE;
+    config.record_queue_max_bytes = 64 * 1024 * 1024;
+    config.record_queue_max_time = 2 * GST_SECOND;
+    config.test_width = PIPELINE_WIDTH;
+    config.test_height = PIPELINE_HEIGHT;
+    config.motion = TRUE;
+    config.motion_min_area = PIPELINE_MIN_AREA;
+    config.motion_hold = GST_SECOND;
+    config.motion_cpu_budget = 0.1;
+
+    for (i = 0; i < G_N_ELEMENTS(uris); i++) {
+        cameras[i] = camera_new(uris[i] + strlen(CAMERA_TEST_URI_PREFIX), uris[i], &config,
+            (CameraFinishedFunc)camera_finished, loop);
+        if (!cameras[i] || !camera_play(cameras[i])) {
+            ok = FALSE;
+            goto cleanup;
+        }
+    }
+    g_timeout_add_seconds((guint)seconds, (GSourceFunc)quit_timeout, loop);
+    g_main_loop_run(loop);
+
+    g_string_append_printf(json, "{\"benchmark\":\"motion-pipeline\",\"seconds\":%d,\"cameras\":[", seconds);
+    for (i = 0; i < G_N_ELEMENTS(uris); i++) {
+        guint frames = motion_detector_get_motion_frames(cameras[i]->motion);
+        // ball은 움직여야 하고 black은 움직임이 없어야 함
+        gboolean expected = i == 0 ? frames > 0 && cameras[i]->n_motion_events > 0 : frames == 0;
+
+        g_string_append_printf(json, "%s{\"camera\":\"%s\",\"motion_events\":%u,\"pass\":%s,\"motion\":",
+            i > 0 ? "," : "", cameras[i]->name, cameras[i]->n_motion_events, expected ? "true" : "false");
+        motion_detector_append_json(cameras[i]->motion, json);
+        g_string_append_c(json, '}');
+        if (!expected) {
+            g_printerr("[%s] Unexpected motion result: %u motion frames.\n", cameras[i]->name, frames);
+            ok = FALSE;
+        }
+    }
+    g_string_append(json, "]}\n");
+
+cleanup:
+    for (i = 0; i < G_N_ELEMENTS(uris); i++) {
+        if (cameras[i])
+            camera_free(cameras[i]);
+    }
+    g_main_loop_unref(loop);
+    return ok;
+}
+
+static int bench_main(int argc, char* argv[]) {
+    GOptionContext* context;
+    GError* error = NULL;
+    GString* json;
+    gint iterations = DEFAULT_ITERATIONS;
+    gint pipeline_sec = 0;
+    gboolean ok;
+    GOptionEntry entries[] = {
+        { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Kernel calls per frame size", "N" },
+        { "pipeline", 0, 0, G_OPTION_ARG_INT, &pipeline_sec, "Run test:ball and test:black cameras with --motion for SEC seconds instead", "SEC" },
+        { NULL }
+    };
+
+    context = g_option_context_new("- motion detection kernel benchmark");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+    if (iterations <= 0 || pipeline_sec < 0) {
+        g_printerr("Iteration count and duration must be positive.\n");
+        return -1;
+    }
+
+    g_set_print_handler(print_to_stderr);
+    json = g_string_new(NULL);
+    ok = pipeline_sec > 0 ? run_pipeline(pipeline_sec, json) : run_kernels(iterations, json);
+    fputs(json->str, stdout);
+    g_string_free(json, TRUE);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+#if defined(__APPLE__) && TARGET_OS_MAC && !TARGET_OS_IPHONE
+    return gst_macos_main((GstMainFunc)bench_main, argc, argv, NULL);
+#else
+    return bench_main(argc, argv);
+#endif
+}
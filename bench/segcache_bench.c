@@ -0,0 +1,462 @@
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segcache.h"
+
+// HLS 세그먼트 캐시(--segment-cache) 확인 + 지연 벤치마크.
+// 127.0.0.1에 원 서버(세그먼트 /segN.ts, 플레이리스트 /live.m3u8)를 띄우고 캐시 프록시를 거쳐 요청해서
+// 원 서버가 받은 요청 수와 X-Cache 헤더로 동작을 확인하고, 적중/실패 응답 시간을 JSON으로 출력한다.
+// 확인 항목: 동시 요청 합치기, 반복 요청 적중, 플레이리스트 비저장, LRU 삭제, 재시작 후 적중, 상위 프록시 전달.
+// 하나라도 틀리면 종료 코드가 0이 아니다.
+//   segcache_bench
+//   segcache_bench --clients 16 --segment-kb 2048 --origin-delay-ms 100
+
+#define DEFAULT_CLIENTS 8
+#define DEFAULT_SEGMENT_KB 512
+#define DEFAULT_ORIGIN_DELAY_MS 200
+#define CLIENT_TIMEOUT_SEC 30
+
+typedef struct _Origin {
+    GSocketService* service;
+    guint16 port;
+    gsize segment_bytes;
+    gulong delay_us;                // 세그먼트 응답 전 대기 (동시 요청이 겹치도록)
+
+    GMutex lock;
+    GHashTable* counts;             // 경로 → 받은 요청 수
+    guint proxied;                  // 절대 URL로 받은 요청 (상위 프록시로 쓰일 때)
+} Origin;
+
+typedef struct _Response {
+    gint status;
+    gchar* x_cache;
+    gsize bytes;
+    gdouble ms;
+} Response;
+
+typedef struct _ClientJob {
+    guint16 proxy_port;
+    gchar* url;
+    Response response;
+} ClientJob;
+
+static gboolean write_string(GOutputStream* output, const gchar* text) {
+    return g_output_stream_write_all(output, text, strlen(text), NULL, NULL, NULL);
+}
+
+// 원 서버: 연결 하나에 요청 하나 (Connection: close)
+static gboolean origin_run_handler(GThreadedSocketService* service, GSocketConnection* connection, GObject* source_object,
+    Origin* origin) {
+    GOutputStream* output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+    GDataInputStream* input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    gchar* line;
+    gchar** parts;
+    const gchar* path;
+    gchar* header;
+
+    g_data_input_stream_set_newline_type(input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+    line = g_data_input_stream_read_line(input, NULL, NULL, NULL);
+    parts = g_strsplit(line ? line : "", " ", 3);
+    g_free(line);
+    while ((line = g_data_input_stream_read_line(input, NULL, NULL, NULL)) && *line)
+        g_free(line);
+    g_free(line);
+    if (g_strv_length(parts) != 3) {
+        write_string(output, "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        goto done;
+    }
+
+    // 프록시 형식 (http://host:port/path)이면 경로만
+    path = parts[1];
+    g_mutex_lock(&origin->lock);
+    if (g_str_has_prefix(path, "http://")) {
+        origin->proxied++;
+        path = strchr(path + strlen("http://"), '/');
+        if (!path)
+            path = "/";
+    }
+    g_hash_table_insert(origin->counts, g_strdup(path),
+        GUINT_TO_POINTER(GPOINTER_TO_UINT(g_hash_table_lookup(origin->counts, path)) + 1));
+    g_mutex_unlock(&origin->lock);
+
+    if (g_str_has_suffix(path, ".m3u8")) {
+        const gchar* playlist = "#EXTM3U\n#EXT-X-TARGETDURATION:1\n#EXTINF:1.0,\nseg0.ts\n";
+
+        header = g_strdup_printf("HTTP/1.1 200 OK\r\nContent-Type: application/vnd.apple.mpegurl\r\n"
+            "Content-Length: %" G_GSIZE_FORMAT "\r\nConnection: close\r\n\r\n", strlen(playlist));
+        if (write_string(output, header))
+            write_string(output, playlist);
+        g_free(header);
+    }
+    else if (g_str_has_prefix(path, "/seg") && g_str_has_suffix(path, ".ts")) {
+        guint8* body = g_malloc(origin->segment_bytes);
+
+        memset(body, path[4], origin->segment_bytes);
+        g_usleep(origin->delay_us);
+        header = g_strdup_printf("HTTP/1.1 200 OK\r\nContent-Type: video/mp2t\r\nContent-Length: %" G_GSIZE_FORMAT "\r\n"
+            "Connection: close\r\n\r\n", origin->segment_bytes);
+        if (write_string(output, header))
+            g_output_stream_write_all(output, body, origin->segment_bytes, NULL, NULL, NULL);
+        g_free(header);
+        g_free(body);
+    }
+    else {
+        write_string(output, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+
+done:
+    g_strfreev(parts);
+    g_object_unref(input);
+    return TRUE;
+}
+
+static gboolean origin_start(Origin* origin, GError** error) {
+    GInetAddress* loopback = g_inet_address_new_loopback(G_SOCKET_FAMILY_IPV4);
+    GSocketAddress* address = g_inet_socket_address_new(loopback, 0);
+    GSocketAddress* bound = NULL;
+    gboolean ok;
+
+    origin->service = g_threaded_socket_service_new(64);
+    ok = g_socket_listener_add_address(G_SOCKET_LISTENER(origin->service), address,
+        G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, NULL, &bound, error);
+    g_object_unref(address);
+    g_object_unref(loopback);
+    if (!ok)
+        return FALSE;
+    origin->port = g_inet_socket_address_get_port(G_INET_SOCKET_ADDRESS(bound));
+    g_object_unref(bound);
+    g_signal_connect(origin->service, "run", G_CALLBACK(origin_run_handler), origin);
+    g_socket_service_start(origin->service);
+    return TRUE;
+}
+
+static guint origin_count(Origin* origin, const gchar* path) {
+    guint count;
+
+    g_mutex_lock(&origin->lock);
+    count = GPOINTER_TO_UINT(g_hash_table_lookup(origin->counts, path));
+    g_mutex_unlock(&origin->lock);
+    return count;
+}
+
+// 캐시 프록시를 거쳐 GET 하나 (응답 본문은 세기만 함)
+static void client_get(guint16 proxy_port, const gchar* url, Response* response) {
+    GSocketClient* client = g_socket_client_new();
+    GSocketConnection* connection;
+    GDataInputStream* input = NULL;
+    gint64 start = g_get_monotonic_time();
+    gint64 content_length = -1;
+    gchar* request;
+    gchar* line;
+    guint8 buffer[64 * 1024];
+    gssize n;
+
+    memset(response, 0, sizeof(*response));
+    g_socket_client_set_timeout(client, CLIENT_TIMEOUT_SEC);
+    connection = g_socket_client_connect_to_host(client, "127.0.0.1", proxy_port, NULL, NULL);
+    if (!connection)
+        goto done;
+    request = g_strdup_printf("GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n", url);
+    if (!write_string(g_io_stream_get_output_stream(G_IO_STREAM(connection)), request)) {
+        g_free(request);
+        goto done;
+    }
+    g_free(request);
+
+    input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    g_data_input_stream_set_newline_type(input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+    line = g_data_input_stream_read_line(input, NULL, NULL, NULL);
+    if (line && strchr(line, ' '))
+        response->status = atoi(strchr(line, ' ') + 1);
+    g_free(line);
+    while ((line = g_data_input_stream_read_line(input, NULL, NULL, NULL)) && *line) {
+        if (g_ascii_strncasecmp(line, "X-Cache: ", 9) == 0)
+            response->x_cache = g_strdup(line + 9);
+        else if (g_ascii_strncasecmp(line, "Content-Length: ", 16) == 0)
+            content_length = g_ascii_strtoll(line + 16, NULL, 10);
+        g_free(line);
+    }
+    g_free(line);
+    while ((content_length < 0 || response->bytes < (gsize)content_length) &&
+        (n = g_input_stream_read(G_INPUT_STREAM(input), buffer, sizeof(buffer), NULL, NULL)) > 0)
+        response->bytes += (gsize)n;
+
+done:
+    response->ms = (g_get_monotonic_time() - start) / 1000.0;
+    if (input)
+        g_object_unref(input);
+    if (connection)
+        g_object_unref(connection);
+    g_object_unref(client);
+}
+
+static gpointer client_thread(ClientJob* job) {
+    client_get(job->proxy_port, job->url, &job->response);
+    return NULL;
+}
+
+static guint16 cache_port(SegmentCache* cache) {
+    const gchar* uri = segment_cache_get_proxy_uri(cache);
+
+    return (guint16)atoi(strrchr(uri, ':') + 1);
+}
+
+// 캐시는 응답을 다 보낸 뒤에 색인에 넣고 지우므로, 다음 요청 전에 misses가 늘어날 때까지 기다림
+static gboolean wait_for_misses(SegmentCache* cache, guint64 expected) {
+    gint64 deadline = g_get_monotonic_time() + 5 * G_TIME_SPAN_SECOND;
+
+    for (;;) {
+        GString* json = g_string_new(NULL);
+        const gchar* field;
+        guint64 misses = 0;
+
+        segment_cache_append_json(cache, json);
+        field = strstr(json->str, "\"misses\":");
+        if (field)
+            misses = g_ascii_strtoull(field + strlen("\"misses\":"), NULL, 10);
+        g_string_free(json, TRUE);
+        if (misses >= expected)
+            return TRUE;
+        if (g_get_monotonic_time() > deadline)
+            return FALSE;
+        g_usleep(10 * 1000);
+    }
+}
+
+static gboolean is_cache(Response* response, const gchar* value) {
+    return response->status == 200 && g_strcmp0(response->x_cache, value) == 0;
+}
+
+static void add_check(GString* json, guint* failed, const gchar* name, gboolean ok, const gchar* detail) {
+    if (json->str[json->len - 1] != '[')
+        g_string_append_c(json, ',');
+    g_string_append_printf(json, "{\"name\":\"%s\",\"ok\":%s,\"detail\":\"%s\"}", name, ok ? "true" : "false", detail);
+    if (!ok) {
+        (*failed)++;
+        g_printerr("FAILED %s: %s\n", name, detail);
+    }
+}
+
+static void remove_dir(const gchar* path) {
+    GDir* dir = g_dir_open(path, 0, NULL);
+    const gchar* name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar* file = g_build_filename(path, name, NULL);
+
+            g_unlink(file);
+            g_free(file);
+        }
+        g_dir_close(dir);
+    }
+    g_rmdir(path);
+}
+
+int main(int argc, char* argv[]) {
+    GOptionContext* context;
+    GError* error = NULL;
+    Origin origin;
+    SegmentCache* cache = NULL;
+    SegmentCache* proxied_cache = NULL;
+    GString* json;
+    GString* cache_json = g_string_new(NULL);
+    gchar* dir = NULL;
+    gchar* proxied_dir = NULL;
+    gchar* upstream = NULL;
+    gchar* detail;
+    gchar* url;
+    gint clients = DEFAULT_CLIENTS;
+    gint segment_kb = DEFAULT_SEGMENT_KB;
+    gint origin_delay_ms = DEFAULT_ORIGIN_DELAY_MS;
+    gdouble miss_ms = 0, hit_ms = 0;
+    guint failed = 0;
+    guint misses, hits, i;
+    gboolean settled;
+    Response first, second;
+    ClientJob* jobs;
+    GThread** threads;
+    GOptionEntry entries[] = {
+        { "clients", 'c', 0, G_OPTION_ARG_INT, &clients, "Clients asking for the same segment at once", "N" },
+        { "segment-kb", 0, 0, G_OPTION_ARG_INT, &segment_kb, "Segment size served by the test origin", "KB" },
+        { "origin-delay-ms", 0, 0, G_OPTION_ARG_INT, &origin_delay_ms, "Origin delay before each segment response", "MS" },
+        { NULL }
+    };
+
+    context = g_option_context_new("- HLS segment cache checks against a local HTTP origin");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+    if (clients <= 1 || segment_kb <= 0 || origin_delay_ms < 0) {
+        g_printerr("Expected at least 2 clients, a positive segment size and a non-negative delay.\n");
+        return -1;
+    }
+
+    memset(&origin, 0, sizeof(origin));
+    origin.segment_bytes = (gsize)segment_kb * 1024;
+    origin.delay_us = (gulong)origin_delay_ms * 1000;
+    g_mutex_init(&origin.lock);
+    origin.counts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    dir = g_dir_make_tmp("segcache-bench-XXXXXX", &error);
+    proxied_dir = dir ? g_dir_make_tmp("segcache-bench-XXXXXX", &error) : NULL;
+    if (!proxied_dir || !origin_start(&origin, &error)) {
+        g_printerr("Could not set up the test origin: %s\n", error->message);
+        g_error_free(error);
+        failed++;
+        goto cleanup;
+    }
+    // 세그먼트 3개 크기 상한 (LRU 확인)
+    cache = segment_cache_new(dir, origin.segment_bytes * 3, NULL, &error);
+    if (!cache) {
+        g_printerr("Could not start the segment cache: %s\n", error->message);
+        g_error_free(error);
+        failed++;
+        goto cleanup;
+    }
+
+    json = g_string_new(NULL);
+    g_string_append_printf(json, "{\"benchmark\":\"segcache\",\"clients\":%d,\"segment_kb\":%d,\"origin_delay_ms\":%d,\"checks\":[",
+        clients, segment_kb, origin_delay_ms);
+
+    // 1. 같은 세그먼트 동시 요청: 원 서버는 한 번만 받고 나머지는 기다렸다가 캐시에서 읽음
+    jobs = g_new0(ClientJob, clients);
+    threads = g_new0(GThread*, clients);
+    for (i = 0; i < (guint)clients; i++) {
+        jobs[i].proxy_port = cache_port(cache);
+        jobs[i].url = g_strdup_printf("http://127.0.0.1:%u/seg0.ts", origin.port);
+        threads[i] = g_thread_new("segcache-client", (GThreadFunc)client_thread, &jobs[i]);
+    }
+    misses = hits = 0;
+    for (i = 0; i < (guint)clients; i++) {
+        g_thread_join(threads[i]);
+        if (is_cache(&jobs[i].response, "MISS") && jobs[i].response.bytes == origin.segment_bytes)
+            misses++;
+        else if (is_cache(&jobs[i].response, "HIT") && jobs[i].response.bytes == origin.segment_bytes)
+            hits++;
+        g_free(jobs[i].url);
+        g_free(jobs[i].response.x_cache);
+    }
+    g_free(threads);
+    g_free(jobs);
+    settled = wait_for_misses(cache, 1);
+    detail = g_strdup_printf("origin=%u miss=%u hit=%u", origin_count(&origin, "/seg0.ts"), misses, hits);
+    add_check(json, &failed, "coalesce", settled && origin_count(&origin, "/seg0.ts") == 1 && misses == 1 && hits == (guint)clients - 1,
+        detail);
+    g_free(detail);
+
+    // 2. 반복 요청: 처음은 원 서버, 다음은 디스크 (응답 시간 비교)
+    url = g_strdup_printf("http://127.0.0.1:%u/seg1.ts", origin.port);
+    client_get(cache_port(cache), url, &first);
+    settled = wait_for_misses(cache, 2);
+    client_get(cache_port(cache), url, &second);
+    miss_ms = first.ms;
+    hit_ms = second.ms;
+    detail = g_strdup_printf("origin=%u first=%s second=%s", origin_count(&origin, "/seg1.ts"), first.x_cache, second.x_cache);
+    add_check(json, &failed, "repeat", settled && origin_count(&origin, "/seg1.ts") == 1 && is_cache(&first, "MISS") && is_cache(&second, "HIT") &&
+        second.bytes == origin.segment_bytes, detail);
+    g_free(detail);
+    g_free(first.x_cache);
+    g_free(second.x_cache);
+    g_free(url);
+
+    // 3. 플레이리스트는 저장하지 않음
+    url = g_strdup_printf("http://127.0.0.1:%u/live.m3u8", origin.port);
+    client_get(cache_port(cache), url, &first);
+    client_get(cache_port(cache), url, &second);
+    detail = g_strdup_printf("origin=%u first=%s second=%s", origin_count(&origin, "/live.m3u8"), first.x_cache, second.x_cache);
+    add_check(json, &failed, "playlist", origin_count(&origin, "/live.m3u8") == 2 && is_cache(&first, "BYPASS") && is_cache(&second, "BYPASS"),
+        detail);
+    g_free(detail);
+    g_free(first.x_cache);
+    g_free(second.x_cache);
+    g_free(url);
+
+    // 4. LRU: 상한(세그먼트 3개)을 넘기면 가장 오래 쓰지 않은 seg2가 지워져 다시 원 서버에서 받음
+    settled = TRUE;
+    for (i = 2; i <= 5; i++) {
+        url = g_strdup_printf("http://127.0.0.1:%u/seg%u.ts", origin.port, i);
+        client_get(cache_port(cache), url, &first);
+        settled = wait_for_misses(cache, i + 1) && settled;
+        g_free(first.x_cache);
+        g_free(url);
+    }
+    url = g_strdup_printf("http://127.0.0.1:%u/seg2.ts", origin.port);
+    client_get(cache_port(cache), url, &first);
+    settled = wait_for_misses(cache, 7) && settled;
+    detail = g_strdup_printf("origin=%u again=%s", origin_count(&origin, "/seg2.ts"), first.x_cache);
+    add_check(json, &failed, "evict", settled && origin_count(&origin, "/seg2.ts") == 2 && is_cache(&first, "MISS"), detail);
+    g_free(detail);
+    g_free(first.x_cache);
+    g_free(url);
+    segment_cache_append_json(cache, cache_json);
+
+    // 5. 재시작: 디렉터리에 남은 세그먼트(seg5)는 원 서버 없이 적중
+    segment_cache_free(cache);
+    cache = segment_cache_new(dir, origin.segment_bytes * 3, NULL, &error);
+    if (!cache) {
+        g_printerr("Could not restart the segment cache: %s\n", error->message);
+        g_error_free(error);
+        failed++;
+        g_string_free(json, TRUE);
+        goto cleanup;
+    }
+    url = g_strdup_printf("http://127.0.0.1:%u/seg5.ts", origin.port);
+    client_get(cache_port(cache), url, &first);
+    detail = g_strdup_printf("origin=%u after_restart=%s", origin_count(&origin, "/seg5.ts"), first.x_cache);
+    add_check(json, &failed, "restart", origin_count(&origin, "/seg5.ts") == 1 && is_cache(&first, "HIT"), detail);
+    g_free(detail);
+    g_free(first.x_cache);
+    g_free(url);
+
+    // 6. 상위 프록시: 원 서버를 프록시로 지정하면 절대 URL 요청이 그쪽으로 감
+    upstream = g_strdup_printf("http://127.0.0.1:%u", origin.port);
+    proxied_cache = segment_cache_new(proxied_dir, origin.segment_bytes * 3, upstream, &error);
+    if (!proxied_cache) {
+        g_printerr("Could not start the segment cache with an upstream proxy: %s\n", error->message);
+        g_error_free(error);
+        failed++;
+        g_string_free(json, TRUE);
+        goto cleanup;
+    }
+    url = g_strdup_printf("http://127.0.0.1:%u/seg6.ts", origin.port);
+    client_get(cache_port(proxied_cache), url, &first);
+    detail = g_strdup_printf("proxied=%u first=%s", origin.proxied, first.x_cache);
+    add_check(json, &failed, "upstream", origin.proxied == 1 && is_cache(&first, "MISS"), detail);
+    g_free(detail);
+    g_free(first.x_cache);
+    g_free(url);
+
+    g_string_append_printf(json, "],\"miss_ms\":%.2f,\"hit_ms\":%.2f,\"cache\":%s,\"failed\":%u}\n",
+        miss_ms, hit_ms, cache_json->len > 0 ? cache_json->str : "null", failed);
+    fputs(json->str, stdout);
+    g_string_free(json, TRUE);
+
+cleanup:
+    segment_cache_free(cache);
+    segment_cache_free(proxied_cache);
+    if (origin.service) {
+        g_socket_service_stop(origin.service);
+        g_socket_listener_close(G_SOCKET_LISTENER(origin.service));
+        g_object_unref(origin.service);
+    }
+    g_hash_table_destroy(origin.counts);
+    g_mutex_clear(&origin.lock);
+    if (dir)
+        remove_dir(dir);
+    if (proxied_dir)
+        remove_dir(proxied_dir);
+    g_free(dir);
+    g_free(proxied_dir);
+    g_free(upstream);
+    g_string_free(cache_json, TRUE);
+    return failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,229 @@
+#include "abr.h"
+
+#include <string.h>
+#include <sys/resource.h>
+
+// 상한을 낮추기/올리기 전에 필요한 연속 판정 수 (올리기를 훨씬 느리게 해서 흔들리지 않게)
+#define ABR_DOWN_CHECKS 3
+#define ABR_UP_CHECKS 15
+// 상한을 바꾼 직후에는 디먹서가 다음 조각부터 새 variant를 받으므로 잠시 판정하지 않음
+#define ABR_SETTLE_CHECKS 5
+// 한 번에 상한을 절반으로, 이 아래로는 내리지 않음
+#define ABR_STEP_DOWN 0.5
+#define ABR_MIN_KBPS 150
+// 비트레이트/CPU 이동 평균 가중치 (디먹서는 조각 단위로 몰아서 내보내므로 평균이 필요)
+#define ABR_EMA_WEIGHT 0.2
+
+struct _AbrPolicy {
+    gint bytes;                     // 디먹서 출력 바이트 (스트리밍 스레드에서 증가, update에서 차감)
+    gint cap_kbps;                  // 현재 상한 (디먹서를 만드는 스레드에서도 읽음)
+    gint width;                     // tee에 들어온 해상도 (스트리밍 스레드)
+    gint height;
+    gint variant_switches;
+
+    // 이하 메인 루프 스레드에서만 사용
+    gdouble bitrate_kbps;           // 디먹서 출력 비트레이트 (이동 평균)
+    guint uncapped_kbps;            // 처음 상한을 걸 때의 비트레이트 (다시 이만큼 올리면 상한 해제)
+    guint qos_events;               // 이번 주기의 늦은 버퍼 QoS 메시지 수
+    gdouble qos_jitter_ms;
+    guint pressured;                // 연속으로 밀린 판정 수
+    guint healthy;                  // 연속으로 여유 있는 판정 수
+    guint settle;
+    guint cap_changes;
+    gdouble lag_ms;
+    gdouble cpu_percent;            // 프로세스 전체 CPU (이동 평균, 코어 하나 = 100)
+    gdouble cpu_before;             // 마지막 상한 변경 직전
+    gdouble cpu_after;              // 마지막 상한 변경 후 새 variant로 안정된 뒤
+    guint cpu_after_countdown;
+    gdouble last_cpu_sec;
+    gint64 last_update_us;
+};
+
+static gdouble process_cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// hlsdemux, hlsdemux2, dashdemux 등 ("Codec/Demuxer/Adaptive")
+static gboolean is_adaptive_demuxer(GstElement* element) {
+    GstElementFactory* factory = gst_element_get_factory(element);
+    const gchar* klass = factory ? gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS) : NULL;
+    return klass && strstr(klass, "Demuxer") && strstr(klass, "Adaptive");
+}
+
+static void apply_cap(GstElement* demux, guint kbps) {
+    GObjectClass* klass = G_OBJECT_GET_CLASS(demux);
+
+    if (g_object_class_find_property(klass, "max-bitrate")) {
+        // adaptivedemux2 계열: 이 비트레이트(bps) 이하의 variant만 고름 (0 = 제한 없음)
+        g_object_set(G_OBJECT(demux), "max-bitrate", kbps * 1000, NULL);
+    }
+    else if (g_object_class_find_property(klass, "connection-speed")) {
+        // 이전 adaptivedemux: 측정한 대역폭 대신 이 값(kbps)으로 variant를 고름 (0 = 측정값 사용)
+        g_object_set(G_OBJECT(demux), "connection-speed", kbps, NULL);
+    }
+}
+
+static void apply_cap_to_source(GstElement* source, guint kbps) {
+    GstIterator* it = gst_bin_iterate_recurse(GST_BIN(source));
+    GValue item = G_VALUE_INIT;
+    gboolean done = FALSE;
+
+    while (!done) {
+        switch (gst_iterator_next(it, &item)) {
+        case GST_ITERATOR_OK: {
+            GstElement* element = g_value_get_object(&item);
+            if (is_adaptive_demuxer(element))
+                apply_cap(element, kbps);
+            g_value_reset(&item);
+            break;
+        }
+        case GST_ITERATOR_RESYNC:
+            gst_iterator_resync(it);
+            break;
+        default:
+            done = TRUE;
+            break;
+        }
+    }
+    g_value_unset(&item);
+    gst_iterator_free(it);
+}
+
+static GstPadProbeReturn demux_bytes_probe(GstPad* pad, GstPadProbeInfo* info, AbrPolicy* abr) {
+    g_atomic_int_add(&abr->bytes, (gint)gst_buffer_get_size(GST_PAD_PROBE_INFO_BUFFER(info)));
+    return GST_PAD_PROBE_OK;
+}
+
+static void demux_pad_added_handler(GstElement* demux, GstPad* pad, AbrPolicy* abr) {
+    if (GST_PAD_IS_SRC(pad))
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)demux_bytes_probe, abr, NULL);
+}
+
+// uridecodebin이 자동으로 만든 엘리먼트 (스트리밍 스레드일 수 있음)
+static void deep_element_added_handler(GstBin* bin, GstBin* sub_bin, GstElement* element, AbrPolicy* abr) {
+    if (!is_adaptive_demuxer(element))
+        return;
+    apply_cap(element, (guint)g_atomic_int_get(&abr->cap_kbps));
+    g_signal_connect(element, "pad-added", G_CALLBACK(demux_pad_added_handler), abr);
+}
+
+AbrPolicy* abr_policy_new(void) {
+    return g_new0(AbrPolicy, 1);
+}
+
+void abr_policy_free(AbrPolicy* abr) {
+    g_free(abr);
+}
+
+void abr_policy_watch_source(AbrPolicy* abr, GstElement* source) {
+    g_signal_connect(source, "deep-element-added", G_CALLBACK(deep_element_added_handler), abr);
+}
+
+void abr_policy_add_qos(AbrPolicy* abr, GstMessage* msg) {
+    gint64 jitter;
+    gdouble proportion;
+    gint quality;
+
+    gst_message_parse_qos_values(msg, &jitter, &proportion, &quality);
+    // jitter > 0: 버퍼가 싱크에 늦게 도착함
+    if (jitter > 0) {
+        abr->qos_events++;
+        abr->qos_jitter_ms = MAX(abr->qos_jitter_ms, jitter / 1e6);
+    }
+}
+
+void abr_policy_note_resolution(AbrPolicy* abr, gint width, gint height) {
+    gint old_width = g_atomic_int_get(&abr->width);
+    gint old_height = g_atomic_int_get(&abr->height);
+
+    if (old_width == width && old_height == height)
+        return;
+    if (old_width > 0)
+        g_atomic_int_inc(&abr->variant_switches);
+    g_atomic_int_set(&abr->width, width);
+    g_atomic_int_set(&abr->height, height);
+}
+
+gboolean abr_policy_update(AbrPolicy* abr, GstElement* source, gdouble lag_ms, gboolean lagging, guint late) {
+    gint64 now = g_get_monotonic_time();
+    gdouble cpu = process_cpu_seconds();
+    gint bytes = g_atomic_int_get(&abr->bytes);
+    guint cap = (guint)g_atomic_int_get(&abr->cap_kbps);
+    guint new_cap = cap;
+    gboolean pressured;
+
+    g_atomic_int_add(&abr->bytes, -bytes);
+    if (abr->last_update_us > 0 && now > abr->last_update_us) {
+        gdouble elapsed = (now - abr->last_update_us) / 1e6;
+        gdouble kbps = bytes * 8.0 / 1000.0 / elapsed;
+        gdouble percent = (cpu - abr->last_cpu_sec) * 100.0 / elapsed;
+
+        abr->bitrate_kbps = abr->bitrate_kbps > 0 ? abr->bitrate_kbps + ABR_EMA_WEIGHT * (kbps - abr->bitrate_kbps) : kbps;
+        abr->cpu_percent = abr->cpu_percent > 0 ? abr->cpu_percent + ABR_EMA_WEIGHT * (percent - abr->cpu_percent) : percent;
+    }
+    abr->last_update_us = now;
+    abr->last_cpu_sec = cpu;
+    abr->lag_ms = MAX(lag_ms, abr->qos_jitter_ms);
+    pressured = lagging || late > 0 || abr->qos_events > 0;
+    abr->qos_events = 0;
+    abr->qos_jitter_ms = 0;
+
+    if (abr->cpu_after_countdown > 0 && --abr->cpu_after_countdown == 0)
+        abr->cpu_after = abr->cpu_percent;
+    if (abr->settle > 0) {
+        abr->settle--;
+        return FALSE;
+    }
+    if (pressured) {
+        abr->pressured++;
+        abr->healthy = 0;
+    }
+    else {
+        abr->healthy++;
+        abr->pressured = 0;
+    }
+
+    if (abr->pressured >= ABR_DOWN_CHECKS) {
+        // 상한보다 낮은 variant를 받고 있으면 실제 비트레이트에서 절반
+        guint base = cap > 0 ? MIN(cap, (guint)abr->bitrate_kbps) : (guint)abr->bitrate_kbps;
+
+        if (base == 0)
+            return FALSE; // 아직 비트레이트를 모름 (디먹서가 없거나 첫 조각 전)
+        if (cap == 0)
+            abr->uncapped_kbps = base;
+        new_cap = MAX((guint)(base * ABR_STEP_DOWN), ABR_MIN_KBPS);
+    }
+    else if (cap > 0 && abr->healthy >= ABR_UP_CHECKS) {
+        new_cap = cap * 2 >= abr->uncapped_kbps ? 0 : cap * 2;
+    }
+    if (new_cap == cap)
+        return FALSE;
+
+    g_atomic_int_set(&abr->cap_kbps, (gint)new_cap);
+    abr->pressured = 0;
+    abr->healthy = 0;
+    abr->settle = ABR_SETTLE_CHECKS;
+    abr->cap_changes++;
+    abr->cpu_before = abr->cpu_percent;
+    abr->cpu_after = 0;
+    abr->cpu_after_countdown = ABR_SETTLE_CHECKS + ABR_DOWN_CHECKS;
+    // 소스를 다시 만드는 중이면 새 디먹서가 생길 때 적용됨
+    if (source)
+        apply_cap_to_source(source, new_cap);
+    return TRUE;
+}
+
+guint abr_policy_get_cap(AbrPolicy* abr) {
+    return (guint)g_atomic_int_get(&abr->cap_kbps);
+}
+
+void abr_policy_append_json(AbrPolicy* abr, GString* json) {
+    g_string_append_printf(json,
+        "{\"cap_kbps\":%u,\"bitrate_kbps\":%.0f,\"lag_ms\":%.1f,\"cap_changes\":%u,\"variant_switches\":%d,"
+        "\"width\":%d,\"height\":%d,\"cpu_percent\":%.1f,\"cpu_before\":%.1f,\"cpu_after\":%.1f}",
+        (guint)g_atomic_int_get(&abr->cap_kbps), abr->bitrate_kbps, abr->lag_ms, abr->cap_changes,
+        g_atomic_int_get(&abr->variant_switches), g_atomic_int_get(&abr->width), g_atomic_int_get(&abr->height),
+        abr->cpu_percent, abr->cpu_before, abr->cpu_after);
+}
@@ -0,0 +1,38 @@
+#ifndef CLIPPER_ABR_H
+#define CLIPPER_ABR_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// HLS 소스의 variant 선택 상한 (카메라당 하나).
+// 디코딩/인코딩이 실시간을 따라가지 못하면(녹화 큐 적체, 재생 QoS, 재생 큐 드롭) 어댑티브 디먹서의
+// 비트레이트 상한을 낮춰 더 낮은 해상도의 variant를 고르게 하고, 충분히 오래 여유가 있으면 상한을 푼다.
+// 낮추기/올리기에 필요한 연속 판정 횟수를 달리해 variant가 오르내리며 흔들리지 않게 한다 (hysteresis).
+typedef struct _AbrPolicy AbrPolicy;
+
+AbrPolicy* abr_policy_new(void);
+void abr_policy_free(AbrPolicy* abr);
+
+// uridecodebin 안에 어댑티브 디먹서가 생기면 현재 상한을 적용하고 출력 비트레이트를 잼 (소스를 다시 만들 때마다 호출)
+void abr_policy_watch_source(AbrPolicy* abr, GstElement* source);
+
+// 재생 싱크의 QoS 메시지 (메인 루프 스레드, 버스 watch)
+void abr_policy_add_qos(AbrPolicy* abr, GstMessage* msg);
+
+// tee에 들어온 해상도 (스트리밍 스레드). 해상도가 바뀌면 variant 전환으로 집계
+void abr_policy_note_resolution(AbrPolicy* abr, gint width, gint height);
+
+// 주기적으로 호출 (메인 루프 스레드): lag_ms는 녹화 큐에 쌓인 시간, late는 이번 주기에 늦어서 버린 프레임 수.
+// 상한이 바뀌면 source의 디먹서에 적용하고 TRUE
+gboolean abr_policy_update(AbrPolicy* abr, GstElement* source, gdouble lag_ms, gboolean lagging, guint late);
+
+// 현재 상한 (kbps, 0 = 제한 없음)
+guint abr_policy_get_cap(AbrPolicy* abr);
+
+// 상태 JSON 객체: 상한, 추정 비트레이트, lag, 전환 횟수, 전환 전후 CPU
+void abr_policy_append_json(AbrPolicy* abr, GString* json);
+
+G_END_DECLS
+
+#endif // CLIPPER_ABR_H
@@ -0,0 +1,414 @@
+#ifdef __linux__
+#define _GNU_SOURCE     // cpu_set_t, pthread_setaffinity_np, sched_getcpu
+#endif
+
+#include "affinity.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 살아 있는 스트리밍 스레드 하나의 배치 (STREAM_STATUS ENTER ~ LEAVE)
+typedef struct _ThreadPlacement {
+    gchar* name;                    // "엘리먼트:패드"
+    gint tid;
+    gint enter_cpu;                 // 작업을 시작할 때 실행 중이던 CPU
+    gboolean pinned;                // 이 카메라의 풀에서 고정된 스레드
+} ThreadPlacement;
+
+// 카메라 하나의 태스크를 공용 스레드 풀에서 돌리되, 작업 전후로 CPU 묶음/nice를 바꾸는 GstTaskPool
+typedef struct _PinningTaskPool {
+    GstTaskPool parent;
+#ifdef __linux__
+    cpu_set_t cpus;
+#endif
+    gboolean pin;
+    gint pinned;                    // 고정해서 시작한 작업 수 (공용 풀 스레드에서 증가)
+    gint errors;                    // 고정/nice 실패 수
+} PinningTaskPool;
+
+typedef struct _PinningTaskPoolClass {
+    GstTaskPoolClass parent_class;
+} PinningTaskPoolClass;
+
+typedef struct _PinnedJob {
+    PinningTaskPool* pool;
+    GstTaskPoolFunction func;
+    gpointer user_data;
+} PinnedJob;
+
+struct _AffinityPool {
+    PinningTaskPool* task_pool;
+    gchar* cpus;                    // 배정된 CPU 목록 ("4,5", 고정하지 않으면 "")
+
+    GMutex lock;
+    GArray* threads;                // ThreadPlacement (버스 sync 핸들러 = 스트리밍 스레드에서 추가/삭제)
+};
+
+// 프로세스 설정 (affinity_configure 이후에는 읽기만)
+static gboolean affinity_enabled;
+static gchar* affinity_spec;
+static GArray* affinity_cpus;       // gint, 목록 순서 (중복 제거)
+static guint affinity_per_camera;
+static gint affinity_nice;
+static GstTaskPool* shared_pool;    // 모든 카메라의 태스크가 도는 스레드 (기본 GstTaskPool)
+#ifdef __linux__
+static cpu_set_t process_cpus;      // 작업이 끝나면 되돌릴 원래 마스크와 nice
+static gint process_nice;
+#endif
+// 다음 카메라에 줄 CPU 묶음 (카메라를 만드는 메인 루프 스레드에서만)
+static guint affinity_next_group;
+// 지금 스레드에서 도는 작업의 풀 (ENTER 때 고정된 스레드인지 구분)
+static GPrivate current_pool = G_PRIVATE_INIT(NULL);
+
+GType pinning_task_pool_get_type(void);
+G_DEFINE_TYPE(PinningTaskPool, pinning_task_pool, GST_TYPE_TASK_POOL)
+
+static gint current_tid(void) {
+#ifdef __linux__
+    return (gint)syscall(SYS_gettid);
+#else
+    return 0;
+#endif
+}
+
+static gint current_cpu(void) {
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+// 스레드가 마지막으로 실행된 CPU (/proc/self/task/TID/stat의 39번째 필드)
+static gint thread_last_cpu(gint tid) {
+    gchar* path = g_strdup_printf("/proc/self/task/%d/stat", tid);
+    gchar* stat = NULL;
+    gchar** fields;
+    const gchar* rest;
+    gint cpu = -1;
+
+    if (tid > 0 && g_file_get_contents(path, &stat, NULL, NULL)) {
+        // 스레드 이름(2번째 필드)에 공백이 있을 수 있으므로 마지막 ')' 다음부터 셈 (3번째 필드부터)
+        rest = strrchr(stat, ')');
+        if (rest) {
+            fields = g_strsplit(rest + 2, " ", 40);
+            if (g_strv_length(fields) > 36)
+                cpu = atoi(fields[36]);
+            g_strfreev(fields);
+        }
+        g_free(stat);
+    }
+    g_free(path);
+    return cpu;
+}
+
+static void count_error(PinningTaskPool* pool, const gchar* what, gint err) {
+    // 같은 원인이 스레드마다 반복되므로 카메라마다 처음 한 번만 출력
+    if (g_atomic_int_add(&pool->errors, 1) == 0)
+        g_printerr("Could not %s for a streaming thread: %s\n", what, g_strerror(err));
+}
+
+static void pinned_job_run(PinnedJob* job) {
+#ifdef __linux__
+    gint err;
+
+    if (job->pool->pin) {
+        err = pthread_setaffinity_np(pthread_self(), sizeof(job->pool->cpus), &job->pool->cpus);
+        if (err != 0)
+            count_error(job->pool, "set the CPU affinity", err);
+        else
+            g_atomic_int_inc(&job->pool->pinned);
+    }
+    if (affinity_nice != 0 && setpriority(PRIO_PROCESS, (id_t)current_tid(), affinity_nice) < 0)
+        count_error(job->pool, "set the nice value", errno);
+#endif
+    g_private_set(&current_pool, job->pool);
+
+    job->func(job->user_data);
+
+    g_private_set(&current_pool, NULL);
+#ifdef __linux__
+    // 공용 풀 스레드는 다른 카메라나 GLib의 다른 스레드 풀 작업에 재사용될 수 있으므로 원래대로 되돌림
+    // (nice를 올렸다면 권한 없이 내릴 수 없으므로 그 스레드는 올린 값으로 남음)
+    if (job->pool->pin)
+        pthread_setaffinity_np(pthread_self(), sizeof(process_cpus), &process_cpus);
+    if (affinity_nice != 0)
+        setpriority(PRIO_PROCESS, (id_t)current_tid(), process_nice);
+#endif
+    gst_object_unref(job->pool);
+    g_free(job);
+}
+
+// 공용 풀은 affinity_configure에서 준비해 두므로 카메라별 풀은 자기 스레드를 만들지 않음
+static void pinning_task_pool_prepare(GstTaskPool* pool, GError** error) {
+}
+
+static void pinning_task_pool_cleanup(GstTaskPool* pool) {
+}
+
+static gpointer pinning_task_pool_push(GstTaskPool* pool, GstTaskPoolFunction func, gpointer user_data, GError** error) {
+    PinnedJob* job = g_new(PinnedJob, 1);
+    GError* push_error = NULL;
+    gpointer id;
+
+    job->pool = gst_object_ref(pool);
+    job->func = func;
+    job->user_data = user_data;
+    // 기본 GstTaskPool은 성공해도 NULL 핸들을 돌려주므로 실패는 error로만 알 수 있음
+    id = gst_task_pool_push(shared_pool, (GstTaskPoolFunction)pinned_job_run, job, &push_error);
+    if (push_error) {
+        gst_object_unref(job->pool);
+        g_free(job);
+        g_propagate_error(error, push_error);
+    }
+    return id;
+}
+
+static void pinning_task_pool_join(GstTaskPool* pool, gpointer id) {
+    gst_task_pool_join(shared_pool, id);
+}
+
+static void pinning_task_pool_class_init(PinningTaskPoolClass* klass) {
+    GstTaskPoolClass* pool_class = GST_TASK_POOL_CLASS(klass);
+
+    pool_class->prepare = pinning_task_pool_prepare;
+    pool_class->cleanup = pinning_task_pool_cleanup;
+    pool_class->push = pinning_task_pool_push;
+    pool_class->join = pinning_task_pool_join;
+}
+
+static void pinning_task_pool_init(PinningTaskPool* self) {
+}
+
+// "0-7,16-23" → CPU 번호 목록 (중복 제거, 이 시스템에 있는 번호만)
+static gboolean parse_cpus(const gchar* spec, GArray* cpus) {
+#ifdef __linux__
+    gchar** parts = g_strsplit(spec, ",", -1);
+    glong max_cpu = MIN(sysconf(_SC_NPROCESSORS_CONF), CPU_SETSIZE);
+    cpu_set_t seen;
+    gboolean ok = TRUE;
+    guint i;
+
+    CPU_ZERO(&seen);
+    for (i = 0; ok && parts[i]; i++) {
+        gchar* part = g_strstrip(parts[i]);
+        gchar* end;
+        guint64 first, last, cpu;
+
+        first = last = g_ascii_strtoull(part, &end, 10);
+        ok = end != part;
+        if (ok && *end == '-') {
+            part = end + 1;
+            last = g_ascii_strtoull(part, &end, 10);
+            ok = end != part;
+        }
+        ok = ok && *end == '\0' && first <= last && last < (guint64)max_cpu;
+        for (cpu = first; ok && cpu <= last; cpu++) {
+            gint value = (gint)cpu;
+
+            if (!CPU_ISSET(value, &seen)) {
+                CPU_SET(value, &seen);
+                g_array_append_val(cpus, value);
+            }
+        }
+    }
+    g_strfreev(parts);
+    if (!ok || cpus->len == 0) {
+        g_printerr("Invalid CPU list '%s' (expected e.g. 0-7,16-23 with CPUs below %ld).\n", spec, max_cpu);
+        return FALSE;
+    }
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+gboolean affinity_configure(const gchar* cpus, guint cpus_per_camera, gint nice) {
+    GError* error = NULL;
+
+    if (!cpus && nice == 0)
+        return TRUE;
+#ifdef __linux__
+    affinity_cpus = g_array_new(FALSE, FALSE, sizeof(gint));
+    if (cpus && !parse_cpus(cpus, affinity_cpus)) {
+        g_array_free(affinity_cpus, TRUE);
+        affinity_cpus = NULL;
+        return FALSE;
+    }
+    if (cpus_per_camera > affinity_cpus->len && cpus) {
+        g_printerr("CPUs per camera (%u) is larger than the CPU list '%s' (%u CPUs).\n", cpus_per_camera, cpus, affinity_cpus->len);
+        g_array_free(affinity_cpus, TRUE);
+        affinity_cpus = NULL;
+        return FALSE;
+    }
+    pthread_getaffinity_np(pthread_self(), sizeof(process_cpus), &process_cpus);
+    errno = 0;
+    process_nice = getpriority(PRIO_PROCESS, 0);
+    if (errno != 0)
+        process_nice = 0;
+
+    shared_pool = gst_task_pool_new();
+    gst_task_pool_prepare(shared_pool, &error);
+    if (error) {
+        g_printerr("Could not prepare the streaming thread pool: %s\n", error->message);
+        g_error_free(error);
+        gst_object_unref(shared_pool);
+        shared_pool = NULL;
+        g_array_free(affinity_cpus, TRUE);
+        affinity_cpus = NULL;
+        return FALSE;
+    }
+    affinity_spec = g_strdup(cpus ? cpus : "");
+    affinity_per_camera = cpus_per_camera;
+    affinity_nice = nice;
+    affinity_enabled = TRUE;
+    return TRUE;
+#else
+    g_printerr("Streaming thread CPU pinning and priority are only supported on Linux.\n");
+    return FALSE;
+#endif
+}
+
+gboolean affinity_is_enabled(void) {
+    return affinity_enabled;
+}
+
+void affinity_shutdown(void) {
+    if (!affinity_enabled)
+        return;
+    gst_task_pool_cleanup(shared_pool);
+    gst_object_unref(shared_pool);
+    shared_pool = NULL;
+    g_array_free(affinity_cpus, TRUE);
+    affinity_cpus = NULL;
+    g_free(affinity_spec);
+    affinity_spec = NULL;
+    affinity_enabled = FALSE;
+}
+
+void affinity_append_json(GString* json) {
+    g_string_append_printf(json, "{\"cpus\":\"%s\",\"cpus_per_camera\":%u,\"nice\":%d,\"cameras\":%u}",
+        affinity_spec ? affinity_spec : "", affinity_per_camera, affinity_nice, affinity_next_group);
+}
+
+AffinityPool* affinity_pool_new(void) {
+    AffinityPool* pool;
+    GString* cpus;
+    guint count, first, i;
+
+    if (!affinity_enabled)
+        return NULL;
+    pool = g_new0(AffinityPool, 1);
+    pool->task_pool = g_object_new(pinning_task_pool_get_type(), NULL);
+    gst_object_ref_sink(pool->task_pool);
+    g_mutex_init(&pool->lock);
+    pool->threads = g_array_new(FALSE, FALSE, sizeof(ThreadPlacement));
+
+    // 목록을 cpus_per_camera개씩 차례로 나눠 줌 (카메라가 더 많으면 처음부터 다시, 0이면 모두 목록 전체)
+    cpus = g_string_new(NULL);
+    count = affinity_per_camera > 0 ? affinity_per_camera : affinity_cpus->len;
+    first = affinity_per_camera > 0 ? (affinity_next_group * count) % MAX(affinity_cpus->len, 1) : 0;
+#ifdef __linux__
+    CPU_ZERO(&pool->task_pool->cpus);
+    for (i = 0; i < count && affinity_cpus->len > 0; i++) {
+        gint cpu = g_array_index(affinity_cpus, gint, (first + i) % affinity_cpus->len);
+
+        CPU_SET(cpu, &pool->task_pool->cpus);
+        g_string_append_printf(cpus, "%s%d", i > 0 ? "," : "", cpu);
+    }
+#endif
+    pool->task_pool->pin = cpus->len > 0;
+    pool->cpus = g_string_free(cpus, FALSE);
+    affinity_next_group++;
+    return pool;
+}
+
+void affinity_pool_free(AffinityPool* pool) {
+    guint i;
+
+    if (!pool)
+        return;
+    // 남은 작업이 있으면 작업이 풀 참조를 들고 있음
+    gst_object_unref(pool->task_pool);
+    for (i = 0; i < pool->threads->len; i++)
+        g_free(g_array_index(pool->threads, ThreadPlacement, i).name);
+    g_array_free(pool->threads, TRUE);
+    g_mutex_clear(&pool->lock);
+    g_free(pool->cpus);
+    g_free(pool);
+}
+
+void affinity_pool_handle_stream_status(AffinityPool* pool, GstMessage* msg) {
+    GstStreamStatusType type;
+    GstElement* owner;
+    const GValue* value;
+    ThreadPlacement placement;
+    gint tid;
+    guint i;
+
+    gst_message_parse_stream_status(msg, &type, &owner);
+    switch (type) {
+    case GST_STREAM_STATUS_TYPE_CREATE:
+        // 태스크를 시작하기 전 (gst_pad_start_task 안): 여기서 정한 풀에서 스레드를 받음
+        value = gst_message_get_stream_status_object(msg);
+        if (value && G_VALUE_HOLDS(value, GST_TYPE_TASK))
+            gst_task_set_pool(GST_TASK(g_value_get_object(value)), GST_TASK_POOL(pool->task_pool));
+        break;
+    case GST_STREAM_STATUS_TYPE_ENTER:
+        // ENTER/LEAVE는 그 스트리밍 스레드 자신이 보냄
+        placement.tid = current_tid();
+        placement.enter_cpu = current_cpu();
+        placement.pinned = g_private_get(&current_pool) == pool->task_pool;
+        if (GST_MESSAGE_SRC(msg) && GST_MESSAGE_SRC(msg) != GST_OBJECT(owner))
+            placement.name = g_strdup_printf("%s:%s", GST_ELEMENT_NAME(owner), GST_MESSAGE_SRC_NAME(msg));
+        else
+            placement.name = g_strdup(GST_ELEMENT_NAME(owner));
+        g_mutex_lock(&pool->lock);
+        g_array_append_val(pool->threads, placement);
+        g_mutex_unlock(&pool->lock);
+        break;
+    case GST_STREAM_STATUS_TYPE_LEAVE:
+        tid = current_tid();
+        g_mutex_lock(&pool->lock);
+        for (i = 0; i < pool->threads->len; i++) {
+            if (g_array_index(pool->threads, ThreadPlacement, i).tid == tid) {
+                g_free(g_array_index(pool->threads, ThreadPlacement, i).name);
+                g_array_remove_index(pool->threads, i);
+                break;
+            }
+        }
+        g_mutex_unlock(&pool->lock);
+        break;
+    default:
+        break;
+    }
+}
+
+void affinity_pool_append_json(AffinityPool* pool, GString* json) {
+    guint i;
+
+    g_string_append_printf(json, "{\"cpus\":\"%s\",\"nice\":%d,\"pinned\":%d,\"errors\":%d,\"threads\":[",
+        pool->cpus, affinity_nice, g_atomic_int_get(&pool->task_pool->pinned), g_atomic_int_get(&pool->task_pool->errors));
+    g_mutex_lock(&pool->lock);
+    for (i = 0; i < pool->threads->len; i++) {
+        ThreadPlacement* placement = &g_array_index(pool->threads, ThreadPlacement, i);
+        gint cpu = thread_last_cpu(placement->tid);
+        gchar* name = g_strescape(placement->name, NULL);
+
+        g_string_append_printf(json, "%s{\"name\":\"%s\",\"tid\":%d,\"cpu\":%d,\"pinned\":%s}",
+            i > 0 ? "," : "", name, placement->tid, cpu >= 0 ? cpu : placement->enter_cpu,
+            placement->pinned ? "true" : "false");
+        g_free(name);
+    }
+    g_mutex_unlock(&pool->lock);
+    g_string_append(json, "]}");
+}
@@ -0,0 +1,41 @@
+#ifndef CLIPPER_AFFINITY_H
+#define CLIPPER_AFFINITY_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// 카메라별 스트리밍 스레드 CPU 고정 (Linux).
+// 카메라가 많으면 스케줄러가 큐/소스/muxer 스레드를 모든 코어와 NUMA 노드에 흩어 놓아 캐시 지역성이 나빠진다.
+// 설정하면 카메라마다 GstTaskPool을 하나씩 붙여서(버스 sync 핸들러의 STREAM_STATUS CREATE) 그 카메라의 GstTask가
+// 프로세스 공용 스레드 풀에서 돌 때 작업을 시작하기 전에 카메라에 배정된 CPU 묶음으로 고정하고 nice 값을 적용한다.
+// x264enc/videoconvert의 작업 스레드는 GstTask가 아니지만 고정된 스트리밍 스레드에서 만들어지므로 같은 CPU 묶음을 물려받는다.
+// 프로세스 설정은 카메라를 만들기 전에 메인 스레드에서 한 번 한다.
+
+// cpus: "0-7,16-23" 형식의 CPU 목록 (NULL = 고정하지 않음)
+// cpus_per_camera: 카메라마다 목록에서 차례로 나눠 줄 CPU 수 (0 = 모든 카메라가 목록 전체를 씀)
+// nice: 스트리밍 스레드의 nice 값 (0 = 바꾸지 않음, 음수는 CAP_SYS_NICE 필요)
+gboolean affinity_configure(const gchar* cpus, guint cpus_per_camera, gint nice);
+gboolean affinity_is_enabled(void);
+// 모든 카메라를 해제한 뒤에 호출 (공용 스레드 풀 정리)
+void affinity_shutdown(void);
+// 설정 요약: {"cpus":"...","cpus_per_camera":N,"nice":N}
+void affinity_append_json(GString* json);
+
+typedef struct _AffinityPool AffinityPool;
+
+// 카메라 하나의 태스크 풀 (다음 CPU 묶음을 배정). 설정하지 않았으면 NULL
+AffinityPool* affinity_pool_new(void);
+// 파이프라인을 해제한 뒤에 호출 (태스크가 모두 끝난 뒤)
+void affinity_pool_free(AffinityPool* pool);
+
+// 버스 sync 핸들러에서 STREAM_STATUS 메시지마다 호출 (메시지를 보낸 스레드).
+// CREATE: 태스크에 풀 지정, ENTER: 스레드 배치 기록, LEAVE: 기록 삭제
+void affinity_pool_handle_stream_status(AffinityPool* pool, GstMessage* msg);
+
+// 배정된 CPU, 고정한 스레드 수, 살아 있는 스트리밍 스레드별 {name, tid, cpu(마지막 실행), pinned}
+void affinity_pool_append_json(AffinityPool* pool, GString* json);
+
+G_END_DECLS
+
+#endif // CLIPPER_AFFINITY_H
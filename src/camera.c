@@ -0,0 +1,1893 @@
+#include "camera.h"
+
+#include <string.h>
+
+// passthrough 모드에서 uridecodebin이 디코딩을 멈출 caps (H.264는 그대로, 나머지는 기본값)
+#define PASSTHROUGH_DECODE_CAPS "video/x-h264; video/x-raw(ANY); audio/x-raw(ANY); text/x-raw(ANY)"
+// uridecodebin autoplug-select 결과 (GstAutoplugSelectResult는 공개 헤더가 없음)
+typedef enum {
+    AUTOPLUG_SELECT_TRY,
+    AUTOPLUG_SELECT_EXPOSE,
+    AUTOPLUG_SELECT_SKIP
+} AutoplugSelectResult;
+// 재인코딩 모드에서 tee 앞의 공용 포맷: x264enc가 받고 대부분의 비디오 싱크도 받는 4:2:0 포맷.
+// 디코더 출력이 이미 이 중 하나면 videoconvert는 passthrough (복사 없음)
+#define SHARED_RAW_CAPS "video/x-raw, format=(string){ I420, NV12, YV12 }"
+// 모니터링용 썸네일 폭 (높이는 원본 비율 유지)
+#define THUMBNAIL_WIDTH 320
+// 소스 재연결 첫 대기 시간 (실패할 때마다 두 배, reconnect_max_delay에서 멈춤)
+#define SOURCE_RECONNECT_MIN_DELAY (500 * GST_MSECOND)
+// 소스 감시 타이머 주기 상한 (ms)
+#define WATCHDOG_MAX_INTERVAL_MS 250
+// 움직임 분석 해상도/프레임레이트와 판정 주기 (ms)
+#define MOTION_WIDTH 160
+#define MOTION_HEIGHT 90
+#define MOTION_FPS 5
+#define MOTION_INTERVAL_MS 200
+// 공유 메모리 브랜치의 멈춤 검사 주기 (ms)
+#define SHM_INTERVAL_MS 250
+// ABR 판정 주기 (ms)와 녹화 큐 상한이 없을 때 밀린 것으로 보는 적체 시간
+#define ABR_INTERVAL_MS 1000
+#define ABR_LAG_LIMIT (GST_SECOND)
+
+// 녹화 브랜치 x264enc 프로파일: 배포 환경마다 C 코드 수정 없이 지연/처리량/화질 중 선택
+typedef struct _EncoderSetting {
+    const gchar* property;
+    const gchar* value;             // gst_util_set_object_arg 형식 (enum은 nick)
+} EncoderSetting;
+
+typedef struct _EncoderProfile {
+    const gchar* name;
+    EncoderSetting settings[8];     // { NULL } 으로 끝남
+} EncoderProfile;
+
+static const EncoderProfile encoder_profiles[] = {
+    // x264enc 기본값 (medium, lookahead 40, B-프레임 0, 프레임 단위 스레드)
+    { "default", { { NULL } } },
+    // 프레임 지연 없음: lookahead/B-프레임 제거, 한 프레임을 여러 스레드가 나눠 인코딩
+    { "low-latency", {
+        { "tune", "zerolatency" },
+        { "speed-preset", "superfast" },
+        { "bframes", "0" },
+        { "rc-lookahead", "0" },
+        { "sync-lookahead", "0" },
+        { "sliced-threads", "true" },
+        { NULL } } },
+    // 카메라 여러 대를 한 호스트에서: 프레임 단위 스레드로 CPU당 처리량 우선 (수백 ms 지연)
+    { "throughput", {
+        { "speed-preset", "veryfast" },
+        { "sliced-threads", "false" },
+        { "threads", "0" },
+        { "bframes", "2" },
+        { "rc-lookahead", "10" },
+        { NULL } } },
+    // 장기 보관: 고정 화질(CRF 유사) + 깊은 lookahead, 지연과 CPU를 크게 씀
+    { "archival", {
+        { "speed-preset", "slow" },
+        { "pass", "qual" },
+        { "quantizer", "20" },
+        { "bframes", "3" },
+        { "rc-lookahead", "40" },
+        { NULL } } },
+};
+
+static const EncoderProfile* find_encoder_profile(const gchar* name) {
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(encoder_profiles); i++) {
+        if (g_strcmp0(encoder_profiles[i].name, name) == 0)
+            return &encoder_profiles[i];
+    }
+    return NULL;
+}
+
+gboolean camera_encoder_profile_is_valid(const gchar* profile) {
+    return find_encoder_profile(profile) != NULL;
+}
+
+static void apply_encoder_profile(Camera* camera, GstElement* encoder, const gchar* name) {
+    const EncoderProfile* profile = find_encoder_profile(name ? name : "default");
+    const EncoderSetting* setting;
+
+    if (!profile) {
+        g_printerr("[%s] Unknown encoder profile '%s', using x264enc defaults.\n", camera->name, name);
+        return;
+    }
+    for (setting = profile->settings; setting->property; setting++)
+        gst_util_set_object_arg(G_OBJECT(encoder), setting->property, setting->value);
+    g_print("[%s] Encoder profile: %s\n", camera->name, profile->name);
+}
+
+static void pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera);
+static void display_pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera);
+static void thumbnail_pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera);
+static void motion_pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera);
+static gboolean motion_timeout(Camera* camera);
+static void shm_pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera);
+static gboolean shm_timeout(Camera* camera);
+static gboolean bus_call(GstBus* bus, GstMessage* msg, Camera* camera);
+static GstBusSyncReply bus_sync_handler(GstBus* bus, GstMessage* msg, Camera* camera);
+static gchar* format_location_handler(GstElement* splitmux, guint fragment_id, Camera* camera);
+static void clip_free(CameraClip* clip);
+static GstPadProbeReturn source_eos_probe(GstPad* pad, GstPadProbeInfo* info, Camera* camera);
+static gboolean watchdog_timeout(Camera* camera);
+static gboolean abr_timeout(Camera* camera);
+
+static GstElement* make_element(Camera* camera, const gchar* factory, const gchar* name) {
+    GstElement* element = gst_element_factory_make(factory, name);
+    if (!element) {
+        g_printerr("[%s] %s element could not be created. Check GStreamer plugin installations (e.g., -base, -good, -bad, -ugly).\n",
+            camera->name, factory);
+    }
+    return element;
+}
+
+// 플러그인 하나를 로드 (레지스트리에는 있지만 아직 dlopen하지 않은 경우)
+static gboolean preload_factory(const gchar* name, gboolean required) {
+    GstElementFactory* factory = gst_element_factory_find(name);
+    GstPluginFeature* loaded;
+
+    if (!factory) {
+        if (required)
+            g_printerr("%s element factory not found. Check GStreamer plugin installations (e.g., -base, -good, -bad, -ugly).\n", name);
+        return !required;
+    }
+    loaded = gst_plugin_feature_load(GST_PLUGIN_FEATURE(factory));
+    gst_object_unref(factory);
+    if (!loaded) {
+        g_printerr("%s plugin could not be loaded.\n", name);
+        return !required;
+    }
+    gst_object_unref(loaded);
+    return TRUE;
+}
+
+gboolean camera_preload_plugins(const ClipperConfig* config) {
+    // uridecodebin이 HLS에서 자동으로 고르는 엘리먼트 (없어도 됨)
+    static const gchar* const autoplug_factories[] = { "souphttpsrc", "hlsdemux", "tsdemux", "h264parse", "avdec_h264", NULL };
+    const gchar* factories[24];
+    guint n = 0;
+    gboolean ok = TRUE;
+    guint i;
+
+    factories[n++] = "uridecodebin";
+    factories[n++] = "tee";
+    factories[n++] = "queue";
+    factories[n++] = config->record_mode == RECORD_MODE_CONTINUOUS ? "splitmuxsink" : "filesink";
+    factories[n++] = "mp4mux";
+    if (config->passthrough) {
+        factories[n++] = "h264parse";
+        factories[n++] = "decodebin";
+    }
+    else {
+        factories[n++] = "videoconvert";
+        factories[n++] = "capsfilter";
+        factories[n++] = "x264enc";
+    }
+    if (!config->headless) {
+        factories[n++] = "videoconvert";
+        factories[n++] = config->display_sink ? config->display_sink : "autovideosink";
+    }
+    if (config->thumbnail_interval > 0) {
+        factories[n++] = "videorate";
+        factories[n++] = "videoscale";
+        factories[n++] = "jpegenc";
+        factories[n++] = "multifilesink";
+    }
+    if (config->motion) {
+        factories[n++] = "videorate";
+        factories[n++] = "videoscale";
+        factories[n++] = "fakesink";
+    }
+    if (config->shm_dir)
+        factories[n++] = "shmsink";
+    for (i = 0; i < n; i++)
+        ok = preload_factory(factories[i], TRUE) && ok;
+    for (i = 0; autoplug_factories[i]; i++)
+        preload_factory(autoplug_factories[i], FALSE);
+    return ok;
+}
+
+// 쓰지 않는 스트림(오디오, 자막)은 파서/디코더를 고르지 않고 압축된 채로 노출 (pad_added_handler에서 버림)
+// 팩토리 분류가 아니라 패드 caps로 판단함 (jpegdec/pngdec 같은 "Codec/Decoder/Image"는 MJPEG 카메라에 필요)
+static AutoplugSelectResult autoplug_select_handler(GstElement* bin, GstPad* pad, GstCaps* caps, GstElementFactory* factory,
+    Camera* camera) {
+    const gchar* media;
+
+    if (gst_caps_is_empty(caps) || gst_caps_is_any(caps))
+        return AUTOPLUG_SELECT_TRY;
+    media = gst_structure_get_name(gst_caps_get_structure(caps, 0));
+    if (!g_str_has_prefix(media, "audio/") && !g_str_has_prefix(media, "text/") && !g_str_has_prefix(media, "subpicture/"))
+        return AUTOPLUG_SELECT_TRY;
+    g_print("[%s] Not decoding '%s' (%s).\n", camera->name, media, GST_OBJECT_NAME(factory));
+    g_atomic_int_inc(&camera->n_skipped_decoders);
+    return AUTOPLUG_SELECT_EXPOSE;
+}
+
+// 버리는 스트림: 연결하지 않은 패드로 push하면 not-linked가 되므로 패드에서 바로 버림
+static GstPadProbeReturn unused_stream_probe(GstPad* pad, GstPadProbeInfo* info, Camera* camera) {
+    g_atomic_int_inc(&camera->n_unused_buffers);
+    return GST_PAD_PROBE_DROP;
+}
+
+// URI 소스 (재연결할 때도 이 부분만 다시 만듦)
+static gboolean build_uri_source(Camera* camera) {
+    camera->uri_decode_bin = make_element(camera, "uridecodebin", "uri-source-decoder");
+    if (!camera->uri_decode_bin)
+        return FALSE;
+    // URI 설정 (풀에서 대기하는 카메라는 camera_bind에서)
+    if (camera->uri)
+        g_object_set(G_OBJECT(camera->uri_decode_bin), "uri", camera->uri, NULL);
+    if (camera->config->passthrough) {
+        // H.264 엘리멘터리 스트림에서 자동 디코딩을 멈춤
+        GstCaps* decode_caps = gst_caps_from_string(PASSTHROUGH_DECODE_CAPS);
+        g_object_set(G_OBJECT(camera->uri_decode_bin), "caps", decode_caps, NULL);
+        gst_caps_unref(decode_caps);
+    }
+    gst_bin_add(GST_BIN(camera->pipeline), camera->uri_decode_bin);
+    // uridecodebin의 pad-added 시그널 연결 (동적 연결 처리)
+    g_signal_connect(camera->uri_decode_bin, "pad-added", G_CALLBACK(pad_added_handler), camera);
+    if (!camera->config->decode_all_streams)
+        g_signal_connect(camera->uri_decode_bin, "autoplug-select", G_CALLBACK(autoplug_select_handler), camera);
+    if (camera->abr)
+        abr_policy_watch_source(camera->abr, camera->uri_decode_bin);
+    return TRUE;
+}
+
+// 소스 섹션 생성: uridecodebin 또는 videotestsrc (passthrough 모드에서는 H.264까지)
+static gboolean build_source(Camera* camera) {
+    const ClipperConfig* config = camera->config;
+
+    if (camera->uri && g_str_has_prefix(camera->uri, CAMERA_TEST_URI_PREFIX)) {
+        const gchar* pattern = camera->uri + strlen(CAMERA_TEST_URI_PREFIX);
+
+        // 라이브 CCTV 없이 테스트할 수 있도록 videotestsrc 사용
+        camera->test_source = make_element(camera, "videotestsrc", "test-source");
+        if (!camera->test_source)
+            return FALSE;
+        g_object_set(G_OBJECT(camera->test_source), "is-live", TRUE, NULL);
+        if (*pattern != '\0')
+            gst_util_set_object_arg(G_OBJECT(camera->test_source), "pattern", pattern);
+        gst_bin_add(GST_BIN(camera->pipeline), camera->test_source);
+
+        if (config->test_width > 0 && config->test_height > 0) {
+            // 해상도 고정 (벤치마크에서 720p/1080p/4K 비교용)
+            GstCaps* caps = gst_caps_new_simple("video/x-raw",
+                "width", G_TYPE_INT, config->test_width,
+                "height", G_TYPE_INT, config->test_height,
+                NULL);
+            camera->test_caps = make_element(camera, "capsfilter", "test-caps");
+            if (!camera->test_caps) {
+                gst_caps_unref(caps);
+                return FALSE;
+            }
+            g_object_set(G_OBJECT(camera->test_caps), "caps", caps, NULL);
+            gst_caps_unref(caps);
+            gst_bin_add(GST_BIN(camera->pipeline), camera->test_caps);
+            if (!gst_element_link(camera->test_source, camera->test_caps)) {
+                g_printerr("[%s] Test source could not be linked to its capsfilter.\n", camera->name);
+                return FALSE;
+            }
+        }
+
+        if (config->passthrough) {
+            // 카메라가 H.264로 보내는 상황을 흉내내기 위해 소스 쪽에서 한 번만 인코딩
+            camera->test_encoder = make_element(camera, "x264enc", "test-encoder");
+            if (!camera->test_encoder)
+                return FALSE;
+            gst_util_set_object_arg(G_OBJECT(camera->test_encoder), "tune", "zerolatency");
+            gst_bin_add(GST_BIN(camera->pipeline), camera->test_encoder);
+        }
+        return TRUE;
+    }
+    return build_uri_source(camera);
+}
+
+// Tee에서 src 패드를 요청해 branch의 sink 패드에 연결
+static gboolean link_tee_branch(Camera* camera, GstElement* branch, const gchar* label) {
+    GstPad* tee_pad = gst_element_request_pad_simple(camera->video_tee, "src_%u");
+    GstPad* sink_pad = gst_element_get_static_pad(branch, "sink");
+    gboolean ok = tee_pad && sink_pad && gst_pad_link(tee_pad, sink_pad) == GST_PAD_LINK_OK;
+
+    if (ok)
+        g_print("[%s] Obtained request pad %s for %s branch.\n", camera->name, GST_PAD_NAME(tee_pad), label);
+    else
+        g_printerr("[%s] Video Tee to %s queue could not be linked.\n", camera->name, label);
+    // 요청했던 Tee 패드 해제 (연결 후에는 필요 없음)
+    if (tee_pad)
+        gst_object_unref(tee_pad);
+    if (sink_pad)
+        gst_object_unref(sink_pad);
+    return ok;
+}
+
+// 썸네일 브랜치(passthrough 모드): 디코더에는 키프레임만 보냄
+static GstPadProbeReturn keyframe_only_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    if (GST_BUFFER_FLAG_IS_SET(GST_PAD_PROBE_INFO_BUFFER(info), GST_BUFFER_FLAG_DELTA_UNIT))
+        return GST_PAD_PROBE_DROP;
+    return GST_PAD_PROBE_OK;
+}
+
+// 위치에 %d가 없으므로 매번 같은 파일(thumb-<이름>.jpg)을 덮어씀
+static void set_thumbnail_location(Camera* camera) {
+    gchar* file_name = g_strdup_printf("thumb-%s.jpg", camera->name);
+    gchar* location = g_build_filename(camera->config->output_dir, file_name, NULL);
+
+    g_object_set(G_OBJECT(camera->thumbnail_sink), "location", location, NULL);
+    g_free(location);
+    g_free(file_name);
+}
+
+// 썸네일 브랜치: tee -> queue(leaky) -> [decodebin] -> videorate(1/N) -> videoconvert -> videoscale -> jpegenc -> multifilesink
+// 파일 하나(thumb-<이름>.jpg)를 N초마다 덮어씀. 녹화를 막지 않도록 큐는 넘치면 오래된 버퍼를 버림
+static gboolean build_thumbnail_branch(Camera* camera) {
+    const ClipperConfig* config = camera->config;
+    GstCaps* caps;
+    GstPad* queue_src_pad;
+
+    camera->thumbnail_queue = make_element(camera, "queue", "thumbnail_queue");
+    camera->thumbnail_rate = make_element(camera, "videorate", "thumbnail_rate");
+    camera->thumbnail_convert = make_element(camera, "videoconvert", "thumbnail_convert");
+    camera->thumbnail_scale = make_element(camera, "videoscale", "thumbnail_scale");
+    camera->thumbnail_caps = make_element(camera, "capsfilter", "thumbnail_caps");
+    camera->thumbnail_encoder = make_element(camera, "jpegenc", "thumbnail_encoder");
+    camera->thumbnail_sink = make_element(camera, "multifilesink", "thumbnail_sink");
+    if (config->passthrough)
+        camera->thumbnail_decoder = make_element(camera, "decodebin", "thumbnail_decoder");
+    if (!camera->thumbnail_queue || !camera->thumbnail_rate || !camera->thumbnail_convert || !camera->thumbnail_scale ||
+        !camera->thumbnail_caps || !camera->thumbnail_encoder || !camera->thumbnail_sink ||
+        (config->passthrough && !camera->thumbnail_decoder)) {
+        return FALSE;
+    }
+
+    gst_util_set_object_arg(G_OBJECT(camera->thumbnail_queue), "leaky", "downstream");
+    g_object_set(G_OBJECT(camera->thumbnail_queue), "max-size-buffers", 2, "max-size-bytes", 0, "max-size-time", (guint64)0, NULL);
+    g_object_set(G_OBJECT(camera->thumbnail_rate), "drop-only", TRUE, NULL);
+    caps = gst_caps_new_simple("video/x-raw",
+        "width", G_TYPE_INT, THUMBNAIL_WIDTH,
+        "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+        "framerate", GST_TYPE_FRACTION, 1, (gint)config->thumbnail_interval,
+        NULL);
+    g_object_set(G_OBJECT(camera->thumbnail_caps), "caps", caps, NULL);
+    gst_caps_unref(caps);
+    g_object_set(G_OBJECT(camera->thumbnail_sink), "async", FALSE, NULL);
+    set_thumbnail_location(camera);
+
+    gst_bin_add_many(GST_BIN(camera->pipeline),
+        camera->thumbnail_queue, camera->thumbnail_rate, camera->thumbnail_convert, camera->thumbnail_scale,
+        camera->thumbnail_caps, camera->thumbnail_encoder, camera->thumbnail_sink, NULL);
+    if (!gst_element_link_many(camera->thumbnail_rate, camera->thumbnail_convert, camera->thumbnail_scale,
+        camera->thumbnail_caps, camera->thumbnail_encoder, camera->thumbnail_sink, NULL)) {
+        g_printerr("[%s] Thumbnail elements could not be linked.\n", camera->name);
+        return FALSE;
+    }
+    if (config->passthrough) {
+        gst_bin_add(GST_BIN(camera->pipeline), camera->thumbnail_decoder);
+        g_signal_connect(camera->thumbnail_decoder, "pad-added", G_CALLBACK(thumbnail_pad_added_handler), camera);
+        if (!gst_element_link(camera->thumbnail_queue, camera->thumbnail_decoder)) {
+            g_printerr("[%s] Thumbnail queue could not be linked to its decoder.\n", camera->name);
+            return FALSE;
+        }
+        queue_src_pad = gst_element_get_static_pad(camera->thumbnail_queue, "src");
+        gst_pad_add_probe(queue_src_pad, GST_PAD_PROBE_TYPE_BUFFER, keyframe_only_probe, NULL, NULL);
+        gst_object_unref(queue_src_pad);
+    }
+    else if (!gst_element_link(camera->thumbnail_queue, camera->thumbnail_rate)) {
+        g_printerr("[%s] Thumbnail queue could not be linked to videorate.\n", camera->name);
+        return FALSE;
+    }
+    return link_tee_branch(camera, camera->thumbnail_queue, "thumbnail");
+}
+
+// 분석 브랜치: tee -> queue(leaky) -> [decodebin] -> videorate -> videoscale -> videoconvert -> GRAY8 160x90 @ 5fps -> fakesink
+// fakesink 앞의 probe에서 프레임 차분. 큐 이후는 모두 큐의 스트리밍 스레드에서 돌므로 그 스레드의 CPU로 예산을 잰다
+static gboolean build_motion_branch(Camera* camera) {
+    const ClipperConfig* config = camera->config;
+    GstCaps* caps;
+    GstPad* queue_src_pad;
+    GstPad* sink_pad;
+
+    camera->motion_queue = make_element(camera, "queue", "motion_queue");
+    camera->motion_rate = make_element(camera, "videorate", "motion_rate");
+    camera->motion_scale = make_element(camera, "videoscale", "motion_scale");
+    camera->motion_convert = make_element(camera, "videoconvert", "motion_convert");
+    camera->motion_caps = make_element(camera, "capsfilter", "motion_caps");
+    camera->motion_sink = make_element(camera, "fakesink", "motion_sink");
+    if (config->passthrough)
+        camera->motion_decoder = make_element(camera, "decodebin", "motion_decoder");
+    if (!camera->motion_queue || !camera->motion_rate || !camera->motion_scale || !camera->motion_convert ||
+        !camera->motion_caps || !camera->motion_sink || (config->passthrough && !camera->motion_decoder)) {
+        return FALSE;
+    }
+
+    // 분석이 밀려도 녹화/재생을 막지 않도록 최신 프레임 2장만 유지
+    gst_util_set_object_arg(G_OBJECT(camera->motion_queue), "leaky", "downstream");
+    g_object_set(G_OBJECT(camera->motion_queue), "max-size-buffers", 2, "max-size-bytes", 0, "max-size-time", (guint64)0, NULL);
+    // 축소 전에 프레임을 줄여서 버릴 프레임은 축소/변환하지 않음
+    g_object_set(G_OBJECT(camera->motion_rate), "drop-only", TRUE, NULL);
+    caps = gst_caps_new_simple("video/x-raw",
+        "format", G_TYPE_STRING, "GRAY8",
+        "width", G_TYPE_INT, MOTION_WIDTH,
+        "height", G_TYPE_INT, MOTION_HEIGHT,
+        "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+        "framerate", GST_TYPE_FRACTION, MOTION_FPS, 1,
+        NULL);
+    g_object_set(G_OBJECT(camera->motion_caps), "caps", caps, NULL);
+    gst_caps_unref(caps);
+    g_object_set(G_OBJECT(camera->motion_sink), "sync", FALSE, "async", FALSE, NULL);
+
+    gst_bin_add_many(GST_BIN(camera->pipeline),
+        camera->motion_queue, camera->motion_rate, camera->motion_scale, camera->motion_convert,
+        camera->motion_caps, camera->motion_sink, NULL);
+    if (!gst_element_link_many(camera->motion_rate, camera->motion_scale, camera->motion_convert,
+        camera->motion_caps, camera->motion_sink, NULL)) {
+        g_printerr("[%s] Motion analysis elements could not be linked.\n", camera->name);
+        return FALSE;
+    }
+    queue_src_pad = gst_element_get_static_pad(camera->motion_queue, "src");
+    if (config->passthrough) {
+        gst_bin_add(GST_BIN(camera->pipeline), camera->motion_decoder);
+        g_signal_connect(camera->motion_decoder, "pad-added", G_CALLBACK(motion_pad_added_handler), camera);
+        if (!gst_element_link(camera->motion_queue, camera->motion_decoder)) {
+            g_printerr("[%s] Motion queue could not be linked to its decoder.\n", camera->name);
+            gst_object_unref(queue_src_pad);
+            return FALSE;
+        }
+        gst_pad_add_probe(queue_src_pad, GST_PAD_PROBE_TYPE_BUFFER, keyframe_only_probe, NULL, NULL);
+    }
+    else if (!gst_element_link(camera->motion_queue, camera->motion_rate)) {
+        g_printerr("[%s] Motion queue could not be linked to videorate.\n", camera->name);
+        gst_object_unref(queue_src_pad);
+        return FALSE;
+    }
+
+    camera->motion = motion_detector_new(config->motion_min_area, config->motion_cpu_budget);
+    sink_pad = gst_element_get_static_pad(camera->motion_sink, "sink");
+    motion_detector_attach(camera->motion, queue_src_pad, sink_pad);
+    gst_object_unref(sink_pad);
+    gst_object_unref(queue_src_pad);
+    return link_tee_branch(camera, camera->motion_queue, "motion");
+}
+
+static void set_shm_location(Camera* camera) {
+    gchar* file_name = g_strdup_printf("shm-%s.sock", camera->name);
+    gchar* socket_path = g_build_filename(camera->config->shm_dir, file_name, NULL);
+
+    shm_output_set_path(camera->shm, socket_path);
+    g_free(socket_path);
+    g_free(file_name);
+}
+
+// 공유 메모리 브랜치: tee -> queue(leaky) -> [decodebin] -> shmsink
+// 프레임은 tee에 들어온 포맷 그대로 (재인코딩 모드는 공용 4:2:0 포맷, passthrough 모드는 디코더 출력).
+// 읽는 쪽이 없으면 shmsink는 버퍼를 바로 놓고, 읽는 쪽이 밀리면 큐가 오래된 프레임을 버림
+static gboolean build_shm_branch(Camera* camera) {
+    const ClipperConfig* config = camera->config;
+
+    camera->shm_queue = make_element(camera, "queue", "shm_queue");
+    camera->shm_sink = make_element(camera, "shmsink", "shm_sink");
+    if (config->passthrough)
+        camera->shm_decoder = make_element(camera, "decodebin", "shm_decoder");
+    if (!camera->shm_queue || !camera->shm_sink || (config->passthrough && !camera->shm_decoder))
+        return FALSE;
+
+    gst_util_set_object_arg(G_OBJECT(camera->shm_queue), "leaky", "downstream");
+    g_object_set(G_OBJECT(camera->shm_queue), "max-size-buffers", 2, "max-size-bytes", 0, "max-size-time", (guint64)0, NULL);
+    // 읽는 쪽이 붙기를 기다리지 않고, 라이브 소스라 시계에 맞추지도 않음
+    g_object_set(G_OBJECT(camera->shm_sink), "wait-for-connection", FALSE, "sync", FALSE, "async", FALSE, NULL);
+
+    gst_bin_add_many(GST_BIN(camera->pipeline), camera->shm_queue, camera->shm_sink, NULL);
+    if (config->passthrough) {
+        gst_bin_add(GST_BIN(camera->pipeline), camera->shm_decoder);
+        g_signal_connect(camera->shm_decoder, "pad-added", G_CALLBACK(shm_pad_added_handler), camera);
+        if (!gst_element_link(camera->shm_queue, camera->shm_decoder)) {
+            g_printerr("[%s] Shared memory queue could not be linked to its decoder.\n", camera->name);
+            return FALSE;
+        }
+    }
+    else if (!gst_element_link(camera->shm_queue, camera->shm_sink)) {
+        g_printerr("[%s] Shared memory queue could not be linked to shmsink.\n", camera->name);
+        return FALSE;
+    }
+
+    camera->shm = shm_output_new(config->shm_frames, config->shm_reader_timeout);
+    shm_output_attach(camera->shm, camera->shm_queue, camera->shm_sink);
+    set_shm_location(camera);
+    return link_tee_branch(camera, camera->shm_queue, "shared memory");
+}
+
+static GstPadProbeReturn queue_in_probe(GstPad* pad, GstPadProbeInfo* info, QueueCounters* counters) {
+    g_atomic_int_inc(&counters->in);
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn queue_out_probe(GstPad* pad, GstPadProbeInfo* info, QueueCounters* counters) {
+    g_atomic_int_inc(&counters->out);
+    return GST_PAD_PROBE_OK;
+}
+
+static void queue_overrun_handler(GstElement* queue, QueueCounters* counters) {
+    g_atomic_int_inc(&counters->overruns);
+}
+
+// tee 브랜치 큐 정책: 바이트/시간 상한, leaky면 넘칠 때 오래된 버퍼부터 버림.
+// 버린 수는 (들어온 수 - 나간 수 - 현재 점유)로 계산
+static void set_queue_policy(GstElement* queue, guint max_bytes, GstClockTime max_time, gboolean leaky, QueueCounters* counters) {
+    GstPad* sink_pad = gst_element_get_static_pad(queue, "sink");
+    GstPad* src_pad = gst_element_get_static_pad(queue, "src");
+
+    g_object_set(G_OBJECT(queue),
+        "max-size-buffers", 0,
+        "max-size-bytes", max_bytes,
+        "max-size-time", (guint64)max_time,
+        NULL);
+    gst_util_set_object_arg(G_OBJECT(queue), "leaky", leaky ? "downstream" : "no");
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)queue_in_probe, counters, NULL);
+    gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)queue_out_probe, counters, NULL);
+    g_signal_connect(queue, "overrun", G_CALLBACK(queue_overrun_handler), counters);
+    gst_object_unref(sink_pad);
+    gst_object_unref(src_pad);
+}
+
+// videoconvert 하나의 변환 카운터: 출력 버퍼가 입력 버퍼와 다르면 프레임을 복사/변환한 것
+typedef struct _ConvertCounter {
+    GstBuffer* last_in;             // 비교용 포인터만 보관 (ref 하지 않음)
+    gint* conversions;
+} ConvertCounter;
+
+static GstPadProbeReturn convert_sink_probe(GstPad* pad, GstPadProbeInfo* info, ConvertCounter* counter) {
+    counter->last_in = GST_PAD_PROBE_INFO_BUFFER(info);
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn convert_src_probe(GstPad* pad, GstPadProbeInfo* info, ConvertCounter* counter) {
+    // basetransform은 passthrough일 때 입력 버퍼를 그대로 push
+    if (GST_PAD_PROBE_INFO_BUFFER(info) != counter->last_in)
+        g_atomic_int_inc(counter->conversions);
+    counter->last_in = NULL;
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn frame_count_probe(GstPad* pad, GstPadProbeInfo* info, Camera* camera) {
+    // 첫 프레임: PLAYING 요청부터의 시작 시간 기록
+    if (g_atomic_int_add(&camera->n_frames, 1) == 0) {
+        gint elapsed = (gint)MIN(g_get_monotonic_time() - camera->startup.play_at_us, G_MAXINT);
+
+        g_atomic_int_set(&camera->startup.first_frame_us, elapsed);
+        g_print("[%s] First frame after %.1f ms.\n", camera->name, elapsed / 1000.0);
+    }
+    // 다시 만든 소스의 첫 프레임: 소스를 잃은 순간부터의 복구 시간 기록
+    if (g_atomic_int_compare_and_exchange(&camera->source_recovering, TRUE, FALSE)) {
+        gint elapsed = (gint)MIN(g_get_monotonic_time() - camera->source_lost_us, G_MAXINT);
+
+        g_atomic_int_set(&camera->recovery_us, elapsed);
+        if (elapsed > g_atomic_int_get(&camera->recovery_max_us))
+            g_atomic_int_set(&camera->recovery_max_us, elapsed);
+        g_print("[%s] Source recovered after %.1f ms.\n", camera->name, elapsed / 1000.0);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// tee에 들어온 해상도: 처음 해상도로 녹화 크기를 고정하고, 바뀌면 variant 전환으로 집계
+static GstPadProbeReturn abr_caps_probe(GstPad* pad, GstPadProbeInfo* info, Camera* camera) {
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+    const GstStructure* structure;
+    GstCaps* caps;
+    gint width, height;
+
+    if (GST_EVENT_TYPE(event) != GST_EVENT_CAPS)
+        return GST_PAD_PROBE_OK;
+    gst_event_parse_caps(event, &caps);
+    structure = gst_caps_get_structure(caps, 0);
+    if (!gst_structure_get_int(structure, "width", &width) || !gst_structure_get_int(structure, "height", &height))
+        return GST_PAD_PROBE_OK;
+    if (!camera->record_size_fixed) {
+        GstCaps* record_caps = gst_caps_new_simple("video/x-raw",
+            "width", G_TYPE_INT, width,
+            "height", G_TYPE_INT, height,
+            NULL);
+        g_object_set(G_OBJECT(camera->record_scale_caps), "caps", record_caps, NULL);
+        gst_caps_unref(record_caps);
+        camera->record_size_fixed = TRUE;
+    }
+    abr_policy_note_resolution(camera->abr, width, height);
+    return GST_PAD_PROBE_OK;
+}
+
+// 변환/축소 엘리먼트의 출력 풀 (하류가 풀을 제안하지 않으면 미리 할당한 풀을 넣음)
+static void watch_frame_pool(Camera* camera, GstElement* element, const gchar* pad_name, gboolean count_buffers) {
+    GstPad* pad;
+
+    if (!element)
+        return;
+    pad = gst_element_get_static_pad(element, pad_name);
+    frame_pools_watch_pad(camera->frame_pools, pad, count_buffers);
+    gst_object_unref(pad);
+}
+
+// 변환/축소 엘리먼트의 슬라이스 병렬화: 프로세스 전체 예산이 허락하는 만큼만 n-threads를 올림
+static void set_element_threads(Camera* camera, GstElement* element, guint wanted) {
+    guint threads;
+
+    if (!element || wanted <= 1 || !g_object_class_find_property(G_OBJECT_GET_CLASS(element), "n-threads"))
+        return;
+    threads = workers_acquire(wanted);
+    g_object_set(G_OBJECT(element), "n-threads", threads, NULL);
+    camera->worker_threads += threads - 1;
+    if (threads < wanted)
+        g_print("[%s] %s: %u of %u threads (worker budget %u/%u in use).\n", camera->name, GST_ELEMENT_NAME(element),
+            threads, wanted, workers_get_in_use(), workers_get_limit());
+}
+
+static void count_conversions(Camera* camera, GstElement* convert) {
+    ConvertCounter* counter = g_new0(ConvertCounter, 1);
+    GstPad* sink_pad = gst_element_get_static_pad(convert, "sink");
+    GstPad* src_pad = gst_element_get_static_pad(convert, "src");
+
+    counter->conversions = &camera->n_conversions;
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)convert_sink_probe, counter, NULL);
+    // 카운터는 src 패드 probe가 해제될 때 같이 해제
+    gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)convert_src_probe, counter, g_free);
+    gst_object_unref(sink_pad);
+    gst_object_unref(src_pad);
+}
+
+Camera* camera_new(const gchar* name, const gchar* uri, const ClipperConfig* config,
+    CameraFinishedFunc finished_func, gpointer user_data) {
+    Camera* camera;
+    GstBus* bus;
+    GstPad* record_src_pad;
+    GstPad* tee_sink_pad;
+    gchar* pipeline_name;
+    gint64 start = g_get_monotonic_time();
+
+    camera = g_new0(Camera, 1);
+    camera->name = g_strdup(name);
+    camera->uri = g_strdup(uri);
+    camera->config = config;
+    camera->finished_func = finished_func;
+    camera->finished_data = user_data;
+
+    // --- 1. 엘리먼트 생성 ---
+    pipeline_name = g_strdup_printf("clipper-%s", name);
+    camera->pipeline = gst_pipeline_new(pipeline_name);
+    g_free(pipeline_name);
+    if (!camera->pipeline) {
+        g_printerr("[%s] Pipeline element could not be created.\n", name);
+        goto error;
+    }
+    // ABR은 HLS(URI) 소스에만, 녹화 크기를 고정할 수 있는 재인코딩 모드에서만
+    if (config->abr && !(uri && g_str_has_prefix(uri, CAMERA_TEST_URI_PREFIX))) {
+        if (config->passthrough)
+            g_print("[%s] ABR policy needs re-encode mode (passthrough records the source variant as is); disabled.\n", name);
+        else
+            camera->abr = abr_policy_new();
+    }
+    if (!build_source(camera))
+        goto error;
+
+    camera->video_tee = make_element(camera, "tee", "video_tee");
+
+    // 재생 엘리먼트 생성 (headless 모드에서는 재생 브랜치 자체가 없음)
+    if (!config->headless) {
+        camera->video_queue_display = make_element(camera, "queue", "video_queue_display");
+        camera->video_convert_display = make_element(camera, "videoconvert", "video_convert_display");
+        camera->video_sink_display = make_element(camera, config->display_sink ? config->display_sink : "autovideosink", "video_sink_display");
+    }
+
+    // 녹화 엘리먼트 생성
+    // (클립 모드의 muxer/filesink는 녹화를 시작할 때마다 클립 bin으로 새로 만듦)
+    camera->video_queue_record = make_element(camera, "queue", "video_queue_record");
+    if (config->record_mode == RECORD_MODE_CONTINUOUS) {
+        camera->muxer = make_element(camera, "mp4mux", "muxer");
+        camera->splitmux_sink = make_element(camera, "splitmuxsink", "splitmux_sink");
+    }
+    else {
+        // 인코딩된 스트림을 동시에 녹화 중인 클립들로 나눔 (인코더는 하나)
+        camera->record_tee = make_element(camera, "tee", "record_tee");
+    }
+    if (config->async_writer) {
+        camera->writer = file_writer_new(config->writer_chunk_bytes, config->writer_max_inflight,
+            config->writer_sync_bytes, config->writer_sync_interval);
+    }
+
+    if (config->passthrough) {
+        // 인코딩된 스트림을 tee로 나누고, 재생 브랜치만 디코딩
+        camera->video_parse = make_element(camera, "h264parse", "video_parse");
+        if (!config->headless)
+            camera->video_decoder_display = make_element(camera, "decodebin", "video_decoder_display");
+    }
+    else {
+        // 두 브랜치가 공유하는 변환 한 번 (재생 쪽 videoconvert는 싱크가 공용 포맷을 못 받을 때만 동작)
+        camera->video_convert = make_element(camera, "videoconvert", "video_convert");
+        camera->video_convert_caps = make_element(camera, "capsfilter", "video_convert_caps");
+        camera->video_encoder = make_element(camera, "x264enc", "video_encoder"); // x264enc는 -ugly 플러그인 필요 가능성 있음
+        if (camera->abr) {
+            camera->record_scale = make_element(camera, "videoscale", "record_scale");
+            camera->record_scale_caps = make_element(camera, "capsfilter", "record_scale_caps");
+        }
+    }
+
+    // 모든 필수 엘리먼트 생성 확인
+    if (!camera->video_tee || !camera->video_queue_record ||
+        (config->record_mode == RECORD_MODE_CONTINUOUS && (!camera->muxer || !camera->splitmux_sink)) ||
+        (config->record_mode == RECORD_MODE_CLIP && !camera->record_tee) ||
+        (!config->headless && (!camera->video_queue_display || !camera->video_convert_display || !camera->video_sink_display)) ||
+        (config->passthrough && (!camera->video_parse || (!config->headless && !camera->video_decoder_display))) ||
+        (!config->passthrough && (!camera->video_convert || !camera->video_convert_caps || !camera->video_encoder)) ||
+        (camera->abr && (!camera->record_scale || !camera->record_scale_caps))) {
+        goto error;
+    }
+    camera->startup.create_us = g_get_monotonic_time() - start;
+    start = g_get_monotonic_time();
+
+    // 엘리먼트 속성 설정
+    // 재생이 멈춰도 녹화가 굶지 않도록 재생 큐는 leaky, 녹화 큐는 버리지 않음 (카메라당 메모리 상한)
+    if (camera->video_queue_display) {
+        set_queue_policy(camera->video_queue_display, config->display_queue_max_bytes, config->display_queue_max_time,
+            TRUE, &camera->display_counters);
+    }
+    set_queue_policy(camera->video_queue_record, config->record_queue_max_bytes, config->record_queue_max_time,
+        FALSE, &camera->record_counters);
+    if (camera->video_encoder)
+        apply_encoder_profile(camera, camera->video_encoder, config->encoder_profile);
+    if (camera->splitmux_sink) {
+        if (config->fragment_duration > 0) {
+            // 프로세스가 죽어도 마지막 조각 이전까지는 재생 가능하도록 fragmented MP4로 기록
+            g_object_set(G_OBJECT(camera->muxer), "fragment-duration", config->fragment_duration, NULL);
+        }
+        // 연속 녹화: 키프레임에서 시간/용량 기준으로 새 파일로 넘어감
+        g_object_set(G_OBJECT(camera->splitmux_sink),
+            "muxer", camera->muxer, // splitmuxsink가 muxer 소유
+            "max-size-time", config->segment_max_time,
+            "max-size-bytes", config->segment_max_bytes,
+            // 재인코딩 모드에서는 분할 시점에 인코더에 키프레임 요청
+            "send-keyframe-requests", !config->passthrough && config->segment_max_bytes == 0,
+            NULL);
+        // 세그먼트마다 location만 바꿔 같은 싱크를 다시 시작함 (이전 파일은 쓰기 스레드가 마저 씀)
+        if (camera->writer)
+            g_object_set(G_OBJECT(camera->splitmux_sink), "sink", file_writer_make_sink(camera->writer, "segment_writer"), NULL);
+        g_signal_connect(camera->splitmux_sink, "format-location", G_CALLBACK(format_location_handler), camera);
+    }
+
+    // --- 2. 파이프라인에 엘리먼트 추가 ---
+    gst_bin_add_many(GST_BIN(camera->pipeline), camera->video_tee, camera->video_queue_record, NULL);
+    if (!config->headless) {
+        gst_bin_add_many(GST_BIN(camera->pipeline),
+            camera->video_queue_display, camera->video_convert_display, camera->video_sink_display, NULL);
+    }
+    if (camera->splitmux_sink)
+        gst_bin_add(GST_BIN(camera->pipeline), camera->splitmux_sink);
+    if (camera->record_tee) {
+        // 클립이 하나도 없을 때도 흐름이 멈추지 않도록
+        g_object_set(G_OBJECT(camera->record_tee), "allow-not-linked", TRUE, NULL);
+        gst_bin_add(GST_BIN(camera->pipeline), camera->record_tee);
+    }
+    if (config->passthrough) {
+        // 재생 디코더가 SPS/PPS를 놓치지 않도록 키프레임마다 삽입
+        g_object_set(G_OBJECT(camera->video_parse), "config-interval", -1, NULL);
+        gst_bin_add(GST_BIN(camera->pipeline), camera->video_parse);
+        if (camera->video_decoder_display)
+            gst_bin_add(GST_BIN(camera->pipeline), camera->video_decoder_display);
+    }
+    else {
+        GstCaps* shared_caps = gst_caps_from_string(SHARED_RAW_CAPS);
+        g_object_set(G_OBJECT(camera->video_convert_caps), "caps", shared_caps, NULL);
+        gst_caps_unref(shared_caps);
+        gst_bin_add_many(GST_BIN(camera->pipeline), camera->video_convert, camera->video_convert_caps, camera->video_encoder, NULL);
+        if (camera->abr)
+            gst_bin_add_many(GST_BIN(camera->pipeline), camera->record_scale, camera->record_scale_caps, NULL);
+    }
+
+    // --- 3. 엘리먼트 연결 ---
+    if (config->passthrough && !gst_element_link(camera->video_parse, camera->video_tee)) {
+        g_printerr("[%s] H.264 parser could not be linked to the video tee.\n", name);
+        goto error;
+    }
+    if (!config->passthrough && !gst_element_link_many(camera->video_convert, camera->video_convert_caps, camera->video_tee, NULL)) {
+        g_printerr("[%s] Shared video converter could not be linked to the video tee.\n", name);
+        goto error;
+    }
+    if (camera->test_source) {
+        GstElement* test_tail = camera->test_caps ? camera->test_caps : camera->test_source;
+
+        if (config->passthrough) {
+            if (!gst_element_link_many(test_tail, camera->test_encoder, camera->video_parse, NULL)) {
+                g_printerr("[%s] Test source could not be linked to the H.264 parser.\n", name);
+                goto error;
+            }
+        }
+        else if (!gst_element_link(test_tail, camera->video_convert)) {
+            g_printerr("[%s] Test source could not be linked to the video converter.\n", name);
+            goto error;
+        }
+    }
+
+    // Tee -> 재생 큐, Tee -> 녹화 큐 연결 (headless 모드에서는 재생 패드를 요청하지 않음)
+    if ((!config->headless && !link_tee_branch(camera, camera->video_queue_display, "display")) ||
+        !link_tee_branch(camera, camera->video_queue_record, "record")) {
+        goto error;
+    }
+    set_element_threads(camera, camera->video_convert, config->convert_threads);
+    set_element_threads(camera, camera->video_convert_display, config->display_threads);
+    set_element_threads(camera, camera->record_scale, config->record_threads);
+    if (config->thumbnail_interval > 0 && !build_thumbnail_branch(camera))
+        goto error;
+    if (config->motion && !build_motion_branch(camera))
+        goto error;
+    if (config->shm_dir && !build_shm_branch(camera))
+        goto error;
+
+    // 나머지 정적 연결
+    // 비디오 재생 브랜치
+    if (config->headless) {
+        g_print("[%s] Headless: display branch disabled.\n", name);
+    }
+    else if (config->passthrough) {
+        // decodebin의 출력 패드는 동적으로 생성됨
+        g_signal_connect(camera->video_decoder_display, "pad-added", G_CALLBACK(display_pad_added_handler), camera);
+        if (!gst_element_link(camera->video_queue_display, camera->video_decoder_display) ||
+            !gst_element_link(camera->video_convert_display, camera->video_sink_display)) {
+            g_printerr("[%s] Video display elements could not be linked.\n", name);
+            goto error;
+        }
+    }
+    else if (!gst_element_link_many(camera->video_queue_display, camera->video_convert_display, camera->video_sink_display, NULL)) {
+        g_printerr("[%s] Video display elements could not be linked.\n", name);
+        goto error;
+    }
+    // 비디오 녹화 브랜치 (인코딩된 스트림까지)
+    if (config->passthrough) {
+        camera->record_tail = camera->video_queue_record;
+    }
+    else {
+        // ABR: mp4mux는 스트림 중간의 해상도 변경을 받지 못하므로 낮은 variant는 처음 해상도로 맞춰서 인코딩
+        if (camera->abr && !gst_element_link_many(camera->video_queue_record, camera->record_scale, camera->record_scale_caps,
+            camera->video_encoder, NULL)) {
+            g_printerr("[%s] Video recording elements (up to encoder) could not be linked.\n", name);
+            goto error;
+        }
+        if (!camera->abr && !gst_element_link(camera->video_queue_record, camera->video_encoder)) {
+            g_printerr("[%s] Video recording elements (up to encoder) could not be linked.\n", name);
+            goto error;
+        }
+        camera->record_tail = camera->video_encoder;
+    }
+    if (camera->splitmux_sink) {
+        // 연속 녹화는 프리롤/토글 없이 항상 기록
+        if (!gst_element_link_pads(camera->record_tail, "src", camera->splitmux_sink, "video")) {
+            g_printerr("[%s] Record branch could not be linked to splitmuxsink.\n", name);
+            goto error;
+        }
+        camera->recording = TRUE;
+    }
+    else {
+        if (!gst_element_link(camera->record_tail, camera->record_tee)) {
+            g_printerr("[%s] Record branch could not be linked to the clip tee.\n", name);
+            goto error;
+        }
+        // 클립 tee 앞의 인코딩된 스트림에 프리롤 링 버퍼 연결 (클립마다 tee 패드의 게이트가 녹화 여부를 결정)
+        record_src_pad = gst_element_get_static_pad(camera->record_tail, "src");
+        camera->preroll = preroll_buffer_new(config->preroll, config->preroll_max_time, config->preroll_max_bytes);
+        if (!preroll_buffer_attach(camera->preroll, record_src_pad)) {
+            g_printerr("[%s] Pre-roll buffer could not be attached to the record branch.\n", name);
+            gst_object_unref(record_src_pad);
+            goto error;
+        }
+        gst_object_unref(record_src_pad);
+    }
+
+    // 프레임당 변환 횟수 집계 (0이면 zero-copy)
+    tee_sink_pad = gst_element_get_static_pad(camera->video_tee, "sink");
+    gst_pad_add_probe(tee_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)frame_count_probe, camera, NULL);
+    if (camera->abr)
+        gst_pad_add_probe(tee_sink_pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, (GstPadProbeCallback)abr_caps_probe, camera, NULL);
+    gst_object_unref(tee_sink_pad);
+
+    // 소스 감시: URI 소스가 끝나도(EOS) 녹화 브랜치의 muxer가 닫히지 않도록 소스 쪽 EOS를 버리고 재연결
+    if (camera->uri_decode_bin && config->source_timeout > 0) {
+        GstPad* source_sink_pad = gst_element_get_static_pad(config->passthrough ? camera->video_parse : camera->video_convert, "sink");
+        gst_pad_add_probe(source_sink_pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, (GstPadProbeCallback)source_eos_probe, camera, NULL);
+        gst_object_unref(source_sink_pad);
+        camera->reconnect_delay = SOURCE_RECONNECT_MIN_DELAY;
+    }
+    if (camera->video_convert)
+        count_conversions(camera, camera->video_convert);
+    if (camera->video_convert_display)
+        count_conversions(camera, camera->video_convert_display);
+
+    // raw 프레임 풀: 재인코딩 모드는 tee에서 디코더 출력 풀을 브랜치들과 공유하고,
+    // passthrough 모드는 재생 브랜치의 디코더 출력에서. 변환/축소 엘리먼트의 출력에도 각각 풀을 둠
+    camera->frame_pools = frame_pools_new(config->frame_pool_min);
+    if (config->passthrough)
+        watch_frame_pool(camera, camera->video_convert_display, "sink", TRUE);
+    else
+        watch_frame_pool(camera, camera->video_tee, "sink", TRUE);
+    watch_frame_pool(camera, camera->video_convert_display, "src", FALSE);
+    watch_frame_pool(camera, camera->record_scale, "src", FALSE);
+    watch_frame_pool(camera, camera->thumbnail_convert, "src", FALSE);
+    watch_frame_pool(camera, camera->thumbnail_scale, "src", FALSE);
+    watch_frame_pool(camera, camera->motion_scale, "src", FALSE);
+    watch_frame_pool(camera, camera->motion_convert, "src", FALSE);
+
+    // 계측 모드: tee 이후 모든 엘리먼트 경계에 probe 설치
+    if (config->metrics) {
+        camera->metrics = metrics_new(name);
+        metrics_attach_tee(camera->metrics, camera->video_tee);
+    }
+
+    // --- 4. 버스 설정 (카메라별 watch, 메인 루프는 공유) ---
+    bus = gst_pipeline_get_bus(GST_PIPELINE(camera->pipeline));
+    camera->bus_watch_id = gst_bus_add_watch(bus, (GstBusFunc)bus_call, camera);
+    // 태스크 풀은 스트리밍 스레드가 시작되기 전(STREAM_STATUS CREATE)에 정해야 하므로 sync 핸들러에서
+    camera->affinity = affinity_pool_new();
+    if (camera->affinity)
+        gst_bus_set_sync_handler(bus, (GstBusSyncHandler)bus_sync_handler, camera, NULL);
+    gst_object_unref(bus);
+
+    // 썸네일 브랜치의 엘리먼트 생성도 여기에 포함됨
+    camera->startup.link_us = g_get_monotonic_time() - start;
+    return camera;
+
+error:
+    camera_free(camera);
+    return NULL;
+}
+
+void camera_free(Camera* camera) {
+    if (!camera)
+        return;
+    if (camera->bus_watch_id)
+        g_source_remove(camera->bus_watch_id);
+    if (camera->watchdog_id)
+        g_source_remove(camera->watchdog_id);
+    if (camera->reconnect_id)
+        g_source_remove(camera->reconnect_id);
+    if (camera->abr_id)
+        g_source_remove(camera->abr_id);
+    if (camera->motion_id)
+        g_source_remove(camera->motion_id);
+    if (camera->shm_id)
+        g_source_remove(camera->shm_id);
+    if (camera->pipeline) {
+        gst_element_set_state(camera->pipeline, GST_STATE_NULL);
+        gst_object_unref(camera->pipeline); // 파이프라인 해제 (포함된 엘리먼트들도 해제됨)
+    }
+    // 클립 bin은 파이프라인과 함께 해제됨, 남은 메인 루프 콜백만 정리
+    g_list_free_full(camera->clips, (GDestroyNotify)clip_free);
+    preroll_buffer_free(camera->preroll);
+    metrics_free(camera->metrics);
+    abr_policy_free(camera->abr);
+    motion_detector_free(camera->motion);
+    shm_output_free(camera->shm);
+    affinity_pool_free(camera->affinity);
+    // 아직 쓰고 있는 클립/세그먼트 파일이 닫힐 때까지 기다림
+    file_writer_free(camera->writer);
+    frame_pools_free(camera->frame_pools);
+    workers_release(camera->worker_threads);
+    g_free(camera->name);
+    g_free(camera->uri);
+    g_free(camera);
+}
+
+gboolean camera_prepare(Camera* camera) {
+    if (gst_element_set_state(camera->pipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
+        g_printerr("[%s] Unable to set the pipeline to the ready state.\n", camera->name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean camera_bind(Camera* camera, const gchar* name, const gchar* uri) {
+    gchar* pipeline_name;
+
+    if (camera->uri || !camera->uri_decode_bin || g_str_has_prefix(uri, CAMERA_TEST_URI_PREFIX))
+        return FALSE;
+    // READY 상태의 uridecodebin은 URI를 바꿀 수 있음 (소스 엘리먼트는 PAUSED로 갈 때 만들어짐)
+    g_free(camera->name);
+    camera->name = g_strdup(name);
+    camera->uri = g_strdup(uri);
+    pipeline_name = g_strdup_printf("clipper-%s", name);
+    gst_object_set_name(GST_OBJECT(camera->pipeline), pipeline_name);
+    g_free(pipeline_name);
+    g_object_set(G_OBJECT(camera->uri_decode_bin), "uri", uri, NULL);
+    if (camera->thumbnail_sink)
+        set_thumbnail_location(camera);
+    if (camera->shm)
+        set_shm_location(camera);
+    if (camera->metrics)
+        metrics_set_camera_name(camera->metrics, name);
+    return TRUE;
+}
+
+gboolean camera_play(Camera* camera) {
+    g_print("[%s] Using source: %s\n", camera->name, camera->uri);
+    camera->startup.play_at_us = g_get_monotonic_time();
+    if (gst_element_set_state(camera->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        g_printerr("[%s] Unable to set the pipeline to the playing state.\n", camera->name);
+        return FALSE;
+    }
+    if (camera->uri_decode_bin && camera->config->source_timeout > 0 && !camera->watchdog_id) {
+        guint interval = (guint)CLAMP(camera->config->source_timeout / GST_MSECOND / 4, 10, WATCHDOG_MAX_INTERVAL_MS);
+
+        camera->last_progress_us = g_get_monotonic_time();
+        camera->watchdog_id = g_timeout_add(interval, (GSourceFunc)watchdog_timeout, camera);
+    }
+    if (camera->abr && !camera->abr_id)
+        camera->abr_id = g_timeout_add(ABR_INTERVAL_MS, (GSourceFunc)abr_timeout, camera);
+    if (camera->motion && !camera->motion_id)
+        camera->motion_id = g_timeout_add(MOTION_INTERVAL_MS, (GSourceFunc)motion_timeout, camera);
+    if (camera->shm && !camera->shm_id)
+        camera->shm_id = g_timeout_add(SHM_INTERVAL_MS, (GSourceFunc)shm_timeout, camera);
+    return TRUE;
+}
+
+// 다시 만든 소스의 첫 버퍼: running time이 지금 파이프라인 시간과 같아지도록 패드 오프셋 설정.
+// HLS는 다시 연결하면 0 또는 플레이리스트 위치부터 시작하므로 그대로 두면 muxer에서 시간이 되감김
+static GstPadProbeReturn source_offset_probe(GstPad* pad, GstPadProbeInfo* info, Camera* camera) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstEvent* segment_event = gst_pad_get_sticky_event(pad, GST_EVENT_SEGMENT, 0);
+    GstClock* clock = gst_element_get_clock(camera->pipeline);
+    GstClockTime timestamp = GST_BUFFER_DTS_OR_PTS(buffer);
+
+    if (segment_event && clock && GST_CLOCK_TIME_IS_VALID(timestamp)) {
+        const GstSegment* segment;
+        GstClockTime running_time;
+        GstClockTime now = gst_clock_get_time(clock) - gst_element_get_base_time(camera->pipeline);
+
+        gst_event_parse_segment(segment_event, &segment);
+        running_time = gst_segment_to_running_time(segment, GST_FORMAT_TIME, timestamp);
+        if (GST_CLOCK_TIME_IS_VALID(running_time))
+            gst_pad_set_offset(pad, GST_CLOCK_DIFF(running_time, now));
+    }
+    if (segment_event)
+        gst_event_unref(segment_event);
+    if (clock)
+        gst_object_unref(clock);
+    return GST_PAD_PROBE_REMOVE;
+}
+
+// pad_added_handler 수정: uridecodebin에서 나오는 raw 패드를 공용 변환을 거쳐 Tee에 연결
+// (passthrough 모드에서는 H.264 패드를 파서에 연결)
+static void pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera) {
+    GstPad* tee_sink_pad = NULL;
+    GstPadLinkReturn ret;
+    GstCaps* new_pad_caps = NULL;
+    GstStructure* new_pad_struct = NULL;
+    const gchar* new_pad_type = NULL;
+    const gchar* wanted_type = camera->config->passthrough ? "video/x-h264" : "video/x-raw";
+    GstElement* target = camera->config->passthrough ? camera->video_parse : camera->video_convert;
+
+    // src가 uridecodebin인지 확인 (디버깅 목적)
+    g_print("[%s] Received new pad '%s' from '%s':\n", camera->name, GST_PAD_NAME(new_pad), GST_ELEMENT_NAME(src));
+
+    // 패드 캡 가져오기 (uridecodebin은 이미 디코딩된 raw 포맷 제공)
+    new_pad_caps = gst_pad_get_current_caps(new_pad);
+    if (!new_pad_caps) {
+        new_pad_caps = gst_pad_query_caps(new_pad, NULL);
+    }
+    if (!new_pad_caps) {
+        g_printerr("[%s] Could not get caps for new pad %s.\n", camera->name, GST_PAD_NAME(new_pad));
+        goto exit;
+    }
+    new_pad_struct = gst_caps_get_structure(new_pad_caps, 0);
+    new_pad_type = gst_structure_get_name(new_pad_struct);
+
+    // 비디오 패드 처리 (raw video 또는 passthrough 모드의 H.264)
+    if (g_str_has_prefix(new_pad_type, wanted_type)) {
+        // video_convert(또는 video_parse)의 싱크 패드 가져오기
+        tee_sink_pad = gst_element_get_static_pad(target, "sink");
+        if (!tee_sink_pad) {
+            g_printerr("[%s] Could not get sink pad from %s.\n", camera->name, GST_ELEMENT_NAME(target));
+            goto exit;
+        }
+        // 이미 연결되어 있는지 확인
+        if (gst_pad_is_linked(tee_sink_pad)) {
+            g_print("[%s] %s sink pad already linked. Ignoring new pad '%s'.\n", camera->name, GST_ELEMENT_NAME(target), GST_PAD_NAME(new_pad));
+            goto exit;
+        }
+        // 다시 만든 소스는 타임스탬프를 파이프라인의 현재 시간에 이어 붙임
+        if (camera->n_reconnects > 0)
+            gst_pad_add_probe(new_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)source_offset_probe, camera, NULL);
+        // 연결 시도
+        ret = gst_pad_link(new_pad, tee_sink_pad);
+        if (GST_PAD_LINK_FAILED(ret)) {
+            g_printerr("[%s] Link failed for video pad: %s\n", camera->name, gst_pad_link_get_name(ret));
+        }
+        else {
+            g_print("[%s] Link succeeded for video pad (type '%s').\n", camera->name, new_pad_type);
+        }
+    }
+    else if (camera->config->passthrough && g_str_has_prefix(new_pad_type, "video/x-raw")) {
+        g_printerr("[%s] Source video is not H.264 ('%s'); passthrough recording needs an H.264 stream.\n", camera->name, new_pad_type);
+    }
+    else {
+        g_print("[%s] Dropping unused stream '%s'.\n", camera->name, new_pad_type);
+        gst_pad_add_probe(new_pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+            (GstPadProbeCallback)unused_stream_probe, camera, NULL);
+    }
+
+exit:
+    // 자원 해제
+    if (new_pad_caps != NULL)
+        gst_caps_unref(new_pad_caps);
+    if (tee_sink_pad != NULL)
+        gst_object_unref(tee_sink_pad);
+}
+
+// passthrough 모드의 재생 브랜치: decodebin이 만든 raw 패드를 videoconvert에 연결
+static void display_pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera) {
+    GstPad* convert_sink_pad = gst_element_get_static_pad(camera->video_convert_display, "sink");
+    GstPadLinkReturn ret;
+
+    if (gst_pad_is_linked(convert_sink_pad)) {
+        g_print("[%s] Display converter already linked. Ignoring new pad '%s'.\n", camera->name, GST_PAD_NAME(new_pad));
+    }
+    else {
+        ret = gst_pad_link(new_pad, convert_sink_pad);
+        if (GST_PAD_LINK_FAILED(ret)) {
+            g_printerr("[%s] Link failed for decoded display pad: %s\n", camera->name, gst_pad_link_get_name(ret));
+        }
+    }
+    gst_object_unref(convert_sink_pad);
+}
+
+// passthrough 모드의 썸네일 브랜치: decodebin이 만든 raw 패드를 videorate에 연결
+static void thumbnail_pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera) {
+    GstPad* rate_sink_pad = gst_element_get_static_pad(camera->thumbnail_rate, "sink");
+    GstPadLinkReturn ret;
+
+    if (!gst_pad_is_linked(rate_sink_pad)) {
+        ret = gst_pad_link(new_pad, rate_sink_pad);
+        if (GST_PAD_LINK_FAILED(ret)) {
+            g_printerr("[%s] Link failed for decoded thumbnail pad: %s\n", camera->name, gst_pad_link_get_name(ret));
+        }
+    }
+    gst_object_unref(rate_sink_pad);
+}
+
+// passthrough 모드의 분석 브랜치: decodebin이 만든 raw 패드를 videorate에 연결
+static void motion_pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera) {
+    GstPad* rate_sink_pad = gst_element_get_static_pad(camera->motion_rate, "sink");
+    GstPadLinkReturn ret;
+
+    if (!gst_pad_is_linked(rate_sink_pad)) {
+        ret = gst_pad_link(new_pad, rate_sink_pad);
+        if (GST_PAD_LINK_FAILED(ret)) {
+            g_printerr("[%s] Link failed for decoded motion pad: %s\n", camera->name, gst_pad_link_get_name(ret));
+        }
+    }
+    gst_object_unref(rate_sink_pad);
+}
+
+// passthrough 모드의 공유 메모리 브랜치: decodebin이 만든 raw 패드를 shmsink에 연결
+static void shm_pad_added_handler(GstElement* src, GstPad* new_pad, Camera* camera) {
+    GstPad* shm_sink_pad = gst_element_get_static_pad(camera->shm_sink, "sink");
+    GstPadLinkReturn ret;
+
+    if (!gst_pad_is_linked(shm_sink_pad)) {
+        ret = gst_pad_link(new_pad, shm_sink_pad);
+        if (GST_PAD_LINK_FAILED(ret)) {
+            g_printerr("[%s] Link failed for decoded shared memory pad: %s\n", camera->name, gst_pad_link_get_name(ret));
+        }
+    }
+    gst_object_unref(shm_sink_pad);
+}
+
+// 연속 녹화 세그먼트 파일 이름: <출력 디렉터리>/<카메라>-<YYYYmmdd-HHMMSS>-<번호>.mp4
+static gchar* format_location_handler(GstElement* splitmux, guint fragment_id, Camera* camera) {
+    GDateTime* now = g_date_time_new_now_local();
+    gchar* stamp = g_date_time_format(now, "%Y%m%d-%H%M%S");
+    gchar* file_name = g_strdup_printf("%s-%s-%05u.mp4", camera->name, stamp, fragment_id);
+    gchar* location = g_build_filename(camera->config->output_dir, file_name, NULL);
+
+    g_atomic_int_inc(&camera->n_segments);
+    g_print("[%s] New segment: %s\n", camera->name, location);
+    g_free(file_name);
+    g_free(stamp);
+    g_date_time_unref(now);
+    return location;
+}
+
+static void camera_finish(Camera* camera) {
+    if (camera->finished)
+        return;
+    camera->finished = TRUE;
+    if (camera->finished_func)
+        camera->finished_func(camera, camera->finished_data);
+}
+
+// 소스 섹션만 떼어내고 backoff 뒤에 다시 만듦. 나머지 파이프라인(열린 클립의 muxer 포함)은 PLAYING 유지
+static gboolean source_reconnect(Camera* camera);
+
+static void source_lost(Camera* camera, const gchar* reason) {
+    if (camera->reconnect_id || camera->finished)
+        return;
+    // 연달아 실패해도 복구 시간은 처음 잃은 시각부터
+    if (!g_atomic_int_get(&camera->source_recovering))
+        camera->source_lost_us = g_get_monotonic_time();
+    g_printerr("[%s] Source %s; reconnecting in %.1f s...\n", camera->name, reason,
+        (gdouble)camera->reconnect_delay / GST_SECOND);
+    if (camera->uri_decode_bin) {
+        gst_element_set_state(camera->uri_decode_bin, GST_STATE_NULL);
+        gst_bin_remove(GST_BIN(camera->pipeline), camera->uri_decode_bin);
+        camera->uri_decode_bin = NULL;
+    }
+    // 이전 소스의 스트리밍 스레드가 모두 멈춘 뒤에 표시 (그 버퍼를 복구로 세지 않도록)
+    g_atomic_int_set(&camera->source_eos, FALSE);
+    g_atomic_int_set(&camera->source_recovering, TRUE);
+    camera->reconnect_id = g_timeout_add((guint)(camera->reconnect_delay / GST_MSECOND), (GSourceFunc)source_reconnect, camera);
+    camera->reconnect_delay = MIN(camera->reconnect_delay * 2, MAX(camera->config->reconnect_max_delay, SOURCE_RECONNECT_MIN_DELAY));
+}
+
+static gboolean source_reconnect(Camera* camera) {
+    camera->reconnect_id = 0;
+    camera->n_reconnects++;
+    g_print("[%s] Reconnecting source (attempt %u)...\n", camera->name, camera->n_reconnects);
+    if (!build_uri_source(camera) || !gst_element_sync_state_with_parent(camera->uri_decode_bin)) {
+        source_lost(camera, "could not be rebuilt");
+        return G_SOURCE_REMOVE;
+    }
+    // 새 소스에도 첫 프레임까지 감시 시간 전체를 줌
+    camera->last_progress_us = g_get_monotonic_time();
+    return G_SOURCE_REMOVE;
+}
+
+// 소스가 보낸 EOS는 tee 앞에서 버림 (스트리밍 스레드): 감시 타이머가 재연결
+static GstPadProbeReturn source_eos_probe(GstPad* pad, GstPadProbeInfo* info, Camera* camera) {
+    if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) != GST_EVENT_EOS)
+        return GST_PAD_PROBE_OK;
+    g_atomic_int_set(&camera->source_eos, TRUE);
+    return GST_PAD_PROBE_DROP;
+}
+
+// tee에 들어온 프레임 수가 source_timeout 동안 그대로면 소스가 멈춘 것으로 봄
+static gboolean watchdog_timeout(Camera* camera) {
+    gint frames = g_atomic_int_get(&camera->n_frames);
+    gint64 now = g_get_monotonic_time();
+
+    if (camera->finished) {
+        camera->watchdog_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    if (camera->reconnect_id)
+        return G_SOURCE_CONTINUE;
+    if (g_atomic_int_get(&camera->source_eos)) {
+        source_lost(camera, "ended");
+    }
+    else if (frames != camera->watchdog_frames) {
+        camera->watchdog_frames = frames;
+        camera->last_progress_us = now;
+        // 복구된 뒤에 다시 흐르기 시작하면 backoff 초기화
+        if (!g_atomic_int_get(&camera->source_recovering))
+            camera->reconnect_delay = SOURCE_RECONNECT_MIN_DELAY;
+    }
+    else if (now - camera->last_progress_us > (gint64)(camera->config->source_timeout / GST_USECOND)) {
+        source_lost(camera, "stalled");
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+// 움직임이 보이면 클립 시작 (start_recording과 같은 경로), motion_hold 동안 움직임이 없으면 그 클립만 정지
+static gboolean motion_timeout(Camera* camera) {
+    guint frames = motion_detector_get_motion_frames(camera->motion);
+    gint64 now = g_get_monotonic_time();
+
+    if (camera->finished) {
+        camera->motion_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    if (frames != camera->motion_seen) {
+        camera->motion_seen = frames;
+        camera->motion_last_us = now;
+        if (!camera->motion_clip && camera->preroll) {
+            camera->motion_clip = camera_start_clip(camera, 0);
+            if (camera->motion_clip) {
+                camera->n_motion_events++;
+                g_print("[%s] Motion detected: clip %u.\n", camera->name, camera->motion_clip);
+            }
+        }
+    }
+    else if (camera->motion_clip && now - camera->motion_last_us > (gint64)(camera->config->motion_hold / GST_USECOND)) {
+        g_print("[%s] No motion for %.1f s: stopping clip %u.\n", camera->name,
+            (gdouble)camera->config->motion_hold / GST_SECOND, camera->motion_clip);
+        // 이미 수동으로 멈춘 클립이면 FALSE
+        camera_stop_clip(camera, camera->motion_clip);
+        camera->motion_clip = 0;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+// 공유 메모리 영역을 잡고 놓지 않는 읽기 프로세스 정리
+static gboolean shm_timeout(Camera* camera) {
+    if (camera->finished) {
+        camera->shm_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    shm_output_check(camera->shm);
+    return G_SOURCE_CONTINUE;
+}
+
+// 실시간을 따라가는지 판정: 녹화 큐 적체(인코더가 밀림), 녹화 큐 overrun, 재생 큐 드롭, 재생 싱크 QoS
+static gboolean abr_timeout(Camera* camera) {
+    const ClipperConfig* config = camera->config;
+    GstClockTime lag_limit = config->record_queue_max_time > 0 ? config->record_queue_max_time / 2 : ABR_LAG_LIMIT;
+    guint64 level_time = 0;
+    guint display_drops, record_overruns;
+    gboolean lagging;
+
+    if (camera->finished) {
+        camera->abr_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    g_object_get(G_OBJECT(camera->video_queue_record), "current-level-time", &level_time, NULL);
+    camera_get_queue_stats(camera, &display_drops, &record_overruns);
+    lagging = level_time > lag_limit || record_overruns > camera->abr_record_overruns;
+    if (abr_policy_update(camera->abr, camera->uri_decode_bin, (gdouble)level_time / GST_MSECOND, lagging,
+        display_drops > camera->abr_display_drops ? display_drops - camera->abr_display_drops : 0)) {
+        guint cap = abr_policy_get_cap(camera->abr);
+        if (cap > 0)
+            g_print("[%s] ABR: behind real time (record queue %.0f ms), capping HLS variants at %u kbps.\n",
+                camera->name, (gdouble)level_time / GST_MSECOND, cap);
+        else
+            g_print("[%s] ABR: keeping up again, variant cap removed.\n", camera->name);
+    }
+    camera->abr_display_drops = display_drops;
+    camera->abr_record_overruns = record_overruns;
+    return G_SOURCE_CONTINUE;
+}
+
+// 에러가 떼어낸 이전 소스에서 온 것인지 (버스에 남아 있던 메시지)
+static gboolean is_orphan_message(Camera* camera, GstMessage* msg) {
+    GstObject* src = GST_MESSAGE_SRC(msg);
+    return src != GST_OBJECT(camera->pipeline) && !gst_object_has_as_ancestor(src, GST_OBJECT(camera->pipeline));
+}
+
+// 에러가 지금의 URI 소스 섹션에서 왔는지
+static gboolean is_source_message(Camera* camera, GstMessage* msg) {
+    GstObject* src = GST_MESSAGE_SRC(msg);
+    return camera->uri_decode_bin &&
+        (src == GST_OBJECT(camera->uri_decode_bin) || gst_object_has_as_ancestor(src, GST_OBJECT(camera->uri_decode_bin)));
+}
+
+// bus_call 구현: 카메라별 버스 메시지 처리
+static gboolean bus_call(GstBus* bus, GstMessage* msg, Camera* camera) {
+    switch (GST_MESSAGE_TYPE(msg)) {
+    case GST_MESSAGE_EOS:
+        g_print("[%s] End-of-stream\n", camera->name);
+        camera_finish(camera);
+        break;
+    case GST_MESSAGE_ERROR: {
+        gchar* debug = NULL;
+        GError* error = NULL;
+        gst_message_parse_error(msg, &error, &debug);
+        g_printerr("[%s] ERROR from element %s: %s\n", camera->name, GST_OBJECT_NAME(GST_MESSAGE_SRC(msg)), error->message);
+        g_printerr("[%s] Debugging info: %s\n", camera->name, (debug) ? debug : "none");
+        g_error_free(error);
+        g_free(debug);
+        if (camera->watchdog_id && is_orphan_message(camera, msg))
+            break;
+        if (camera->watchdog_id && is_source_message(camera, msg))
+            source_lost(camera, "failed");
+        else
+            camera_finish(camera);
+        break;
+    }
+    case GST_MESSAGE_WARNING: {
+        gchar* debug = NULL;
+        GError* error = NULL;
+        gst_message_parse_warning(msg, &error, &debug);
+        g_printerr("[%s] WARNING from element %s: %s\n", camera->name, GST_OBJECT_NAME(GST_MESSAGE_SRC(msg)), error->message);
+        g_printerr("[%s] Debugging info: %s\n", camera->name, (debug) ? debug : "none");
+        g_error_free(error);
+        g_free(debug);
+        break;
+    }
+    case GST_MESSAGE_STATE_CHANGED: {
+        if (GST_MESSAGE_SRC(msg) == GST_OBJECT(camera->pipeline)) {
+            GstState old_state, new_state, pending_state;
+            gst_message_parse_state_changed(msg, &old_state, &new_state, &pending_state);
+            g_print("[%s] Pipeline state changed from %s to %s:\n", camera->name,
+                gst_element_state_get_name(old_state), gst_element_state_get_name(new_state));
+        }
+        break;
+    }
+    case GST_MESSAGE_QOS:
+        // 재생 싱크가 늦은 버퍼를 버림
+        if (camera->abr)
+            abr_policy_add_qos(camera->abr, msg);
+        break;
+    case GST_MESSAGE_ASYNC_DONE:
+        // 첫 프리롤 완료 (이후의 ASYNC_DONE은 클립 bin 등)
+        if (GST_MESSAGE_SRC(msg) == GST_OBJECT(camera->pipeline) && camera->startup.preroll_us == 0 && camera->startup.play_at_us > 0)
+            camera->startup.preroll_us = g_get_monotonic_time() - camera->startup.play_at_us;
+        break;
+    case GST_MESSAGE_STREAM_STATUS: {
+        // 스트리밍 스레드 수 집계 (호스트 사이징용, CPU 배치는 bus_sync_handler에서)
+        GstStreamStatusType type;
+        GstElement* owner;
+        gst_message_parse_stream_status(msg, &type, &owner);
+        if (type == GST_STREAM_STATUS_TYPE_ENTER)
+            camera->n_threads++;
+        else if (type == GST_STREAM_STATUS_TYPE_LEAVE)
+            camera->n_threads--;
+        break;
+    }
+    default:
+        break;
+    }
+    return TRUE;
+}
+
+// 메시지를 보낸 스레드에서 호출됨 (--cpus/--thread-nice일 때만 설치). 메시지는 그대로 bus_call로 넘김
+static GstBusSyncReply bus_sync_handler(GstBus* bus, GstMessage* msg, Camera* camera) {
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_STREAM_STATUS)
+        affinity_pool_handle_stream_status(camera->affinity, msg);
+    return GST_BUS_PASS;
+}
+
+// 클립 하나: 녹화를 시작할 때 클립 tee에 붙이는 queue + mp4mux + filesink bin.
+// 여러 클립이 같은 인코딩 스트림(인코더 하나)과 프리롤 링을 공유하며 동시에 기록될 수 있다.
+// 시작: 링이 이 브랜치로만 키프레임부터 내보냄 (재인코딩 모드는 IDR 요청)
+// 정지: GOP 경계에서 브랜치가 멈추면 tee 패드를 반납하고 EOS를 보내 이 클립만 마무리
+struct _CameraClip {
+    Camera* camera;
+    guint id;
+    GstElement* bin;
+    GstElement* queue;
+    GstElement* muxer;
+    GstElement* sink;
+    GstPad* sink_pad;               // bin의 ghost sink 패드
+    GstPad* tee_pad;                // 클립 tee의 요청 패드 (떼어낼 때 반납)
+    PrerollBranch* branch;
+    gchar* location;
+    gint64 requested_at;            // 녹화 시작 명령 시각 (monotonic)
+    gint started;                   // 첫 프레임이 muxer에 도착함 (스트리밍 스레드에서 설정)
+    gint start_us;                  // 녹화 시작 명령 ~ 첫 키프레임이 muxer에 도착 (us)
+    gboolean stopping;              // 정지 요청됨 (GOP 경계/EOS 대기)
+    gint draining;                  // 우리가 보낸 EOS를 기다리는 중
+    guint idle_id;                  // 대기 중인 메인 루프 콜백
+    guint timeout_id;               // 길이를 정한 클립의 자동 정지
+    gint64 remove_us;               // 브랜치 제거에 쓴 메인 스레드 시간 (EOS 대기 제외)
+};
+
+// 재인코딩 모드: 인코더에 즉시 IDR(+SPS/PPS)을 요청 (gst_video_event_new_upstream_force_key_unit과 같은 이벤트)
+static void request_keyframe(Camera* camera) {
+    GstStructure* structure;
+
+    // passthrough 모드에서는 카메라의 GOP를 따름
+    if (!camera->video_encoder)
+        return;
+    structure = gst_structure_new("GstForceKeyUnit",
+        "running-time", GST_TYPE_CLOCK_TIME, GST_CLOCK_TIME_NONE,
+        "all-headers", G_TYPE_BOOLEAN, TRUE,
+        "count", G_TYPE_UINT, camera->n_clips,
+        NULL);
+    gst_element_send_event(camera->video_encoder, gst_event_new_custom(GST_EVENT_CUSTOM_UPSTREAM, structure));
+}
+
+static void record_branch_time(gint64 elapsed, guint* count, gint64* total, gint64* max) {
+    (*count)++;
+    *total += elapsed;
+    if (elapsed > *max)
+        *max = elapsed;
+}
+
+static void clip_free(CameraClip* clip) {
+    if (!clip)
+        return;
+    if (clip->idle_id)
+        g_source_remove(clip->idle_id);
+    if (clip->timeout_id)
+        g_source_remove(clip->timeout_id);
+    // tee 패드를 반납한 뒤에 probe를 제거 (스트리밍 스레드가 브랜치를 쓰는 중일 수 있음)
+    preroll_branch_free(clip->branch);
+    if (clip->tee_pad)
+        gst_object_unref(clip->tee_pad);
+    if (clip->sink_pad)
+        gst_object_unref(clip->sink_pad);
+    g_free(clip->location);
+    g_free(clip);
+}
+
+// 첫 버퍼(항상 키프레임)가 클립에 도착: 명령 ~ 재생 가능한 첫 프레임까지의 시간 기록
+static GstPadProbeReturn clip_first_frame_probe(GstPad* pad, GstPadProbeInfo* info, CameraClip* clip) {
+    Camera* camera = clip->camera;
+    gint elapsed = (gint)MIN(g_get_monotonic_time() - clip->requested_at, G_MAXINT);
+
+    g_atomic_int_set(&clip->start_us, elapsed);
+    g_atomic_int_set(&clip->started, TRUE);
+    if (elapsed > g_atomic_int_get(&camera->clip_start_max_us))
+        g_atomic_int_set(&camera->clip_start_max_us, elapsed);
+    g_print("[%s] Clip %u: first frame after %.1f ms.\n", camera->name, clip->id, elapsed / 1000.0);
+    return GST_PAD_PROBE_REMOVE;
+}
+
+static gboolean clip_finished_idle(CameraClip* clip) {
+    Camera* camera = clip->camera;
+    gint64 start = g_get_monotonic_time();
+
+    clip->idle_id = 0;
+    gst_element_set_state(clip->bin, GST_STATE_NULL);
+    gst_bin_remove(GST_BIN(camera->pipeline), clip->bin);
+    // 제거 시간 = 패드 반납 + bin 정리 (EOS를 기다리는 시간은 제외)
+    clip->remove_us += g_get_monotonic_time() - start;
+    record_branch_time(clip->remove_us, &camera->branch_stats.removes, &camera->branch_stats.remove_us_total,
+        &camera->branch_stats.remove_us_max);
+    // --async-writer: 남은 데이터는 쓰기 스레드가 마저 쓰고 닫음
+    g_print("[%s] Clip %u saved: %s%s\n", camera->name, clip->id, clip->location, camera->writer ? " (writer finishing)" : "");
+    camera->clips = g_list_remove(camera->clips, clip);
+    clip_free(clip);
+    return G_SOURCE_REMOVE;
+}
+
+// filesink 앞에서 우리가 보낸 EOS를 가로챔: muxer는 이미 파일을 마무리했고,
+// filesink까지 EOS가 가면 파이프라인 전체 EOS로 집계될 수 있음
+static GstPadProbeReturn clip_eos_probe(GstPad* pad, GstPadProbeInfo* info, CameraClip* clip) {
+    if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) != GST_EVENT_EOS || !g_atomic_int_get(&clip->draining))
+        return GST_PAD_PROBE_OK;
+    clip->idle_id = g_idle_add((GSourceFunc)clip_finished_idle, clip);
+    return GST_PAD_PROBE_DROP;
+}
+
+static gboolean clip_detach_idle(CameraClip* clip) {
+    Camera* camera = clip->camera;
+    gint64 start = g_get_monotonic_time();
+
+    clip->idle_id = 0;
+    // 게이트가 이미 닫혀 있으므로 다른 클립/재생 브랜치를 멈추지 않고 패드만 반납
+    gst_pad_unlink(clip->tee_pad, clip->sink_pad);
+    gst_element_release_request_pad(camera->record_tee, clip->tee_pad);
+    g_atomic_int_set(&clip->draining, TRUE);
+    // 이 브랜치에만 EOS: muxer가 moov(또는 마지막 조각)를 쓰고 filesink 앞 probe에서 멈춤
+    gst_pad_send_event(clip->sink_pad, gst_event_new_eos());
+    clip->remove_us = g_get_monotonic_time() - start;
+    return G_SOURCE_REMOVE;
+}
+
+// 브랜치가 GOP 경계에서 멈춤 (스트리밍 스레드일 수 있음)
+static void clip_stopped(PrerollBranch* branch, CameraClip* clip) {
+    clip->idle_id = g_idle_add((GSourceFunc)clip_detach_idle, clip);
+}
+
+static void clip_stop(CameraClip* clip) {
+    Camera* camera = clip->camera;
+
+    if (clip->stopping)
+        return;
+    clip->stopping = TRUE;
+    if (clip->timeout_id) {
+        g_source_remove(clip->timeout_id);
+        clip->timeout_id = 0;
+    }
+    camera->n_active_clips--;
+    camera->recording = camera->n_active_clips > 0;
+    g_print("[%s] Stopping clip %u at the next keyframe...\n", camera->name, clip->id);
+    // 다음 키프레임 직전에서 끊으므로 GOP 경계를 바로 만들어 달라고 요청
+    request_keyframe(camera);
+    preroll_branch_stop(clip->branch, (PrerollStoppedFunc)clip_stopped, clip);
+}
+
+static gboolean clip_timeout(CameraClip* clip) {
+    clip->timeout_id = 0;
+    clip_stop(clip);
+    return G_SOURCE_REMOVE;
+}
+
+static CameraClip* clip_new(Camera* camera) {
+    const ClipperConfig* config = camera->config;
+    CameraClip* clip;
+    GstPad* queue_pad;
+    GstPad* sink_pad;
+    GDateTime* now;
+    gchar* stamp;
+    gchar* file_name;
+    gchar* bin_name;
+
+    clip = g_new0(CameraClip, 1);
+    clip->camera = camera;
+    clip->id = ++camera->n_clips;
+    clip->requested_at = g_get_monotonic_time();
+    bin_name = g_strdup_printf("clip%u", clip->id);
+    clip->bin = gst_bin_new(bin_name);
+    g_free(bin_name);
+    clip->queue = make_element(camera, "queue", NULL);
+    clip->muxer = make_element(camera, "mp4mux", NULL);
+    clip->sink = camera->writer ? file_writer_make_sink(camera->writer, NULL) : make_element(camera, "filesink", NULL);
+    if (!clip->queue || !clip->muxer || !clip->sink) {
+        if (clip->queue)
+            gst_object_unref(clip->queue);
+        if (clip->muxer)
+            gst_object_unref(clip->muxer);
+        if (clip->sink)
+            gst_object_unref(clip->sink);
+        gst_object_unref(clip->bin);
+        g_free(clip);
+        return NULL;
+    }
+
+    // 클립마다 별도 파일: <출력 디렉터리>/<카메라>-clip-<YYYYmmdd-HHMMSS>-<번호>.mp4
+    now = g_date_time_new_now_local();
+    stamp = g_date_time_format(now, "%Y%m%d-%H%M%S");
+    file_name = g_strdup_printf("%s-clip-%s-%03u.mp4", camera->name, stamp, clip->id);
+    clip->location = g_build_filename(config->output_dir, file_name, NULL);
+    g_free(file_name);
+    g_free(stamp);
+    g_date_time_unref(now);
+    g_object_set(G_OBJECT(clip->sink), "location", clip->location, NULL);
+    if (config->fragment_duration > 0) {
+        // 프로세스가 죽어도 마지막 조각 이전까지는 재생 가능하도록 fragmented MP4로 기록
+        g_object_set(G_OBJECT(clip->muxer), "fragment-duration", config->fragment_duration, NULL);
+    }
+    // 프리롤 구간을 한 번에 받고, 디스크가 느린 클립이 다른 클립을 막지 않도록 클립마다 스레드 분리
+    g_object_set(G_OBJECT(clip->queue),
+        "max-size-buffers", 0,
+        "max-size-time", (guint64)0,
+        "max-size-bytes", config->preroll_max_bytes > G_MAXUINT ? G_MAXUINT : (guint)config->preroll_max_bytes,
+        NULL);
+
+    gst_bin_add_many(GST_BIN(clip->bin), clip->queue, clip->muxer, clip->sink, NULL);
+    gst_element_link_many(clip->queue, clip->muxer, clip->sink, NULL);
+    queue_pad = gst_element_get_static_pad(clip->queue, "sink");
+    clip->sink_pad = gst_ghost_pad_new("sink", queue_pad);
+    gst_object_unref(queue_pad);
+    gst_object_ref(clip->sink_pad); // bin이 제거된 뒤에도 패드를 쓰므로 참조 유지
+    gst_pad_set_active(clip->sink_pad, TRUE);
+    gst_element_add_pad(clip->bin, clip->sink_pad);
+    gst_pad_add_probe(clip->sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)clip_first_frame_probe, clip, NULL);
+    sink_pad = gst_element_get_static_pad(clip->sink, "sink");
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, (GstPadProbeCallback)clip_eos_probe, clip, NULL);
+    gst_object_unref(sink_pad);
+
+    // tee 패드에 게이트(닫힌 상태)를 먼저 붙이고 연결, bin을 PLAYING으로 올린 뒤에 시작
+    gst_bin_add(GST_BIN(camera->pipeline), clip->bin);
+    clip->tee_pad = gst_element_request_pad_simple(camera->record_tee, "src_%u");
+    clip->branch = clip->tee_pad ? preroll_branch_new(camera->preroll, clip->tee_pad) : NULL;
+    if (!clip->branch || gst_pad_link(clip->tee_pad, clip->sink_pad) != GST_PAD_LINK_OK) {
+        g_printerr("[%s] Clip tee could not be linked to the clip muxer.\n", camera->name);
+        if (clip->tee_pad)
+            gst_element_release_request_pad(camera->record_tee, clip->tee_pad);
+        gst_bin_remove(GST_BIN(camera->pipeline), clip->bin);
+        clip_free(clip);
+        return NULL;
+    }
+    gst_element_sync_state_with_parent(clip->bin);
+    return clip;
+}
+
+guint camera_start_clip(Camera* camera, guint duration) {
+    CameraClip* clip;
+    gint64 start = g_get_monotonic_time();
+
+    if (!camera->preroll) {
+        g_print("[%s] Continuous recording is always on.\n", camera->name);
+        return 0;
+    }
+    clip = clip_new(camera);
+    if (!clip)
+        return 0;
+    camera->clips = g_list_append(camera->clips, clip);
+    camera->n_active_clips++;
+    camera->recording = TRUE;
+    g_print("[%s] Starting clip %u: %s\n", camera->name, clip->id, clip->location);
+    preroll_branch_start(clip->branch);
+    // 프리롤이 없거나 링에 키프레임이 없을 때 GOP가 끝날 때까지 기다리지 않도록
+    request_keyframe(camera);
+    if (duration > 0)
+        clip->timeout_id = g_timeout_add_seconds(duration, (GSourceFunc)clip_timeout, clip);
+    record_branch_time(g_get_monotonic_time() - start, &camera->branch_stats.adds, &camera->branch_stats.add_us_total,
+        &camera->branch_stats.add_us_max);
+    return clip->id;
+}
+
+gboolean camera_stop_clip(Camera* camera, guint id) {
+    GList* l;
+
+    for (l = camera->clips; l != NULL; l = l->next) {
+        CameraClip* clip = l->data;
+        if (clip->id == id && !clip->stopping) {
+            clip_stop(clip);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void camera_start_recording(Camera* camera) {
+    camera_start_clip(camera, 0);
+}
+
+// 녹화 중인 모든 클립 정지
+void camera_stop_recording(Camera* camera) {
+    GList* l;
+
+    if (!camera->preroll) {
+        g_print("[%s] Continuous recording is always on.\n", camera->name);
+        return;
+    }
+    for (l = camera->clips; l != NULL; l = l->next) {
+        CameraClip* clip = l->data;
+        if (!clip->stopping)
+            clip_stop(clip);
+    }
+}
+
+void camera_toggle_recording(Camera* camera) {
+    if (camera->recording) camera_stop_recording(camera);
+    else camera_start_recording(camera);
+}
+
+gboolean camera_set_preroll(Camera* camera, GstClockTime preroll) {
+    if (!camera->preroll)
+        return FALSE;
+    preroll_buffer_set_preroll(camera->preroll, preroll);
+    return TRUE;
+}
+
+// 가장 최근에 시작한 클립 (겹친 클립들 중 마지막, 없으면 NULL)
+static CameraClip* latest_clip(Camera* camera) {
+    GList* last = g_list_last(camera->clips);
+
+    return last ? last->data : NULL;
+}
+
+void camera_append_status_json(Camera* camera, GString* json) {
+    CameraClip* latest = latest_clip(camera);
+    GstState state = GST_STATE_NULL;
+    gchar* name = g_strescape(camera->name, NULL);
+    GList* l;
+
+    gst_element_get_state(camera->pipeline, &state, NULL, 0);
+    g_string_append_printf(json,
+        "{\"camera\":\"%s\",\"state\":\"%s\",\"mode\":\"%s\",\"recording\":%s,\"closing\":%s,"
+        "\"active_clips\":%u,\"clips\":%u,\"clip_started\":%s,\"clip_start_ms\":%.3f,\"clip_start_max_ms\":%.3f,"
+        "\"preroll_s\":%.3f,\"segments\":%d,\"worker_threads\":%u,\"skipped_decoders\":%d,\"unused_buffers\":%d,\"source\":\"%s\",\"reconnects\":%u,\"recovery_ms\":%.3f,\"recovery_max_ms\":%.3f,"
+        "\"startup\":{\"create_ms\":%.3f,\"link_ms\":%.3f,\"preroll_ms\":%.3f,\"first_frame_ms\":%.3f}",
+        name, gst_element_state_get_name(state),
+        camera->preroll ? "clip" : "continuous",
+        camera->recording ? "true" : "false",
+        g_list_length(camera->clips) > camera->n_active_clips ? "true" : "false",
+        camera->n_active_clips, camera->n_clips, latest && g_atomic_int_get(&latest->started) ? "true" : "false",
+        latest ? g_atomic_int_get(&latest->start_us) / 1000.0 : 0.0, g_atomic_int_get(&camera->clip_start_max_us) / 1000.0,
+        camera->preroll ? (gdouble)preroll_buffer_get_preroll(camera->preroll) / GST_SECOND : 0.0,
+        g_atomic_int_get(&camera->n_segments), camera->worker_threads,
+        g_atomic_int_get(&camera->n_skipped_decoders), g_atomic_int_get(&camera->n_unused_buffers),
+        g_atomic_int_get(&camera->source_recovering) ? "reconnecting" : "ok", camera->n_reconnects,
+        g_atomic_int_get(&camera->recovery_us) / 1000.0, g_atomic_int_get(&camera->recovery_max_us) / 1000.0,
+        camera->startup.create_us / 1000.0, camera->startup.link_us / 1000.0, camera->startup.preroll_us / 1000.0,
+        g_atomic_int_get(&camera->startup.first_frame_us) / 1000.0);
+    // 클립마다 시작 지연 (겹친 클립이 서로의 값을 덮어쓰지 않음)
+    g_string_append(json, ",\"clip_list\":[");
+    for (l = camera->clips; l; l = l->next) {
+        CameraClip* clip = l->data;
+
+        g_string_append_printf(json, "%s{\"id\":%u,\"started\":%s,\"start_ms\":%.3f,\"stopping\":%s}",
+            l != camera->clips ? "," : "", clip->id, g_atomic_int_get(&clip->started) ? "true" : "false",
+            g_atomic_int_get(&clip->start_us) / 1000.0, clip->stopping ? "true" : "false");
+    }
+    g_string_append_c(json, ']');
+    if (camera->preroll) {
+        guint flushes;
+        guint64 flushed_buffers;
+
+        preroll_buffer_get_flush_stats(camera->preroll, &flushes, &flushed_buffers);
+        g_string_append_printf(json, ",\"preroll_flushes\":%u,\"preroll_flushed_buffers\":%" G_GUINT64_FORMAT, flushes, flushed_buffers);
+    }
+    if (camera->abr) {
+        g_string_append(json, ",\"abr\":");
+        abr_policy_append_json(camera->abr, json);
+    }
+    if (camera->motion) {
+        g_string_append_printf(json, ",\"motion_events\":%u,\"motion\":", camera->n_motion_events);
+        motion_detector_append_json(camera->motion, json);
+    }
+    if (camera->shm) {
+        g_string_append(json, ",\"shm\":");
+        shm_output_append_json(camera->shm, json);
+    }
+    if (camera->writer) {
+        g_string_append(json, ",\"writer\":");
+        file_writer_append_json(camera->writer, json);
+    }
+    if (camera->affinity) {
+        g_string_append(json, ",\"affinity\":");
+        affinity_pool_append_json(camera->affinity, json);
+    }
+    if (camera->frame_pools) {
+        g_string_append(json, ",\"frame_pools\":");
+        frame_pools_append_json(camera->frame_pools, json);
+    }
+    g_string_append_c(json, '}');
+    g_free(name);
+}
+
+void camera_get_conversion_stats(Camera* camera, guint* frames, guint* conversions) {
+    *frames = (guint)g_atomic_int_get(&camera->n_frames);
+    *conversions = (guint)g_atomic_int_get(&camera->n_conversions);
+}
+
+void camera_get_queue_stats(Camera* camera, guint* display_drops, guint* record_overruns) {
+    guint level = 0;
+    gint in, out;
+
+    *display_drops = 0;
+    if (camera->video_queue_display) {
+        // 카운터와 점유량을 따로 읽으므로 잠깐 음수가 될 수 있음
+        in = g_atomic_int_get(&camera->display_counters.in);
+        out = g_atomic_int_get(&camera->display_counters.out);
+        g_object_get(G_OBJECT(camera->video_queue_display), "current-level-buffers", &level, NULL);
+        *display_drops = (guint)MAX(in - out - (gint)level, 0);
+    }
+    *record_overruns = (guint)g_atomic_int_get(&camera->record_counters.overruns);
+}
+
+void camera_print_report(Camera* camera) {
+    GstState state = GST_STATE_NULL;
+    guint display_bytes = 0, record_bytes = 0;
+    guint preroll_buffers = 0;
+    guint64 preroll_bytes = 0;
+    GstClockTime preroll_duration = 0;
+    guint frames = 0, conversions = 0;
+    guint display_drops = 0, record_overruns = 0;
+
+    camera_get_conversion_stats(camera, &frames, &conversions);
+    camera_get_queue_stats(camera, &display_drops, &record_overruns);
+    gst_element_get_state(camera->pipeline, &state, NULL, 0);
+    if (camera->video_queue_display)
+        g_object_get(G_OBJECT(camera->video_queue_display), "current-level-bytes", &display_bytes, NULL);
+    g_object_get(G_OBJECT(camera->video_queue_record), "current-level-bytes", &record_bytes, NULL);
+
+    if (camera->preroll) {
+        CameraClip* latest = latest_clip(camera);
+        guint flushes;
+        guint64 flushed_buffers;
+
+        preroll_buffer_get_stats(camera->preroll, &preroll_buffers, &preroll_bytes, &preroll_duration);
+        preroll_buffer_get_flush_stats(camera->preroll, &flushes, &flushed_buffers);
+        g_print("[%s] state=%s recording=%s clips=%u/%u clip-start=%.1f ms (max %.1f) threads=%d queued=%u+%u B drops=%u record-overruns=%u conversions=%u/%u frames preroll=%u bufs/%" G_GUINT64_FORMAT " B/%.1f s flushed=%" G_GUINT64_FORMAT " bufs in %u clips\n",
+            camera->name, gst_element_state_get_name(state), camera->recording ? "yes" : "no", camera->n_active_clips, camera->n_clips,
+            latest ? g_atomic_int_get(&latest->start_us) / 1000.0 : 0.0, g_atomic_int_get(&camera->clip_start_max_us) / 1000.0,
+            camera->n_threads, display_bytes, record_bytes, display_drops, record_overruns, conversions, frames,
+            preroll_buffers, preroll_bytes, (gdouble)preroll_duration / GST_SECOND, flushed_buffers, flushes);
+    }
+    else {
+        g_print("[%s] state=%s continuous segments=%d threads=%d queued=%u+%u B drops=%u record-overruns=%u conversions=%u/%u frames\n",
+            camera->name, gst_element_state_get_name(state), g_atomic_int_get(&camera->n_segments),
+            camera->n_threads, display_bytes, record_bytes, display_drops, record_overruns, conversions, frames);
+    }
+    if (camera->frame_pools) {
+        GString* pools_json = g_string_new(NULL);
+        frame_pools_append_json(camera->frame_pools, pools_json);
+        g_print("[%s] frame-pools=%s\n", camera->name, pools_json->str);
+        g_string_free(pools_json, TRUE);
+    }
+    if (camera->abr) {
+        GString* abr_json = g_string_new(NULL);
+        abr_policy_append_json(camera->abr, abr_json);
+        g_print("[%s] abr=%s\n", camera->name, abr_json->str);
+        g_string_free(abr_json, TRUE);
+    }
+    if (camera->writer) {
+        GString* writer_json = g_string_new(NULL);
+        file_writer_append_json(camera->writer, writer_json);
+        g_print("[%s] writer=%s\n", camera->name, writer_json->str);
+        g_string_free(writer_json, TRUE);
+    }
+    if (camera->affinity) {
+        GString* affinity_json = g_string_new(NULL);
+        affinity_pool_append_json(camera->affinity, affinity_json);
+        g_print("[%s] affinity=%s\n", camera->name, affinity_json->str);
+        g_string_free(affinity_json, TRUE);
+    }
+    if (camera->motion) {
+        GString* motion_json = g_string_new(NULL);
+        motion_detector_append_json(camera->motion, motion_json);
+        g_print("[%s] motion-events=%u motion=%s\n", camera->name, camera->n_motion_events, motion_json->str);
+        g_string_free(motion_json, TRUE);
+    }
+    if (camera->n_reconnects > 0 || g_atomic_int_get(&camera->source_recovering)) {
+        g_print("[%s] source=%s reconnects=%u recovery=%.1f ms (max %.1f)\n", camera->name,
+            g_atomic_int_get(&camera->source_recovering) ? "reconnecting" : "ok", camera->n_reconnects,
+            g_atomic_int_get(&camera->recovery_us) / 1000.0, g_atomic_int_get(&camera->recovery_max_us) / 1000.0);
+    }
+}
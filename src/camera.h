@@ -0,0 +1,256 @@
+#ifndef CLIPPER_CAMERA_H
+#define CLIPPER_CAMERA_H
+
+#include <gst/gst.h>
+
+#include "abr.h"
+#include "affinity.h"
+#include "filewriter.h"
+#include "framepool.h"
+#include "metrics.h"
+#include "motion.h"
+#include "preroll.h"
+#include "shmout.h"
+#include "workers.h"
+
+G_BEGIN_DECLS
+
+// "test:" 로 시작하는 URI는 videotestsrc로 대체 (예: "test:", "test:ball")
+#define CAMERA_TEST_URI_PREFIX "test:"
+
+typedef enum {
+    RECORD_MODE_CLIP,               // 'r'로 토글하는 클립 녹화 (프리롤 포함)
+    RECORD_MODE_CONTINUOUS,         // splitmuxsink로 항상 녹화, 세그먼트 단위로 파일 분할
+} RecordMode;
+
+// tee 브랜치 큐 하나의 버퍼 수 (스트리밍 스레드에서 원자적으로 증가)
+typedef struct _QueueCounters {
+    gint in;
+    gint out;
+    gint overruns;                  // 큐가 가득 찬 횟수 (재생: 버림, 녹화: tee가 기다림)
+} QueueCounters;
+
+// 클립 브랜치(tee 패드 + mux/sink bin) 추가/제거에 메인 루프가 쓴 시간
+typedef struct _CameraBranchStats {
+    guint adds;
+    guint removes;
+    gint64 add_us_total;
+    gint64 add_us_max;
+    gint64 remove_us_total;         // 패드 반납 + bin 정리 (EOS 대기 제외)
+    gint64 remove_us_max;
+} CameraBranchStats;
+
+// 카메라 시작 구간별 시간 (us)
+typedef struct _CameraStartupStats {
+    gint64 create_us;               // 엘리먼트 생성 (gst_element_factory_make)
+    gint64 link_us;                 // 속성 설정 + bin 추가 + 연결 + probe
+    gint64 play_at_us;              // camera_play 호출 시각 (monotonic)
+    gint64 preroll_us;              // PLAYING 요청 ~ 첫 ASYNC_DONE (프리롤 완료)
+    gint first_frame_us;            // PLAYING 요청 ~ 첫 프레임이 tee에 도착 (스트리밍 스레드에서 설정)
+} CameraStartupStats;
+
+// 모든 카메라가 공유하는 설정
+typedef struct _ClipperConfig {
+    gboolean passthrough;           // 카메라의 H.264를 재인코딩 없이 그대로 녹화
+    GstClockTime preroll;
+    GstClockTime preroll_max_time;
+    guint64 preroll_max_bytes;
+
+    RecordMode record_mode;
+    GstClockTime segment_max_time;  // 연속 녹화 세그먼트 최대 길이 (0 = 제한 없음)
+    guint64 segment_max_bytes;      // 연속 녹화 세그먼트 최대 크기 (0 = 제한 없음)
+    guint fragment_duration;        // fragmented MP4 조각 길이 (ms, 0 = 일반 MP4)
+    const gchar* output_dir;
+    const gchar* encoder_profile;   // 재인코딩 모드의 x264enc 프로파일 (NULL = x264enc 기본값)
+    // 녹화 파일을 filesink 대신 쓰기 스레드로 모아 씀 (muxer 스트리밍 스레드는 디스크 입출력을 하지 않음)
+    gboolean async_writer;
+    guint writer_chunk_bytes;       // 한 번에 쓰는 단위 (블록 크기 배수로 맞춤)
+    guint64 writer_max_inflight;    // 카메라별 아직 쓰지 않은 바이트 상한 (넘으면 muxer가 기다림)
+    guint64 writer_sync_bytes;      // 이만큼 쓸 때마다 fdatasync (0 = 바이트 기준 없음)
+    GstClockTime writer_sync_interval;  // 이 시간마다 fdatasync (0 = 시간 기준 없음, 둘 다 0이면 동기화하지 않음)
+
+    // tee 브랜치 큐 상한 (0 = 제한 없음). 재생 큐는 넘치면 오래된 프레임을 버리고, 녹화 큐는 버리지 않음
+    guint display_queue_max_bytes;
+    GstClockTime display_queue_max_time;
+    guint record_queue_max_bytes;
+    GstClockTime record_queue_max_time;
+
+    gboolean metrics;               // 엘리먼트 경계별 계측 probe 설치 (끄면 비용 없음)
+
+    // URI 소스 감시: 이 시간 동안 tee에 프레임이 없거나 소스 에러가 나면 uridecodebin만 다시 만듦 (0 = 에러 시 종료)
+    GstClockTime source_timeout;
+    GstClockTime reconnect_max_delay;   // 재연결 간격은 두 배씩 늘어나 이 값에서 멈춤
+    gboolean abr;                   // 실시간을 못 따라가면 HLS variant 상한을 낮춤 (재인코딩 모드만)
+
+    gboolean headless;              // 재생 브랜치를 아예 만들지 않음 (서버 배포용)
+    guint thumbnail_interval;       // N초마다 JPEG 썸네일 한 장 (0 = 끔)
+    // 움직임 감지 브랜치: 160x90 GRAY8 @ 5fps로 줄여 프레임 차분, 움직임이 있으면 클립 시작
+    gboolean motion;
+    gdouble motion_min_area;        // 움직임으로 볼 바뀐 픽셀 비율 (0~1)
+    GstClockTime motion_hold;       // 움직임이 없어지고 이만큼 지나면 클립 정지
+    gdouble motion_cpu_budget;      // 분석 브랜치 스레드가 쓸 수 있는 코어 비율 (0~1)
+    // 공유 메모리 브랜치: 디코딩된 프레임을 <shm_dir>/shm-<카메라>.sock 으로 다른 프로세스에 내보냄 (NULL = 끔)
+    const gchar* shm_dir;
+    guint shm_frames;               // 공유 메모리 영역에 담을 프레임 수
+    GstClockTime shm_reader_timeout;    // 이 시간 동안 못 내보내면 읽기 프로세스 연결을 끊음 (0 = 끊지 않음)
+
+    // 변환/축소 엘리먼트의 n-threads (브랜치별, 0/1 = 스트리밍 스레드만). 추가 스레드는 workers 예산에서 받음
+    guint convert_threads;          // 재인코딩 모드의 tee 앞 공용 videoconvert
+    guint display_threads;          // 재생 브랜치 videoconvert
+    guint record_threads;           // 녹화 브랜치 videoscale (ABR)
+    gboolean decode_all_streams;    // 쓰지 않는 오디오/자막도 디코딩 (이전 동작, 비교용)
+    guint frame_pool_min;           // raw 프레임 풀을 제안할 때 미리 할당할 버퍼 수 (0 = 제안하지 않고 집계만)
+
+    const gchar* display_sink;      // 재생 싱크 팩토리 이름 (NULL = autovideosink)
+    gint test_width;                // videotestsrc 해상도 (0 = 기본값)
+    gint test_height;
+} ClipperConfig;
+
+typedef struct _Camera Camera;
+typedef struct _CameraClip CameraClip;
+
+// 카메라 파이프라인이 EOS 또는 에러로 끝났을 때 호출됨 (메인 루프 스레드)
+typedef void (*CameraFinishedFunc)(Camera* camera, gpointer user_data);
+
+// 카메라 하나의 파이프라인과 녹화 상태
+struct _Camera {
+    gchar* name;
+    gchar* uri;
+    const ClipperConfig* config;
+
+    GstElement* pipeline;
+    GstElement* uri_decode_bin;
+    GstElement* test_source;
+    GstElement* test_caps;
+    GstElement* test_encoder;
+    GstElement* video_parse;
+    GstElement* video_convert;      // 재인코딩 모드: tee 앞에서 두 브랜치 공용 포맷으로 한 번만 변환
+    GstElement* video_convert_caps;
+    GstElement* video_tee;
+    GstElement* video_queue_display;
+    GstElement* video_decoder_display;
+    GstElement* video_convert_display;
+    GstElement* video_sink_display;
+    GstElement* thumbnail_queue;
+    GstElement* thumbnail_decoder;  // passthrough 모드에서만 (키프레임만 디코딩)
+    GstElement* thumbnail_rate;
+    GstElement* thumbnail_convert;
+    GstElement* thumbnail_scale;
+    GstElement* thumbnail_caps;
+    GstElement* thumbnail_encoder;
+    GstElement* thumbnail_sink;
+    GstElement* motion_queue;
+    GstElement* motion_decoder;     // passthrough 모드에서만 (키프레임만 디코딩)
+    GstElement* motion_rate;
+    GstElement* motion_scale;
+    GstElement* motion_convert;
+    GstElement* motion_caps;
+    GstElement* motion_sink;
+    GstElement* shm_queue;
+    GstElement* shm_decoder;        // passthrough 모드에서만
+    GstElement* shm_sink;
+    GstElement* video_queue_record;
+    GstElement* record_scale;       // ABR: variant가 바뀌어도 녹화 해상도는 처음 해상도로 유지
+    GstElement* record_scale_caps;
+    GstElement* video_encoder;
+    GstElement* muxer;              // 연속 녹화 (splitmuxsink 소유)
+    GstElement* splitmux_sink;
+    GstElement* record_tail;        // 녹화 브랜치의 인코딩된 스트림 끝
+    GstElement* record_tee;         // 클립 모드: 인코딩된 스트림을 동시에 녹화 중인 클립들로 나눔
+    PrerollBuffer* preroll;         // 클립 모드에서만 사용
+    GList* clips;                   // CameraClip* (녹화 중 + GOP 경계/EOS를 기다리며 닫히는 중)
+    guint n_active_clips;           // 녹화 중인 클립 수
+    guint n_clips;                  // 지금까지 시작한 클립 수 (클립 id)
+    CameraBranchStats branch_stats;
+    CameraStartupStats startup;
+    Metrics* metrics;               // 계측 모드에서만 사용
+    AbrPolicy* abr;                 // --abr (URI 소스, 재인코딩 모드)
+    guint abr_id;
+    guint abr_display_drops;        // 이전 판정 때의 재생 큐 드롭 수
+    guint abr_record_overruns;
+    gboolean record_size_fixed;     // 녹화 해상도를 정함 (스트리밍 스레드)
+    gint n_skipped_decoders;        // 고르지 않은 오디오/자막 디코더 수 (스트리밍 스레드)
+    gint n_unused_buffers;          // 쓰지 않는 스트림에서 버린 버퍼 수
+    guint worker_threads;           // workers 예산에서 받은 추가 작업 스레드 수
+    FramePools* frame_pools;        // raw 프레임 풀 제안/할당 집계
+    MotionDetector* motion;         // --motion
+    guint motion_id;
+    guint motion_seen;              // 메인 루프가 마지막으로 본 움직임 프레임 수
+    gint64 motion_last_us;          // 마지막으로 움직임을 본 시각 (monotonic)
+    guint motion_clip;              // 움직임으로 시작한 클립 id (0 = 없음)
+    guint n_motion_events;          // 움직임으로 시작한 클립 수
+    ShmOutput* shm;                 // --shm-dir
+    guint shm_id;
+    FileWriter* writer;             // --async-writer: 클립/세그먼트 파일 쓰기 스레드와 통계
+    AffinityPool* affinity;         // --cpus/--thread-nice: 스트리밍 스레드를 카메라의 CPU 묶음에서 실행
+
+    guint bus_watch_id;
+    gboolean recording;
+    gboolean finished;
+    gint n_threads;                 // 스트리밍 스레드 수 (STREAM_STATUS enter/leave)
+    gint n_segments;                // 연속 녹화로 만든 파일 수 (스트리밍 스레드에서 증가)
+    QueueCounters display_counters;
+    QueueCounters record_counters;
+    gint n_frames;                  // tee에 들어온 프레임 수
+    gint n_conversions;             // videoconvert가 실제로 새 버퍼를 만든 횟수 (passthrough면 0)
+    gint clip_start_max_us;         // 모든 클립 중 녹화 시작 명령 ~ 첫 키프레임이 muxer에 도착의 최대 (클립별 값은 CameraClip)
+
+    // 소스 감시 / 재연결 (메인 루프 스레드)
+    guint watchdog_id;
+    guint reconnect_id;             // 대기 중인 재연결 (소스가 제거된 상태)
+    gint watchdog_frames;           // 감시 타이머가 마지막으로 본 n_frames
+    gint64 last_progress_us;        // 마지막으로 프레임이 늘어난 시각 (monotonic)
+    gint64 source_lost_us;          // 소스를 잃은 시각 (복구될 때까지 유지)
+    GstClockTime reconnect_delay;
+    guint n_reconnects;             // 다시 만든 소스 수
+    gint source_eos;                // 소스가 EOS를 보냄 (스트리밍 스레드에서 설정, EOS 자체는 버림)
+    gint source_recovering;         // 재연결 후 첫 프레임 대기 중 (스트리밍 스레드에서 해제)
+    gint recovery_us;               // 마지막 복구: 소스를 잃은 시각 ~ 새 소스의 첫 프레임이 tee에 도착 (us)
+    gint recovery_max_us;
+
+    CameraFinishedFunc finished_func;
+    gpointer finished_data;
+};
+
+// 녹화 인코더 프로파일 이름 확인 ("default", "low-latency", "throughput", "archival")
+gboolean camera_encoder_profile_is_valid(const gchar* profile);
+
+// 카메라 그래프가 쓰는 플러그인을 미리 로드 (첫 카메라의 엘리먼트 생성에서 dlopen 비용을 뺌)
+gboolean camera_preload_plugins(const ClipperConfig* config);
+
+// uri가 NULL이면 URI 소스를 비워 둔 채로 그래프만 만듦 (파이프라인 풀용, camera_bind로 URI 지정)
+Camera* camera_new(const gchar* name, const gchar* uri, const ClipperConfig* config,
+    CameraFinishedFunc finished_func, gpointer user_data);
+void camera_free(Camera* camera);
+
+// 그래프를 READY로 올려 둠 (싱크/인코더 초기화까지 미리 끝냄)
+gboolean camera_prepare(Camera* camera);
+// URI 없이 만든 카메라에 이름과 URI를 붙임 (READY 상태에서, 테스트 URI는 불가)
+gboolean camera_bind(Camera* camera, const gchar* name, const gchar* uri);
+gboolean camera_play(Camera* camera);
+// 새 클립을 시작하고 id를 돌려줌 (실패 시 0). 녹화 중인 다른 클립과 겹쳐도 됨.
+// duration > 0이면 그 초 뒤에 자동으로 정지
+guint camera_start_clip(Camera* camera, guint duration);
+gboolean camera_stop_clip(Camera* camera, guint id);
+void camera_start_recording(Camera* camera);
+void camera_stop_recording(Camera* camera);     // 녹화 중인 모든 클립 정지
+void camera_toggle_recording(Camera* camera);
+
+// 클립 모드의 프리롤 길이 변경 (다음 녹화부터 적용). 연속 녹화 모드면 FALSE
+gboolean camera_set_preroll(Camera* camera, GstClockTime preroll);
+
+// 제어 소켓의 status 응답용 JSON 객체
+void camera_append_status_json(Camera* camera, GString* json);
+
+// tee에 들어온 프레임 수와 실제 포맷 변환(프레임 복사) 횟수
+void camera_get_conversion_stats(Camera* camera, guint* frames, guint* conversions);
+
+// 재생 큐에서 버린 버퍼 수와 녹화 큐가 가득 차서 tee가 기다린 횟수
+void camera_get_queue_stats(Camera* camera, guint* display_drops, guint* record_overruns);
+
+// 카메라별 상태, 메모리(큐/프리롤), 스레드 수 출력
+void camera_print_report(Camera* camera);
+
+G_END_DECLS
+
+#endif // CLIPPER_CAMERA_H
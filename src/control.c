@@ -0,0 +1,141 @@
+#include "control.h"
+
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+
+struct _ControlServer {
+    GSocketService* service;
+    GCancellable* cancellable;      // 서버를 닫을 때 모든 연결의 대기 중인 읽기를 취소
+    gchar* path;
+    gboolean bound;                 // 우리가 만든 소켓 파일만 지움
+    ControlCommandFunc command_func;
+    gpointer user_data;
+};
+
+// 연결 하나: 줄 단위로 비동기 읽기 -> 명령 처리 -> 응답 비동기 쓰기 -> 다음 줄
+typedef struct _ControlClient {
+    ControlServer* server;          // 참조를 잡음 (서버를 닫은 뒤에 취소된 콜백이 돌 수 있음)
+    GSocketConnection* connection;
+    GDataInputStream* input;
+    GString* reply;                 // 쓰고 있는 응답
+} ControlClient;
+
+static void server_clear(ControlServer* server) {
+    g_object_unref(server->cancellable);
+    g_free(server->path);
+}
+
+static void client_free(ControlClient* client) {
+    g_rc_box_release_full(client->server, (GDestroyNotify)server_clear);
+    if (client->reply)
+        g_string_free(client->reply, TRUE);
+    g_object_unref(client->input);
+    g_object_unref(client->connection);
+    g_free(client);
+}
+
+static void client_read_line(GObject* source, GAsyncResult* result, ControlClient* client);
+
+static void client_read_next(ControlClient* client) {
+    g_data_input_stream_read_line_async(client->input, G_PRIORITY_DEFAULT, client->server->cancellable,
+        (GAsyncReadyCallback)client_read_line, client);
+}
+
+// 응답을 다 쓴 뒤에 다음 줄을 읽음 (읽지 않는 클라이언트는 그 연결만 멈추고 메인 루프는 막지 않음)
+static void client_write_done(GObject* source, GAsyncResult* result, ControlClient* client) {
+    GError* error = NULL;
+
+    if (!g_output_stream_write_all_finish(G_OUTPUT_STREAM(source), result, NULL, &error)) {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_printerr("Control connection error: %s\n", error->message);
+        g_error_free(error);
+        client_free(client);
+        return;
+    }
+    g_string_free(client->reply, TRUE);
+    client->reply = NULL;
+    client_read_next(client);
+}
+
+static void client_read_line(GObject* source, GAsyncResult* result, ControlClient* client) {
+    GOutputStream* output;
+    GError* error = NULL;
+    gchar* line;
+
+    line = g_data_input_stream_read_line_finish_utf8(G_DATA_INPUT_STREAM(source), result, NULL, &error);
+    if (!line || g_cancellable_is_cancelled(client->server->cancellable)) {
+        // 연결 종료(EOF), 서버 종료(취소) 또는 읽기 오류. 취소 전에 읽힌 줄도 서버를 닫은 뒤에는 처리하지 않음
+        if (error && !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_printerr("Control connection error: %s\n", error->message);
+        g_clear_error(&error);
+        g_free(line);
+        client_free(client);
+        return;
+    }
+
+    client->reply = g_string_new(NULL);
+    client->server->command_func(g_strstrip(line), client->reply, client->server->user_data);
+    g_string_append_c(client->reply, '\n');
+    g_free(line);
+
+    // 여러 카메라의 status 응답은 소켓 버퍼보다 클 수 있으므로 비동기로 씀
+    output = g_io_stream_get_output_stream(G_IO_STREAM(client->connection));
+    g_output_stream_write_all_async(output, client->reply->str, client->reply->len, G_PRIORITY_DEFAULT,
+        client->server->cancellable, (GAsyncReadyCallback)client_write_done, client);
+}
+
+static gboolean incoming_handler(GSocketService* service, GSocketConnection* connection, GObject* source_object, ControlServer* server) {
+    ControlClient* client = g_new0(ControlClient, 1);
+
+    client->server = g_rc_box_acquire(server);
+    client->connection = g_object_ref(connection);
+    client->input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    g_data_input_stream_set_newline_type(client->input, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+    client_read_next(client);
+    return TRUE;
+}
+
+ControlServer* control_server_new(const gchar* path, ControlCommandFunc command_func, gpointer user_data, GError** error) {
+    ControlServer* server;
+    GSocketAddress* address;
+    GStatBuf st;
+    gboolean ok;
+
+    // 이전 실행이 남긴 소켓 파일만 제거 (일반 파일은 건드리지 않음)
+    if (g_lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        g_unlink(path);
+    address = g_unix_socket_address_new(path);
+
+    server = g_rc_box_new0(ControlServer);
+    server->service = g_socket_service_new();
+    server->cancellable = g_cancellable_new();
+    server->path = g_strdup(path);
+    server->command_func = command_func;
+    server->user_data = user_data;
+    ok = g_socket_listener_add_address(G_SOCKET_LISTENER(server->service), address,
+        G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, error);
+    g_object_unref(address);
+    if (!ok) {
+        control_server_free(server);
+        return NULL;
+    }
+    server->bound = TRUE;
+    g_signal_connect(server->service, "incoming", G_CALLBACK(incoming_handler), server);
+    g_socket_service_start(server->service);
+    return server;
+}
+
+void control_server_free(ControlServer* server) {
+    if (!server)
+        return;
+    // 취소된 읽기/쓰기 콜백은 기본 컨텍스트가 다시 돌 때 연결을 해제함. 여기서 컨텍스트를 직접 돌리면
+    // 다른 소스(키보드, 버스, 풀 보충)까지 정리 도중에 불리므로 돌리지 않고, 남은 연결이 서버 참조를 잡아 둠
+    g_cancellable_cancel(server->cancellable);
+    g_socket_service_stop(server->service);
+    g_socket_listener_close(G_SOCKET_LISTENER(server->service));
+    g_object_unref(server->service);
+    if (server->bound)
+        g_unlink(server->path);
+    g_rc_box_release_full(server, (GDestroyNotify)server_clear);
+}
@@ -0,0 +1,21 @@
+#ifndef CLIPPER_CONTROL_H
+#define CLIPPER_CONTROL_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+// Unix 도메인 소켓 제어 서버. 클라이언트가 보낸 한 줄 명령마다 command_func을 부르고
+// 그 응답을 한 줄로 돌려준다. 모든 입출력은 기본 GMainContext에서 비동기로 처리한다.
+typedef struct _ControlServer ControlServer;
+
+// line: 앞뒤 공백을 제거한 명령, reply: 개행 없이 응답을 채움 ("ok ..." 또는 "error ...")
+typedef void (*ControlCommandFunc)(const gchar* line, GString* reply, gpointer user_data);
+
+ControlServer* control_server_new(const gchar* path, ControlCommandFunc command_func, gpointer user_data, GError** error);
+// 서버를 닫고 소켓 파일을 지운다 (열려 있는 연결도 끊음)
+void control_server_free(ControlServer* server);
+
+G_END_DECLS
+
+#endif // CLIPPER_CONTROL_H
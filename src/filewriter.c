@@ -0,0 +1,556 @@
+#include "filewriter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <gst/base/gstbasesink.h>
+
+// 지연 히스토그램: i번째 칸은 [2^i, 2^(i+1)) µs
+#define LATENCY_BUCKETS 32
+// 모아 쓰는 버퍼의 정렬과 최소 크기 (페이지/블록 크기)
+#define WRITE_ALIGN 4096
+// 새 버퍼가 이 시간 동안 없으면 모아 둔 것을 씀 (fragmented MP4의 조각이 메모리에만 오래 남지 않도록)
+#define IDLE_FLUSH_US (100 * G_TIME_SPAN_MILLISECOND)
+
+typedef struct _LatencyHistogram {
+    guint count;
+    gint64 max_us;
+    guint buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+struct _FileWriter {
+    guint chunk_bytes;
+    guint64 max_inflight;
+    guint64 sync_bytes;
+    GstClockTime sync_interval;
+
+    GMutex lock;
+    GCond cond;                     // 미처리 바이트가 줄거나 파일이 닫힘
+    guint64 inflight;               // 싱크가 받았지만 쓰기 스레드가 아직 모아 쓰기 버퍼로 옮기지 않은 바이트
+    guint64 inflight_max;
+    guint open_files;               // 쓰기 스레드가 살아 있는 파일 수
+
+    // 통계 (lock)
+    guint files;
+    guint errors;
+    guint64 bytes_written;
+    guint writes;
+    guint syncs;
+    LatencyHistogram write_latency;
+    LatencyHistogram sync_latency;
+    guint backpressure;             // 상한 때문에 스트리밍 스레드가 기다린 횟수
+    gint64 backpressure_us;
+    gint64 backpressure_max_us;
+};
+
+// 쓰기 스레드에 넘기는 버퍼 하나 (buffer가 NULL이면 파일 닫기)
+typedef struct _WriterOp {
+    GstBuffer* buffer;
+    guint64 offset;
+} WriterOp;
+
+// 파일 하나: 싱크 start ~ 쓰기 스레드가 닫을 때까지 (쓰기 스레드가 해제)
+typedef struct _WriterFile {
+    FileWriter* writer;
+    gchar* location;
+    GAsyncQueue* ops;               // WriterOp*
+    gint failed;                    // 열기/쓰기/동기화 실패 (쓰기 스레드에서 설정, 이후 버퍼는 버림)
+    gchar* error_message;           // failed를 설정하기 전에 채움
+
+    // 이하 쓰기 스레드에서만 사용
+    gint fd;
+    guint8* chunk;                  // 모아 쓰기 버퍼 (WRITE_ALIGN 정렬, chunk_bytes)
+    guint64 chunk_offset;           // chunk[0]이 들어갈 파일 오프셋
+    gsize chunk_len;
+    guint64 unsynced;               // 마지막 동기화 이후 쓴 바이트
+    gint64 last_sync_us;
+} WriterFile;
+
+// filesink 대신 쓰는 싱크
+typedef struct _WriterSink {
+    GstBaseSink parent;
+    FileWriter* writer;
+    gchar* location;
+    WriterFile* file;               // start ~ stop
+    guint64 position;               // 다음 버퍼를 쓸 파일 오프셋 (스트리밍 스레드)
+    gboolean flushing;              // unlock: backpressure 대기 중단 (writer->lock)
+} WriterSink;
+
+typedef struct _WriterSinkClass {
+    GstBaseSinkClass parent_class;
+} WriterSinkClass;
+
+enum {
+    PROP_0,
+    PROP_LOCATION,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink", GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+GType writer_sink_get_type(void);
+G_DEFINE_TYPE(WriterSink, writer_sink, GST_TYPE_BASE_SINK)
+
+static guint latency_bucket(gint64 us) {
+    guint bucket = 0;
+    while (us > 1 && bucket < LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void histogram_add(LatencyHistogram* histogram, gint64 us) {
+    histogram->count++;
+    histogram->buckets[latency_bucket(us)]++;
+    if (us > histogram->max_us)
+        histogram->max_us = us;
+}
+
+// 히스토그램에서 백분위 칸의 상한 (µs)
+static guint64 histogram_percentile(const LatencyHistogram* histogram, gdouble fraction) {
+    guint target = (guint)(histogram->count * fraction);
+    guint seen = 0;
+    guint i;
+
+    if (histogram->count == 0)
+        return 0;
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen > target)
+            return G_GUINT64_CONSTANT(1) << (i + 1);
+    }
+    return G_GUINT64_CONSTANT(1) << LATENCY_BUCKETS;
+}
+
+static gint sync_data(gint fd) {
+#ifdef __APPLE__
+    return fsync(fd);
+#else
+    return fdatasync(fd);
+#endif
+}
+
+static void writer_fail(WriterFile* file, const gchar* what, gint err) {
+    if (g_atomic_int_get(&file->failed))
+        return;
+    file->error_message = g_strdup_printf("Could not %s %s: %s", what, file->location, g_strerror(err));
+    g_printerr("%s\n", file->error_message);
+    g_mutex_lock(&file->writer->lock);
+    file->writer->errors++;
+    g_mutex_unlock(&file->writer->lock);
+    g_atomic_int_set(&file->failed, TRUE);
+}
+
+static void flush_chunk(WriterFile* file) {
+    FileWriter* writer = file->writer;
+    gsize done = 0;
+    gint64 start;
+
+    if (file->chunk_len == 0)
+        return;
+    if (file->fd >= 0 && !g_atomic_int_get(&file->failed)) {
+        start = g_get_monotonic_time();
+        while (done < file->chunk_len) {
+            gssize n = pwrite(file->fd, file->chunk + done, file->chunk_len - done, (off_t)(file->chunk_offset + done));
+
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                writer_fail(file, "write", n < 0 ? errno : EIO);
+                break;
+            }
+            done += (gsize)n;
+        }
+        g_mutex_lock(&writer->lock);
+        writer->writes++;
+        writer->bytes_written += done;
+        histogram_add(&writer->write_latency, g_get_monotonic_time() - start);
+        g_mutex_unlock(&writer->lock);
+        file->unsynced += done;
+    }
+    file->chunk_len = 0;
+}
+
+// sync_bytes/sync_interval에 닿았거나 닫을 때 fdatasync (둘 다 0이면 하지 않음)
+static void maybe_sync(WriterFile* file, gboolean closing) {
+    FileWriter* writer = file->writer;
+    gint64 now = g_get_monotonic_time();
+    gint64 start;
+
+    if (file->fd < 0 || g_atomic_int_get(&file->failed) || file->unsynced == 0)
+        return;
+    if (writer->sync_bytes == 0 && writer->sync_interval == 0)
+        return;
+    if (!closing && !(writer->sync_bytes > 0 && file->unsynced >= writer->sync_bytes) &&
+        !(writer->sync_interval > 0 && now - file->last_sync_us >= (gint64)(writer->sync_interval / GST_USECOND)))
+        return;
+    start = now;
+    if (sync_data(file->fd) < 0)
+        writer_fail(file, "sync", errno);
+    now = g_get_monotonic_time();
+    g_mutex_lock(&writer->lock);
+    writer->syncs++;
+    histogram_add(&writer->sync_latency, now - start);
+    g_mutex_unlock(&writer->lock);
+    file->unsynced = 0;
+    file->last_sync_us = now;
+}
+
+// 버퍼를 모아 쓰기 버퍼에 복사. chunk_bytes 경계에서 끊어 쓰므로 첫 쓰기 이후의 쓰기는 경계에 맞음
+static void append_data(WriterFile* file, const guint8* data, gsize size, guint64 offset) {
+    guint chunk_bytes = file->writer->chunk_bytes;
+
+    // 이어지지 않는 위치(mp4mux가 헤더를 다시 쓸 때)면 모아 둔 것부터 씀
+    if (file->chunk_len > 0 && offset != file->chunk_offset + file->chunk_len)
+        flush_chunk(file);
+    while (size > 0) {
+        gsize limit, n;
+
+        if (file->chunk_len == 0)
+            file->chunk_offset = offset;
+        limit = chunk_bytes - (gsize)(file->chunk_offset % chunk_bytes);
+        n = MIN(size, limit - file->chunk_len);
+        memcpy(file->chunk + file->chunk_len, data, n);
+        file->chunk_len += n;
+        data += n;
+        size -= n;
+        offset += n;
+        if (file->chunk_len == limit) {
+            flush_chunk(file);
+            maybe_sync(file, FALSE);
+        }
+    }
+}
+
+static void release_inflight(FileWriter* writer, gsize size) {
+    g_mutex_lock(&writer->lock);
+    writer->inflight -= MIN(size, writer->inflight);
+    g_cond_broadcast(&writer->cond);
+    g_mutex_unlock(&writer->lock);
+}
+
+static void writer_file_free(WriterFile* file) {
+    g_async_queue_unref(file->ops);
+    g_free(file->location);
+    g_free(file->error_message);
+    g_free(file);
+}
+
+static gpointer writer_thread(WriterFile* file) {
+    FileWriter* writer = file->writer;
+    WriterOp* op;
+
+    file->fd = open(file->location, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (file->fd < 0)
+        writer_fail(file, "open", errno);
+    if (posix_memalign((void**)&file->chunk, WRITE_ALIGN, writer->chunk_bytes) != 0) {
+        file->chunk = NULL;
+        writer_fail(file, "allocate a write buffer for", ENOMEM);
+    }
+
+    for (;;) {
+        op = g_async_queue_timeout_pop(file->ops, IDLE_FLUSH_US);
+        if (!op) {
+            flush_chunk(file);
+            maybe_sync(file, FALSE);
+            continue;
+        }
+        if (!op->buffer) {
+            g_free(op);
+            break;
+        }
+        // 실패한 뒤에도 큐는 비워서 미처리 바이트를 돌려줌 (스트리밍 스레드는 다음 render에서 에러를 봄)
+        if (file->chunk && !g_atomic_int_get(&file->failed)) {
+            GstMapInfo map;
+
+            if (gst_buffer_map(op->buffer, &map, GST_MAP_READ)) {
+                append_data(file, map.data, map.size, op->offset);
+                gst_buffer_unmap(op->buffer, &map);
+            }
+        }
+        release_inflight(writer, gst_buffer_get_size(op->buffer));
+        gst_buffer_unref(op->buffer);
+        g_free(op);
+    }
+
+    flush_chunk(file);
+    maybe_sync(file, TRUE);
+    if (file->fd >= 0 && close(file->fd) < 0)
+        writer_fail(file, "close", errno);
+    free(file->chunk);
+
+    g_mutex_lock(&writer->lock);
+    writer->open_files--;
+    g_cond_broadcast(&writer->cond);
+    g_mutex_unlock(&writer->lock);
+    writer_file_free(file);
+    return NULL;
+}
+
+// 스트리밍 스레드일 수 있음 (splitmuxsink의 파일 전환): 파일은 쓰기 스레드가 연다
+static gboolean writer_sink_start(GstBaseSink* sink) {
+    WriterSink* self = (WriterSink*)sink;
+    FileWriter* writer = self->writer;
+    WriterFile* file;
+    GThread* thread;
+    GError* error = NULL;
+
+    if (!self->location) {
+        GST_ELEMENT_ERROR(self, RESOURCE, NOT_FOUND, ("No file name specified for writing."), (NULL));
+        return FALSE;
+    }
+    file = g_new0(WriterFile, 1);
+    file->writer = writer;
+    file->location = g_strdup(self->location);
+    file->ops = g_async_queue_new();
+    file->fd = -1;
+    file->last_sync_us = g_get_monotonic_time();
+
+    g_mutex_lock(&writer->lock);
+    writer->open_files++;
+    writer->files++;
+    g_mutex_unlock(&writer->lock);
+    thread = g_thread_try_new("file-writer", (GThreadFunc)writer_thread, file, &error);
+    if (!thread) {
+        GST_ELEMENT_ERROR(self, RESOURCE, OPEN_WRITE, ("Could not start the writer thread for %s: %s", file->location, error->message), (NULL));
+        g_error_free(error);
+        g_mutex_lock(&writer->lock);
+        writer->open_files--;
+        g_cond_broadcast(&writer->cond);
+        g_mutex_unlock(&writer->lock);
+        writer_file_free(file);
+        return FALSE;
+    }
+    // 스레드는 파일을 닫고 스스로 끝남 (file_writer_free가 open_files로 기다림)
+    g_thread_unref(thread);
+    self->file = file;
+    self->position = 0;
+    return TRUE;
+}
+
+// 남은 데이터는 쓰기 스레드가 마저 쓰고 닫음 (기다리지 않음)
+static gboolean writer_sink_stop(GstBaseSink* sink) {
+    WriterSink* self = (WriterSink*)sink;
+
+    if (self->file) {
+        g_async_queue_push(self->file->ops, g_new0(WriterOp, 1));
+        self->file = NULL;
+    }
+    return TRUE;
+}
+
+static GstFlowReturn writer_sink_render(GstBaseSink* sink, GstBuffer* buffer) {
+    WriterSink* self = (WriterSink*)sink;
+    FileWriter* writer = self->writer;
+    gsize size = gst_buffer_get_size(buffer);
+    WriterOp* op;
+
+    if (g_atomic_int_get(&self->file->failed)) {
+        GST_ELEMENT_ERROR(self, RESOURCE, WRITE, ("%s", self->file->error_message), (NULL));
+        return GST_FLOW_ERROR;
+    }
+    g_mutex_lock(&writer->lock);
+    // 상한을 넘으면 쓰기 스레드가 따라잡을 때까지 기다림 (상한보다 큰 버퍼도 다른 미처리 바이트가 없으면 받음)
+    if (writer->inflight > 0 && writer->inflight + size > writer->max_inflight) {
+        gint64 start = g_get_monotonic_time();
+        gint64 waited;
+
+        while (!self->flushing && writer->inflight > 0 && writer->inflight + size > writer->max_inflight)
+            g_cond_wait(&writer->cond, &writer->lock);
+        waited = g_get_monotonic_time() - start;
+        writer->backpressure++;
+        writer->backpressure_us += waited;
+        if (waited > writer->backpressure_max_us)
+            writer->backpressure_max_us = waited;
+    }
+    if (self->flushing) {
+        g_mutex_unlock(&writer->lock);
+        return GST_FLOW_FLUSHING;
+    }
+    writer->inflight += size;
+    if (writer->inflight > writer->inflight_max)
+        writer->inflight_max = writer->inflight;
+    g_mutex_unlock(&writer->lock);
+
+    op = g_new(WriterOp, 1);
+    op->buffer = gst_buffer_ref(buffer);
+    op->offset = self->position;
+    g_async_queue_push(self->file->ops, op);
+    self->position += size;
+    return GST_FLOW_OK;
+}
+
+static gboolean writer_sink_unlock(GstBaseSink* sink) {
+    WriterSink* self = (WriterSink*)sink;
+
+    g_mutex_lock(&self->writer->lock);
+    self->flushing = TRUE;
+    g_cond_broadcast(&self->writer->cond);
+    g_mutex_unlock(&self->writer->lock);
+    return TRUE;
+}
+
+static gboolean writer_sink_unlock_stop(GstBaseSink* sink) {
+    WriterSink* self = (WriterSink*)sink;
+
+    g_mutex_lock(&self->writer->lock);
+    self->flushing = FALSE;
+    g_mutex_unlock(&self->writer->lock);
+    return TRUE;
+}
+
+static gboolean writer_sink_event(GstBaseSink* sink, GstEvent* event) {
+    WriterSink* self = (WriterSink*)sink;
+
+    if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT) {
+        const GstSegment* segment;
+
+        gst_event_parse_segment(event, &segment);
+        // mp4mux는 끝에서 BYTES 세그먼트로 앞의 헤더 위치로 돌아가 다시 씀 (쓰기 스레드가 그 오프셋에 pwrite)
+        if (segment->format == GST_FORMAT_BYTES)
+            self->position = segment->start;
+    }
+    return GST_BASE_SINK_CLASS(writer_sink_parent_class)->event(sink, event);
+}
+
+static gboolean writer_sink_query(GstBaseSink* sink, GstQuery* query) {
+    WriterSink* self = (WriterSink*)sink;
+    GstFormat format;
+
+    switch (GST_QUERY_TYPE(query)) {
+    case GST_QUERY_SEEKING:
+        // mp4mux가 헤더를 다시 쓸 수 있는지 확인 (filesink와 같이 바이트 단위로 되돌아가 쓰기 가능)
+        gst_query_parse_seeking(query, &format, NULL, NULL, NULL);
+        gst_query_set_seeking(query, format, format == GST_FORMAT_BYTES || format == GST_FORMAT_DEFAULT, 0, -1);
+        return TRUE;
+    case GST_QUERY_POSITION:
+        gst_query_parse_position(query, &format, NULL);
+        if (format == GST_FORMAT_BYTES || format == GST_FORMAT_DEFAULT) {
+            gst_query_set_position(query, GST_FORMAT_BYTES, (gint64)self->position);
+            return TRUE;
+        }
+        break;
+    case GST_QUERY_FORMATS:
+        gst_query_set_formats(query, 2, GST_FORMAT_DEFAULT, GST_FORMAT_BYTES);
+        return TRUE;
+    default:
+        break;
+    }
+    return GST_BASE_SINK_CLASS(writer_sink_parent_class)->query(sink, query);
+}
+
+static void writer_sink_set_property(GObject* object, guint prop_id, const GValue* value, GParamSpec* pspec) {
+    WriterSink* self = (WriterSink*)object;
+
+    switch (prop_id) {
+    case PROP_LOCATION:
+        // splitmuxsink는 파일을 바꿀 때 싱크를 멈추고 location을 바꾼 뒤 다시 시작함
+        g_free(self->location);
+        self->location = g_value_dup_string(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void writer_sink_get_property(GObject* object, guint prop_id, GValue* value, GParamSpec* pspec) {
+    WriterSink* self = (WriterSink*)object;
+
+    switch (prop_id) {
+    case PROP_LOCATION:
+        g_value_set_string(value, self->location);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void writer_sink_finalize(GObject* object) {
+    g_free(((WriterSink*)object)->location);
+    G_OBJECT_CLASS(writer_sink_parent_class)->finalize(object);
+}
+
+static void writer_sink_class_init(WriterSinkClass* klass) {
+    GObjectClass* object_class = G_OBJECT_CLASS(klass);
+    GstElementClass* element_class = GST_ELEMENT_CLASS(klass);
+    GstBaseSinkClass* sink_class = GST_BASE_SINK_CLASS(klass);
+
+    object_class->set_property = writer_sink_set_property;
+    object_class->get_property = writer_sink_get_property;
+    object_class->finalize = writer_sink_finalize;
+    g_object_class_install_property(object_class, PROP_LOCATION,
+        g_param_spec_string("location", "File Location", "Location of the file to write", NULL,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    gst_element_class_add_static_pad_template(element_class, &sink_template);
+    gst_element_class_set_static_metadata(element_class, "Batched file writer", "Sink/File",
+        "Writes the stream to a file from a dedicated writer thread in large aligned batches", "clipper");
+
+    sink_class->start = writer_sink_start;
+    sink_class->stop = writer_sink_stop;
+    sink_class->render = writer_sink_render;
+    sink_class->unlock = writer_sink_unlock;
+    sink_class->unlock_stop = writer_sink_unlock_stop;
+    sink_class->event = writer_sink_event;
+    sink_class->query = writer_sink_query;
+}
+
+static void writer_sink_init(WriterSink* self) {
+    // filesink와 같이 클럭에 맞추지 않고 받는 대로 넘김
+    gst_base_sink_set_sync(GST_BASE_SINK(self), FALSE);
+}
+
+FileWriter* file_writer_new(guint chunk_bytes, guint64 max_inflight_bytes, guint64 sync_bytes, GstClockTime sync_interval) {
+    FileWriter* writer = g_new0(FileWriter, 1);
+
+    // 블록 크기의 배수로 맞춤
+    writer->chunk_bytes = MAX((chunk_bytes + WRITE_ALIGN - 1) / WRITE_ALIGN * WRITE_ALIGN, WRITE_ALIGN);
+    writer->max_inflight = MAX(max_inflight_bytes, 1);
+    writer->sync_bytes = sync_bytes;
+    writer->sync_interval = sync_interval;
+    g_mutex_init(&writer->lock);
+    g_cond_init(&writer->cond);
+    return writer;
+}
+
+void file_writer_free(FileWriter* writer) {
+    if (!writer)
+        return;
+    g_mutex_lock(&writer->lock);
+    while (writer->open_files > 0)
+        g_cond_wait(&writer->cond, &writer->lock);
+    g_mutex_unlock(&writer->lock);
+    g_cond_clear(&writer->cond);
+    g_mutex_clear(&writer->lock);
+    g_free(writer);
+}
+
+GstElement* file_writer_make_sink(FileWriter* writer, const gchar* name) {
+    WriterSink* sink = g_object_new(writer_sink_get_type(), name ? "name" : NULL, name, NULL);
+
+    sink->writer = writer;
+    return GST_ELEMENT(sink);
+}
+
+void file_writer_append_json(FileWriter* writer, GString* json) {
+    g_mutex_lock(&writer->lock);
+    g_string_append_printf(json,
+        "{\"files\":%u,\"open\":%u,\"errors\":%u,\"bytes\":%" G_GUINT64_FORMAT ",\"writes\":%u,\"avg_write_kb\":%.1f,"
+        "\"write_p50_us\":%" G_GUINT64_FORMAT ",\"write_p99_us\":%" G_GUINT64_FORMAT ",\"write_max_us\":%" G_GINT64_FORMAT ","
+        "\"syncs\":%u,\"sync_p50_us\":%" G_GUINT64_FORMAT ",\"sync_p99_us\":%" G_GUINT64_FORMAT ",\"sync_max_us\":%" G_GINT64_FORMAT ","
+        "\"inflight_bytes\":%" G_GUINT64_FORMAT ",\"inflight_max_bytes\":%" G_GUINT64_FORMAT ","
+        "\"backpressure\":%u,\"backpressure_ms\":%.3f,\"backpressure_max_ms\":%.3f}",
+        writer->files, writer->open_files, writer->errors, writer->bytes_written, writer->writes,
+        writer->writes > 0 ? writer->bytes_written / 1024.0 / writer->writes : 0.0,
+        histogram_percentile(&writer->write_latency, 0.50), histogram_percentile(&writer->write_latency, 0.99),
+        writer->write_latency.max_us,
+        writer->syncs, histogram_percentile(&writer->sync_latency, 0.50), histogram_percentile(&writer->sync_latency, 0.99),
+        writer->sync_latency.max_us,
+        writer->inflight, writer->inflight_max,
+        writer->backpressure, writer->backpressure_us / 1000.0, writer->backpressure_max_us / 1000.0);
+    g_mutex_unlock(&writer->lock);
+}
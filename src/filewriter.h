@@ -0,0 +1,31 @@
+#ifndef CLIPPER_FILEWRITER_H
+#define CLIPPER_FILEWRITER_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// 녹화 파일 비동기 쓰기 (카메라당 하나, --async-writer).
+// filesink는 muxer의 스트리밍 스레드에서 직접 write/fsync를 하므로 디스크가 느리면 녹화 큐와 tee까지 밀린다.
+// 이 모듈이 만드는 싱크는 받은 버퍼를 참조만 잡아 파일별 쓰기 스레드에 넘기고, 쓰기 스레드가
+// chunk_bytes 경계에 맞춘 큰 단위로 모아 pwrite하고 sync_bytes/sync_interval마다 fdatasync한다.
+// 파일 열기/쓰기/동기화/닫기는 모두 쓰기 스레드에서 하므로 스트리밍 스레드는 디스크 입출력을 하지 않는다.
+// 아직 쓰지 않은 바이트가 max_inflight_bytes를 넘으면 스트리밍 스레드가 줄어들 때까지 기다리고(backpressure), 그 횟수와 시간을 센다.
+// 싱크를 멈추면(splitmuxsink의 파일 전환 포함) 남은 데이터는 쓰기 스레드가 마저 쓰고 닫는다.
+typedef struct _FileWriter FileWriter;
+
+// chunk_bytes: 모아 쓰는 단위 (쓰기는 이 크기의 배수 오프셋에서 끝남)
+// sync_bytes / sync_interval: 이만큼 쓰거나 이 시간이 지나면 fdatasync (둘 다 0이면 동기화하지 않음)
+FileWriter* file_writer_new(guint chunk_bytes, guint64 max_inflight_bytes, guint64 sync_bytes, GstClockTime sync_interval);
+// 파이프라인을 해제한 뒤에 호출. 아직 쓰고 있는 파일이 닫힐 때까지 기다림
+void file_writer_free(FileWriter* writer);
+
+// filesink 대신 쓰는 싱크 ("location" 속성, 바이트 SEGMENT로 되돌아가 헤더를 다시 쓰는 mp4mux 지원)
+GstElement* file_writer_make_sink(FileWriter* writer, const gchar* name);
+
+// 파일 수, 쓴 바이트, 쓰기/동기화 지연 p50/p99/max, 미처리 바이트(최대), backpressure 횟수/시간
+void file_writer_append_json(FileWriter* writer, GString* json);
+
+G_END_DECLS
+
+#endif // CLIPPER_FILEWRITER_H
@@ -0,0 +1,154 @@
+#include "framepool.h"
+
+#include <gst/video/video.h>
+
+// 초당 할당 표본 주기 (status, 주기 보고서, 벤치마크가 같은 값을 읽음)
+#define ALLOC_SAMPLE_INTERVAL_S 1
+
+struct _FramePools {
+    guint min_buffers;
+
+    // 스트리밍 스레드에서 증가
+    gint proposed;                  // 우리가 넣은 풀 수
+    gint shared;                    // 하류가 이미 풀을 제안한 쿼리 수
+    gint* allocated;                // 우리 풀이 새로 만든 버퍼 수 (g_atomic_rc_box, 하류가 잡고 있는 풀도 참조)
+    gint buffers;                   // count_buffers 패드를 지난 버퍼 수
+    gint unpooled;                  // 그중 어떤 풀에도 속하지 않은 버퍼 (프레임마다 새로 할당)
+
+    // 이하 메인 루프 스레드에서만 사용 (표본은 타이머 하나에서만 갱신)
+    guint sample_id;
+    guint last_allocations;
+    gint64 last_sample_us;
+    gdouble allocs_per_sec;
+};
+
+// 새 버퍼를 만들 때마다 세는 GstVideoBufferPool (풀에서 다시 꺼내는 버퍼는 세지 않음)
+typedef struct _CountingPool {
+    GstVideoBufferPool parent;
+    gint* allocated;                // FramePools보다 오래 살 수 있으므로 참조를 잡음
+} CountingPool;
+
+typedef struct _CountingPoolClass {
+    GstVideoBufferPoolClass parent_class;
+} CountingPoolClass;
+
+GType counting_pool_get_type(void);
+G_DEFINE_TYPE(CountingPool, counting_pool, GST_TYPE_VIDEO_BUFFER_POOL)
+
+static GstFlowReturn counting_pool_alloc_buffer(GstBufferPool* pool, GstBuffer** buffer, GstBufferPoolAcquireParams* params) {
+    CountingPool* self = (CountingPool*)pool;
+    GstFlowReturn ret = GST_BUFFER_POOL_CLASS(counting_pool_parent_class)->alloc_buffer(pool, buffer, params);
+
+    if (ret == GST_FLOW_OK)
+        g_atomic_int_inc(self->allocated);
+    return ret;
+}
+
+static void counting_pool_finalize(GObject* object) {
+    CountingPool* self = (CountingPool*)object;
+
+    if (self->allocated)
+        g_atomic_rc_box_release(self->allocated);
+    G_OBJECT_CLASS(counting_pool_parent_class)->finalize(object);
+}
+
+static void counting_pool_class_init(CountingPoolClass* klass) {
+    G_OBJECT_CLASS(klass)->finalize = counting_pool_finalize;
+    GST_BUFFER_POOL_CLASS(klass)->alloc_buffer = counting_pool_alloc_buffer;
+}
+
+static void counting_pool_init(CountingPool* self) {
+}
+
+// 하류의 답이 돌아온 뒤(PULL): 풀이 없으면 caps 크기의 풀을 넣음
+static GstPadProbeReturn allocation_query_probe(GstPad* pad, GstPadProbeInfo* info, FramePools* pools) {
+    GstQuery* query = GST_PAD_PROBE_INFO_QUERY(info);
+    GstStructure* config;
+    GstVideoInfo video_info;
+    CountingPool* pool;
+    GstCaps* caps = NULL;
+    gboolean need_pool;
+
+    if (!(GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_PULL) || GST_QUERY_TYPE(query) != GST_QUERY_ALLOCATION)
+        return GST_PAD_PROBE_OK;
+    gst_query_parse_allocation(query, &caps, &need_pool);
+    // 인코딩된 스트림(passthrough)이나 caps 없는 쿼리는 건드리지 않음
+    if (!caps || !gst_video_info_from_caps(&video_info, caps))
+        return GST_PAD_PROBE_OK;
+    if (gst_query_get_n_allocation_pools(query) > 0) {
+        g_atomic_int_inc(&pools->shared);
+        return GST_PAD_PROBE_OK;
+    }
+    if (pools->min_buffers == 0)
+        return GST_PAD_PROBE_OK;
+
+    pool = g_object_new(counting_pool_get_type(), NULL);
+    pool->allocated = g_atomic_rc_box_acquire(pools->allocated);
+    config = gst_buffer_pool_get_config(GST_BUFFER_POOL(pool));
+    // 최대 0 = 제한 없음: leaky 큐가 버퍼를 잡고 있어도 상류가 풀을 기다리며 멈추지 않음
+    gst_buffer_pool_config_set_params(config, caps, (guint)GST_VIDEO_INFO_SIZE(&video_info), pools->min_buffers, 0);
+    if (!gst_buffer_pool_set_config(GST_BUFFER_POOL(pool), config)) {
+        gst_object_unref(pool);
+        return GST_PAD_PROBE_OK;
+    }
+    gst_query_add_allocation_pool(query, GST_BUFFER_POOL(pool), (guint)GST_VIDEO_INFO_SIZE(&video_info), pools->min_buffers, 0);
+    gst_object_unref(pool);
+    g_atomic_int_inc(&pools->proposed);
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn unpooled_buffer_probe(GstPad* pad, GstPadProbeInfo* info, FramePools* pools) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+
+    g_atomic_int_inc(&pools->buffers);
+    if (buffer->pool == NULL)
+        g_atomic_int_inc(&pools->unpooled);
+    return GST_PAD_PROBE_OK;
+}
+
+static gboolean sample_allocations(FramePools* pools) {
+    guint allocations = frame_pools_get_allocations(pools);
+    gint64 now = g_get_monotonic_time();
+
+    if (pools->last_sample_us > 0 && now > pools->last_sample_us)
+        pools->allocs_per_sec = (allocations - pools->last_allocations) * (gdouble)G_USEC_PER_SEC / (now - pools->last_sample_us);
+    pools->last_allocations = allocations;
+    pools->last_sample_us = now;
+    return G_SOURCE_CONTINUE;
+}
+
+FramePools* frame_pools_new(guint min_buffers) {
+    FramePools* pools = g_new0(FramePools, 1);
+
+    pools->min_buffers = min_buffers;
+    pools->allocated = g_atomic_rc_box_new0(gint);
+    sample_allocations(pools);
+    pools->sample_id = g_timeout_add_seconds(ALLOC_SAMPLE_INTERVAL_S, (GSourceFunc)sample_allocations, pools);
+    return pools;
+}
+
+void frame_pools_free(FramePools* pools) {
+    if (!pools)
+        return;
+    g_source_remove(pools->sample_id);
+    g_atomic_rc_box_release(pools->allocated);
+    g_free(pools);
+}
+
+void frame_pools_watch_pad(FramePools* pools, GstPad* pad, gboolean count_buffers) {
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM, (GstPadProbeCallback)allocation_query_probe, pools, NULL);
+    if (count_buffers)
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)unpooled_buffer_probe, pools, NULL);
+}
+
+guint frame_pools_get_allocations(FramePools* pools) {
+    return (guint)(g_atomic_int_get(pools->allocated) + g_atomic_int_get(&pools->unpooled));
+}
+
+void frame_pools_append_json(FramePools* pools, GString* json) {
+    g_string_append_printf(json,
+        "{\"min_buffers\":%u,\"proposed\":%d,\"shared\":%d,\"allocated\":%d,\"buffers\":%d,\"unpooled\":%d,\"allocs_per_sec\":%.1f}",
+        pools->min_buffers, g_atomic_int_get(&pools->proposed), g_atomic_int_get(&pools->shared),
+        g_atomic_int_get(pools->allocated), g_atomic_int_get(&pools->buffers), g_atomic_int_get(&pools->unpooled),
+        pools->allocs_per_sec);
+}
@@ -0,0 +1,30 @@
+#ifndef CLIPPER_FRAMEPOOL_H
+#define CLIPPER_FRAMEPOOL_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// raw 프레임 버퍼 풀 (카메라당 하나).
+// 지켜보는 패드의 ALLOCATION 쿼리가 하류에서 돌아왔을 때 풀이 없으면 caps 크기에 맞춘 풀을 넣어서
+// 상류(디코더, videoconvert/videoscale)가 프레임마다 새로 할당하지 않고 미리 할당해 둔 버퍼를 돌려 쓰게 한다.
+// 하류(싱크 등)가 이미 풀을 제안했으면 그 풀을 그대로 쓴다 (shared).
+// 넣은 풀이 새 버퍼를 만든 횟수와 풀 밖에서 만들어진 버퍼 수를 세어 정상 상태에서 할당이 0인지 확인한다.
+typedef struct _FramePools FramePools;
+
+// min_buffers: 제안하는 풀이 활성화될 때 미리 할당할 버퍼 수 (0 = 풀을 제안하지 않고 집계만)
+FramePools* frame_pools_new(guint min_buffers);
+// 파이프라인을 해제한 뒤에 호출 (하류가 아직 잡고 있는 풀은 할당 카운터 참조를 따로 가짐)
+void frame_pools_free(FramePools* pools);
+
+// pad를 지나가는 ALLOCATION 쿼리에 풀 제안. count_buffers면 이 패드의 버퍼 중 풀 밖에서 할당된 버퍼도 셈
+void frame_pools_watch_pad(FramePools* pools, GstPad* pad, gboolean count_buffers);
+
+// 제안한 풀 수, 하류 풀을 쓴 쿼리 수, 제안한 풀의 할당 수, 풀 밖 버퍼 수와 최근 1초의 초당 할당 (메인 루프 스레드)
+void frame_pools_append_json(FramePools* pools, GString* json);
+// 누적 할당 수 (제안한 풀의 할당 + 풀 밖 버퍼)
+guint frame_pools_get_allocations(FramePools* pools);
+
+G_END_DECLS
+
+#endif // CLIPPER_FRAMEPOOL_H
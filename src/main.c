@@ -1,6 +1,13 @@
 #include <gst/gst.h>
 #include <glib.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "camera.h"
+#include "control.h"
+#include "segcache.h"
 
 #ifdef __APPLE__
 #include <TargetConditionals.h>
@@ -8,391 +15,864 @@
 
 #define DEFAULT_RTSP_URI "http://cctvsec.ktict.co.kr/138//JTYQpiZnGi4tnbFrn9n6pIiSJcySItxTBwQWVCrVLclBVzg4Fkof3+g7F4ae9hmVxX5rvfUcP+jTHNPljaZSBMkjpQnnxVKaUQo+7ilJFQ="
 
-typedef struct _CustomData {
-    GstElement* pipeline;
-    GstElement* uri_decode_bin;
-    GstElement* video_tee;
-    GstElement* video_queue_display;
-    GstElement* video_convert_display;
-    GstElement* video_sink_display;
-    GstElement* video_queue_record;
-    GstElement* video_valve;
-    GstElement* video_convert_record;
-    GstElement* video_encoder;
-    GstElement* muxer;
-    GstElement* file_sink;
-
+#define DEFAULT_PREROLL_SEC 10.0
+#define DEFAULT_PREROLL_MAX_SEC 30.0
+#define DEFAULT_PREROLL_MAX_MB 64
+#define DEFAULT_SEGMENT_SEC 300
+#define DEFAULT_FRAGMENT_MS 1000
+#define DEFAULT_DISPLAY_QUEUE_MB 16
+#define DEFAULT_DISPLAY_QUEUE_MS 500
+#define DEFAULT_RECORD_QUEUE_MB 64
+#define DEFAULT_RECORD_QUEUE_MS 2000
+#define DEFAULT_SOURCE_TIMEOUT_MS 5000
+#define DEFAULT_RECONNECT_MAX_MS 30000
+#define DEFAULT_FRAME_POOL_MIN 4
+#define DEFAULT_MOTION_AREA_PERCENT 1.0
+#define DEFAULT_MOTION_HOLD_SEC 5.0
+#define DEFAULT_MOTION_CPU_PERCENT 10.0
+#define DEFAULT_SHM_FRAMES 4
+#define DEFAULT_SHM_READER_TIMEOUT_MS 1000
+#define DEFAULT_SEGMENT_CACHE_MB 1024
+#define DEFAULT_WRITER_CHUNK_KB 1024
+#define DEFAULT_WRITER_INFLIGHT_MB 32
+
+// 설정 파일에서 카메라를 정의하는 그룹 이름 접두사 (예: [camera lobby])
+#define CONFIG_CAMERA_GROUP_PREFIX "camera "
+
+typedef struct _AppData {
+    ClipperConfig config;
+    GPtrArray* cameras;     // Camera*
+    guint n_finished;
     GMainLoop* loop;
-    gboolean recording;
-} CustomData;
+    FILE* metrics_out;      // 계측 dump 출력 (stdout 또는 --metrics-file)
+    ControlServer* control; // --control-socket (NULL = stdin만)
+    SegmentCache* segment_cache;    // --segment-cache (HLS 세그먼트 프록시)
+    GPtrArray* pool;        // URI 없이 READY 상태로 미리 만든 카메라 (--pool)
+    guint pool_size;
+    guint n_pooled;         // 풀 카메라 이름 번호
+    guint pool_refill_id;
+    glong rss_base_kb;      // 첫 보고서 때의 RSS (이후 증가량 보고)
+} AppData;
 
 // 함수 선언
-static void pad_added_handler(GstElement* src, GstPad* new_pad, CustomData* data);
-static gboolean bus_call(GstBus* bus, GstMessage* msg, CustomData* data);
-static void start_recording(CustomData* data);
-static void stop_recording(CustomData* data);
-static gboolean handle_keyboard(GIOChannel* source, GIOCondition condition, CustomData* data);
+static gboolean load_cameras_from_config(AppData* app, const gchar* path);
+static gboolean add_camera(AppData* app, const gchar* name, const gchar* uri);
+static gboolean refill_pool(AppData* app);
+static void camera_finished(Camera* camera, AppData* app);
+static Camera* find_camera(AppData* app, const gchar* key);
+static void print_report(AppData* app);
+static gboolean prefer_proxied_hls_demuxer(void);
+static gboolean report_timeout(AppData* app);
+static gboolean metrics_timeout(AppData* app);
+static gboolean handle_keyboard(GIOChannel* source, GIOCondition condition, AppData* app);
+static void handle_command(const gchar* line, GString* reply, AppData* app);
 
 
 int clipper_main(int argc, char* argv[]) {
-    CustomData data;
-    GstBus* bus;
+    AppData app;
     GIOChannel* io_stdin;
-    const gchar* hls_uri = DEFAULT_RTSP_URI;
-
-    // 초기화
-    gst_init(&argc, &argv);
-    memset(&data, 0, sizeof(data));
-    data.recording = FALSE;
-
-    // --- 1. 엘리먼트 생성 ---
-    data.pipeline = gst_pipeline_new("hls-stream-clipper-pipeline");
-    if (!data.pipeline) {
-        g_printerr("Pipeline element could not be created.\n");
-        return -1;
-    }
-
-    // uridecodebin 생성
-    data.uri_decode_bin = gst_element_factory_make("uridecodebin", "uri-source-decoder");
-    if (!data.uri_decode_bin) {
-        g_printerr("uridecodebin element could not be created. Check core GStreamer installation.\n");
-        gst_object_unref(data.pipeline);
-        return -1;
-    }
-    // URI 설정
-    g_object_set(G_OBJECT(data.uri_decode_bin), "uri", hls_uri, NULL);
-
-    data.video_tee = gst_element_factory_make("tee", "video_tee");
-
-    // 재생 엘리먼트 생성
-    data.video_queue_display = gst_element_factory_make("queue", "video_queue_display");
-    data.video_convert_display = gst_element_factory_make("videoconvert", "video_convert_display");
-    data.video_sink_display = gst_element_factory_make("autovideosink", "video_sink_display");
-
-    // 녹화 엘리먼트 생성
-    data.video_queue_record = gst_element_factory_make("queue", "video_queue_record");
-    data.video_valve = gst_element_factory_make("valve", "video_valve");
-    data.video_convert_record = gst_element_factory_make("videoconvert", "video_convert_record");
-    data.video_encoder = gst_element_factory_make("x264enc", "video_encoder"); // x264enc는 -ugly 플러그인 필요 가능성 있음
-    data.muxer = gst_element_factory_make("mp4mux", "muxer");
-    data.file_sink = gst_element_factory_make("filesink", "file_sink");
-
-    // 모든 필수 엘리먼트 생성 확인
-    if (!data.video_tee || !data.video_queue_display || !data.video_convert_display || !data.video_sink_display ||
-        !data.video_queue_record || !data.video_valve || !data.video_convert_record || !data.video_encoder ||
-        !data.muxer || !data.file_sink) {
-        g_printerr("Not all processing elements could be created. Check GStreamer plugin installations (e.g., -base, -good, -ugly).\n");
-        gst_object_unref(data.pipeline); // uri_decode_bin도 unref됨
-        return -1;
-    }
-
-    // 엘리먼트 속성 설정
-    g_object_set(G_OBJECT(data.video_valve), "drop", TRUE, NULL);
-    g_object_set(G_OBJECT(data.file_sink), "location", "result.mp4", NULL);
-
-    // --- 2. 파이프라인에 엘리먼트 추가 ---
-    gst_bin_add_many(GST_BIN(data.pipeline),
-        data.uri_decode_bin, data.video_tee,
-        data.video_queue_display, data.video_convert_display, data.video_sink_display,
-        data.video_queue_record, data.video_valve, data.video_convert_record, data.video_encoder,
-        data.muxer, data.file_sink,
-        NULL);
-
-    // --- 3. 엘리먼트 연결 ---
-    // uridecodebin의 pad-added 시그널 연결 (동적 연결 처리)
-    g_signal_connect(data.uri_decode_bin, "pad-added", G_CALLBACK(pad_added_handler), &data);
-
-    // Tee 패드 요청 및 정적 연결 (Tee -> 큐)
-    GstPadTemplate* tee_src_pad_template;
-    GstPad* tee_video_pad1, * tee_video_pad2;
-    GstPad* queue_display_sink_pad, * queue_record_sink_pad;
-
-    tee_src_pad_template = gst_element_class_get_pad_template(GST_ELEMENT_GET_CLASS(data.video_tee), "src_%u");
-    if (!tee_src_pad_template) {
-        g_printerr("Unable to get Tee src pad template.\n");
-        gst_object_unref(data.pipeline);
-        return -1;
-    }
-
-    // Tee -> 재생 큐 연결
-    tee_video_pad1 = gst_element_request_pad(data.video_tee, tee_src_pad_template, NULL, NULL);
-    g_print("Obtained request pad %s for display branch.\n", gst_pad_get_name(tee_video_pad1));
-    queue_display_sink_pad = gst_element_get_static_pad(data.video_queue_display, "sink");
-    if (!tee_video_pad1 || !queue_display_sink_pad ||
-        gst_pad_link(tee_video_pad1, queue_display_sink_pad) != GST_PAD_LINK_OK) {
-        g_printerr("Video Tee to display queue could not be linked.\n");
-        if (tee_video_pad1) gst_object_unref(tee_video_pad1);
-        if (queue_display_sink_pad) gst_object_unref(queue_display_sink_pad);
-        gst_object_unref(data.pipeline);
-        return -1;
-    }
-    gst_object_unref(queue_display_sink_pad);
-
-    // Tee -> 녹화 큐 연결
-    tee_video_pad2 = gst_element_request_pad(data.video_tee, tee_src_pad_template, NULL, NULL);
-    g_print("Obtained request pad %s for record branch.\n", gst_pad_get_name(tee_video_pad2));
-    queue_record_sink_pad = gst_element_get_static_pad(data.video_queue_record, "sink");
-    if (!tee_video_pad2 || !queue_record_sink_pad ||
-        gst_pad_link(tee_video_pad2, queue_record_sink_pad) != GST_PAD_LINK_OK) {
-        g_printerr("Video Tee to record queue could not be linked.\n");
-        gst_object_unref(tee_video_pad1); // 이전에 성공한 pad도 해제해야 함
-        if (tee_video_pad2) gst_object_unref(tee_video_pad2);
-        if (queue_record_sink_pad) gst_object_unref(queue_record_sink_pad);
-        gst_object_unref(data.pipeline);
-        return -1;
-    }
-    gst_object_unref(queue_record_sink_pad);
-
-    // 요청했던 Tee 패드 해제 (연결 후에는 필요 없음)
-    gst_object_unref(tee_video_pad1);
-    gst_object_unref(tee_video_pad2);
-
-    // 나머지 정적 연결
-    // 비디오 재생 브랜치
-    if (!gst_element_link_many(data.video_queue_display, data.video_convert_display, data.video_sink_display, NULL)) {
-        g_printerr("Video display elements could not be linked.\n");
-        gst_object_unref(data.pipeline);
-        return -1;
-    }
-    // 비디오 녹화 브랜치 (muxer까지)
-    if (!gst_element_link_many(data.video_queue_record, data.video_valve, data.video_convert_record, data.video_encoder, data.muxer, NULL)) {
-        g_printerr("Video recording elements (up to muxer) could not be linked.\n");
-        gst_object_unref(data.pipeline);
-        return -1;
-    }
-    // Muxer -> File Sink 연결
-    // mp4mux는 보통 video/audio 패드를 동적으로 요청해야 함. 여기서는 간단한 link 시도.
-    // 실제로는 encoder의 src 패드와 muxer의 video_%u 요청 패드를 연결해야 할 수 있음.
-    if (!gst_element_link(data.muxer, data.file_sink)) {
-        g_printerr("Muxer to filesink could not be linked. Might need specific pad linking for mp4mux.\n");
-        gst_object_unref(data.pipeline);
-        return -1;
-    }
-
-    // --- 4. 메인 루프 및 버스 설정 ---
-    data.loop = g_main_loop_new(NULL, FALSE);
-    bus = gst_pipeline_get_bus(GST_PIPELINE(data.pipeline));
-    gst_bus_add_watch(bus, (GstBusFunc)bus_call, &data);
-    gst_object_unref(bus);
+    GOptionContext* context;
+    GError* error = NULL;
+    gchar** uris = NULL;
+    gchar* config_path = NULL;
+    gboolean test_source = FALSE;
+    gboolean passthrough = FALSE;
+    gdouble preroll_sec = DEFAULT_PREROLL_SEC;
+    gdouble preroll_max_sec = DEFAULT_PREROLL_MAX_SEC;
+    gint preroll_max_mb = DEFAULT_PREROLL_MAX_MB;
+    gchar* record_mode = NULL;
+    gint segment_sec = DEFAULT_SEGMENT_SEC;
+    gint segment_mb = 0;
+    gint fragment_ms = DEFAULT_FRAGMENT_MS;
+    gchar* encoder_profile = NULL;
+    gchar* output_dir = NULL;
+    gboolean headless = FALSE;
+    gint display_queue_mb = DEFAULT_DISPLAY_QUEUE_MB;
+    gint display_queue_ms = DEFAULT_DISPLAY_QUEUE_MS;
+    gint record_queue_mb = DEFAULT_RECORD_QUEUE_MB;
+    gint record_queue_ms = DEFAULT_RECORD_QUEUE_MS;
+    gint thumbnail_sec = 0;
+    gint source_timeout_ms = DEFAULT_SOURCE_TIMEOUT_MS;
+    gint reconnect_max_ms = DEFAULT_RECONNECT_MAX_MS;
+    gint report_interval = 0;
+    gint metrics_interval = 0;
+    gchar* metrics_path = NULL;
+    gchar* control_path = NULL;
+    gboolean preload = FALSE;
+    gboolean abr = FALSE;
+    gboolean motion = FALSE;
+    gdouble motion_area = DEFAULT_MOTION_AREA_PERCENT;
+    gdouble motion_hold_sec = DEFAULT_MOTION_HOLD_SEC;
+    gdouble motion_cpu = DEFAULT_MOTION_CPU_PERCENT;
+    gchar* shm_dir = NULL;
+    gint shm_frames = DEFAULT_SHM_FRAMES;
+    gint shm_reader_timeout_ms = DEFAULT_SHM_READER_TIMEOUT_MS;
+    gchar* segment_cache_dir = NULL;
+    gint segment_cache_mb = DEFAULT_SEGMENT_CACHE_MB;
+    gint pool_size = 0;
+    gint frame_pool_min = DEFAULT_FRAME_POOL_MIN;
+    gboolean decode_all = FALSE;
+    gint convert_threads = 1;
+    gint display_threads = 1;
+    gint record_threads = 1;
+    gint worker_limit = 0;
+    gboolean async_writer = FALSE;
+    gint writer_chunk_kb = DEFAULT_WRITER_CHUNK_KB;
+    gint writer_inflight_mb = DEFAULT_WRITER_INFLIGHT_MB;
+    gint writer_sync_mb = 0;
+    gint writer_sync_ms = 0;
+    gchar* cpus = NULL;
+    gint cpus_per_camera = 0;
+    gint thread_nice = 0;
+    gint64 start;
+    gint ret = -1;
+    guint i;
+    GOptionEntry entries[] = {
+        { "uri", 'u', 0, G_OPTION_ARG_STRING_ARRAY, &uris, "Source URI, repeat for several cameras (\"test:\" uses videotestsrc)", "URI" },
+        { "config", 'c', 0, G_OPTION_ARG_FILENAME, &config_path, "Key file with one [camera NAME] group (uri=...) per camera", "FILE" },
+        { "test-source", 't', 0, G_OPTION_ARG_NONE, &test_source, "Use videotestsrc instead of the URI source", NULL },
+        { "passthrough", 0, 0, G_OPTION_ARG_NONE, &passthrough, "Record the source H.264 stream without re-encoding", NULL },
+        { "preroll", 'p', 0, G_OPTION_ARG_DOUBLE, &preroll_sec, "Seconds of video kept before 'r' is pressed", "SEC" },
+        { "preroll-max-time", 0, 0, G_OPTION_ARG_DOUBLE, &preroll_max_sec, "Upper bound of the pre-roll ring in seconds", "SEC" },
+        { "preroll-max-mb", 0, 0, G_OPTION_ARG_INT, &preroll_max_mb, "Upper bound of the pre-roll ring in MiB", "MB" },
+        { "record-mode", 'm', 0, G_OPTION_ARG_STRING, &record_mode, "'clip' (toggle with 'r', default) or 'continuous' (segmented)", "MODE" },
+        { "segment-time", 0, 0, G_OPTION_ARG_INT, &segment_sec, "Continuous mode: start a new file after N seconds (0 = no limit)", "SEC" },
+        { "segment-mb", 0, 0, G_OPTION_ARG_INT, &segment_mb, "Continuous mode: start a new file after N MiB (0 = no limit)", "MB" },
+        { "fragment-ms", 0, 0, G_OPTION_ARG_INT, &fragment_ms, "Write fragmented MP4 with N ms fragments (0 = plain MP4)", "MS" },
+        { "encoder-profile", 'e', 0, G_OPTION_ARG_STRING, &encoder_profile, "Re-encode mode x264enc profile: low-latency, throughput, archival or default", "PROFILE" },
+        { "output-dir", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir, "Directory for recorded files (default: current directory)", "DIR" },
+        { "async-writer", 0, 0, G_OPTION_ARG_NONE, &async_writer, "Write recorded files from a writer thread in large batches instead of filesink", NULL },
+        { "writer-chunk-kb", 0, 0, G_OPTION_ARG_INT, &writer_chunk_kb, "Async writer: write size in KiB (rounded up to 4 KiB)", "KB" },
+        { "writer-inflight-mb", 0, 0, G_OPTION_ARG_INT, &writer_inflight_mb, "Async writer: unwritten MiB per camera before the muxer waits", "MB" },
+        { "writer-sync-mb", 0, 0, G_OPTION_ARG_INT, &writer_sync_mb, "Async writer: fdatasync after every N MiB (0 = no size trigger)", "MB" },
+        { "writer-sync-ms", 0, 0, G_OPTION_ARG_INT, &writer_sync_ms, "Async writer: fdatasync every N ms (0 = no time trigger; both 0 = never)", "MS" },
+        { "headless", 0, 0, G_OPTION_ARG_NONE, &headless, "Do not build the display branch (server deployments)", NULL },
+        { "thumbnail-interval", 0, 0, G_OPTION_ARG_INT, &thumbnail_sec, "Overwrite thumb-<camera>.jpg in the output directory every N seconds", "SEC" },
+        { "display-queue-mb", 0, 0, G_OPTION_ARG_INT, &display_queue_mb, "Display queue limit in MiB, oldest frames are dropped (0 = no limit)", "MB" },
+        { "display-queue-ms", 0, 0, G_OPTION_ARG_INT, &display_queue_ms, "Display queue limit in ms, oldest frames are dropped (0 = no limit)", "MS" },
+        { "record-queue-mb", 0, 0, G_OPTION_ARG_INT, &record_queue_mb, "Record queue limit in MiB, never drops (0 = no limit)", "MB" },
+        { "record-queue-ms", 0, 0, G_OPTION_ARG_INT, &record_queue_ms, "Record queue limit in ms, never drops (0 = no limit)", "MS" },
+        { "source-timeout", 0, 0, G_OPTION_ARG_INT, &source_timeout_ms, "Rebuild the URI source after N ms without frames or on a source error (0 = exit on error)", "MS" },
+        { "reconnect-max-ms", 0, 0, G_OPTION_ARG_INT, &reconnect_max_ms, "Upper bound of the exponential reconnect backoff", "MS" },
+        { "abr", 0, 0, G_OPTION_ARG_NONE, &abr, "Cap the HLS variant bitrate when decoding/encoding falls behind real time", NULL },
+        { "motion", 0, 0, G_OPTION_ARG_NONE, &motion, "Start a clip when a downscaled analysis branch sees motion", NULL },
+        { "motion-area", 0, 0, G_OPTION_ARG_DOUBLE, &motion_area, "Percent of changed pixels counted as motion", "PERCENT" },
+        { "motion-hold", 0, 0, G_OPTION_ARG_DOUBLE, &motion_hold_sec, "Stop the motion clip after N seconds without motion", "SEC" },
+        { "motion-cpu", 0, 0, G_OPTION_ARG_DOUBLE, &motion_cpu, "CPU budget of the analysis branch in percent of one core", "PERCENT" },
+        { "shm-dir", 0, 0, G_OPTION_ARG_FILENAME, &shm_dir, "Publish decoded frames to local readers on DIR/shm-<camera>.sock (shmsink)", "DIR" },
+        { "shm-frames", 0, 0, G_OPTION_ARG_INT, &shm_frames, "Frames held in each shared memory area", "N" },
+        { "shm-reader-timeout", 0, 0, G_OPTION_ARG_INT, &shm_reader_timeout_ms, "Disconnect shared memory readers after N ms without a published frame (0 = never)", "MS" },
+        { "segment-cache", 0, 0, G_OPTION_ARG_FILENAME, &segment_cache_dir, "Keep fetched HLS segments in DIR and share them between pipelines and restarts", "DIR" },
+        { "segment-cache-mb", 0, 0, G_OPTION_ARG_INT, &segment_cache_mb, "Segment cache size limit in MiB, least recently used segments are removed", "MB" },
+        { "convert-threads", 0, 0, G_OPTION_ARG_INT, &convert_threads, "Slices of the shared videoconvert in front of the tee (re-encode mode)", "N" },
+        { "display-threads", 0, 0, G_OPTION_ARG_INT, &display_threads, "Slices of the display branch videoconvert", "N" },
+        { "record-threads", 0, 0, G_OPTION_ARG_INT, &record_threads, "Slices of the record branch videoscale (--abr)", "N" },
+        { "worker-threads", 0, 0, G_OPTION_ARG_INT, &worker_limit, "Extra conversion threads shared by all cameras (0 = cores - 1)", "N" },
+        { "cpus", 0, 0, G_OPTION_ARG_STRING, &cpus, "Run streaming threads only on these CPUs, e.g. 0-7,16-23 (Linux)", "LIST" },
+        { "cpus-per-camera", 0, 0, G_OPTION_ARG_INT, &cpus_per_camera, "Give each camera the next N CPUs of --cpus in turn (0 = all of them)", "N" },
+        { "thread-nice", 0, 0, G_OPTION_ARG_INT, &thread_nice, "Nice value of streaming threads (0 = unchanged, negative needs CAP_SYS_NICE)", "N" },
+        { "decode-all", 0, 0, G_OPTION_ARG_NONE, &decode_all, "Also decode audio/subtitle streams the clipper never uses", NULL },
+        { "frame-pool", 0, 0, G_OPTION_ARG_INT, &frame_pool_min, "Preallocate N raw frames per proposed buffer pool (0 = only count allocations)", "N" },
+        { "report-interval", 0, 0, G_OPTION_ARG_INT, &report_interval, "Print per-camera memory/thread report every N seconds", "SEC" },
+        { "metrics-interval", 0, 0, G_OPTION_ARG_INT, &metrics_interval, "Enable per-element metrics probes and dump them every N seconds", "SEC" },
+        { "metrics-file", 0, 0, G_OPTION_ARG_FILENAME, &metrics_path, "Append metrics (JSON lines) to FILE instead of stdout", "FILE" },
+        { "preload", 0, 0, G_OPTION_ARG_NONE, &preload, "Load all needed plugins before building the first camera", NULL },
+        { "pool", 0, 0, G_OPTION_ARG_INT, &pool_size, "Keep N pre-built READY pipelines for cameras added with 'add NAME URI'", "N" },
+        { "control-socket", 0, 0, G_OPTION_ARG_FILENAME, &control_path, "Accept line commands (start/stop/preroll/status) on a Unix socket", "PATH" },
+        { NULL }
+    };
+
+    // 옵션 검사에 실패해도 cleanup에서 app을 읽으므로 먼저 비움
+    memset(&app, 0, sizeof(app));
+
+    // 초기화 (gst_init 옵션 그룹 포함)
+    context = g_option_context_new("- HLS stream clipper");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    // gst_init(레지스트리 로드/스캔 포함)은 옵션 파싱 중에 실행됨
+    start = g_get_monotonic_time();
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        goto cleanup;
+    }
+    g_option_context_free(context);
+    g_print("Startup: gst_init %.1f ms\n", (g_get_monotonic_time() - start) / 1000.0);
+    if (preroll_sec < 0 || preroll_max_sec < 0 || preroll_max_mb <= 0) {
+        g_printerr("Invalid pre-roll limits.\n");
+        goto cleanup;
+    }
+    if (segment_sec < 0 || segment_mb < 0 || fragment_ms < 0 || thumbnail_sec < 0) {
+        g_printerr("Invalid segment limits.\n");
+        goto cleanup;
+    }
+    if (display_queue_mb < 0 || display_queue_ms < 0 || record_queue_mb < 0 || record_queue_ms < 0 ||
+        display_queue_mb >= 4096 || record_queue_mb >= 4096) {
+        g_printerr("Invalid queue limits.\n");
+        goto cleanup;
+    }
+    if (convert_threads < 0 || display_threads < 0 || record_threads < 0 || worker_limit < 0) {
+        g_printerr("Invalid conversion thread counts.\n");
+        goto cleanup;
+    }
+    if (writer_chunk_kb <= 0 || writer_chunk_kb > 65536 || writer_inflight_mb <= 0 || writer_sync_mb < 0 || writer_sync_ms < 0) {
+        g_printerr("Invalid async writer limits.\n");
+        goto cleanup;
+    }
+    if (cpus_per_camera < 0 || thread_nice < -20 || thread_nice > 19) {
+        g_printerr("Invalid CPU pinning settings.\n");
+        goto cleanup;
+    }
+    if (pool_size < 0 || frame_pool_min < 0) {
+        g_printerr("Invalid pool size.\n");
+        goto cleanup;
+    }
+    if (source_timeout_ms < 0 || reconnect_max_ms < 0) {
+        g_printerr("Invalid source watchdog limits.\n");
+        goto cleanup;
+    }
+    if (motion_area <= 0 || motion_area > 100 || motion_hold_sec < 0 || motion_cpu <= 0 || motion_cpu > 100) {
+        g_printerr("Invalid motion detection limits.\n");
+        goto cleanup;
+    }
+    if (segment_cache_mb <= 0) {
+        g_printerr("Invalid segment cache size.\n");
+        goto cleanup;
+    }
+    if (shm_frames <= 0 || shm_reader_timeout_ms < 0) {
+        g_printerr("Invalid shared memory limits.\n");
+        goto cleanup;
+    }
+    if (record_mode && g_strcmp0(record_mode, "clip") != 0 && g_strcmp0(record_mode, "continuous") != 0) {
+        g_printerr("Unknown record mode '%s' (expected 'clip' or 'continuous').\n", record_mode);
+        goto cleanup;
+    }
+    if (encoder_profile && !camera_encoder_profile_is_valid(encoder_profile)) {
+        g_printerr("Unknown encoder profile '%s' (expected 'low-latency', 'throughput', 'archival' or 'default').\n", encoder_profile);
+        goto cleanup;
+    }
+
+    app.config.passthrough = passthrough;
+    app.config.preroll = (GstClockTime)(preroll_sec * GST_SECOND);
+    app.config.preroll_max_time = (GstClockTime)(preroll_max_sec * GST_SECOND);
+    app.config.preroll_max_bytes = (guint64)preroll_max_mb * 1024 * 1024;
+    app.config.record_mode = g_strcmp0(record_mode, "continuous") == 0 ? RECORD_MODE_CONTINUOUS : RECORD_MODE_CLIP;
+    app.config.segment_max_time = (GstClockTime)segment_sec * GST_SECOND;
+    app.config.segment_max_bytes = (guint64)segment_mb * 1024 * 1024;
+    app.config.fragment_duration = (guint)fragment_ms;
+    app.config.output_dir = output_dir ? output_dir : ".";
+    app.config.encoder_profile = encoder_profile;
+    app.config.async_writer = async_writer;
+    app.config.writer_chunk_bytes = (guint)writer_chunk_kb * 1024;
+    app.config.writer_max_inflight = (guint64)writer_inflight_mb * 1024 * 1024;
+    app.config.writer_sync_bytes = (guint64)writer_sync_mb * 1024 * 1024;
+    app.config.writer_sync_interval = (GstClockTime)writer_sync_ms * GST_MSECOND;
+    app.config.metrics = metrics_interval > 0;
+    app.config.headless = headless;
+    app.config.display_queue_max_bytes = (guint)display_queue_mb * 1024 * 1024;
+    app.config.display_queue_max_time = (GstClockTime)display_queue_ms * GST_MSECOND;
+    app.config.record_queue_max_bytes = (guint)record_queue_mb * 1024 * 1024;
+    app.config.record_queue_max_time = (GstClockTime)record_queue_ms * GST_MSECOND;
+    app.config.thumbnail_interval = (guint)thumbnail_sec;
+    app.config.source_timeout = (GstClockTime)source_timeout_ms * GST_MSECOND;
+    app.config.reconnect_max_delay = (GstClockTime)reconnect_max_ms * GST_MSECOND;
+    app.config.abr = abr;
+    app.config.frame_pool_min = (guint)frame_pool_min;
+    app.config.decode_all_streams = decode_all;
+    app.config.convert_threads = (guint)convert_threads;
+    app.config.display_threads = (guint)display_threads;
+    app.config.record_threads = (guint)record_threads;
+    workers_set_limit((guint)worker_limit);
+    app.config.motion = motion;
+    app.config.motion_min_area = motion_area / 100.0;
+    app.config.motion_hold = (GstClockTime)(motion_hold_sec * GST_SECOND);
+    app.config.motion_cpu_budget = motion_cpu / 100.0;
+    app.config.shm_dir = shm_dir;
+    app.config.shm_frames = (guint)shm_frames;
+    app.config.shm_reader_timeout = (GstClockTime)shm_reader_timeout_ms * GST_MSECOND;
+    app.cameras = g_ptr_array_new_with_free_func((GDestroyNotify)camera_free);
+    app.pool = g_ptr_array_new_with_free_func((GDestroyNotify)camera_free);
+    app.pool_size = (guint)pool_size;
+    app.loop = g_main_loop_new(NULL, FALSE);
+    app.metrics_out = stdout;
+    if (metrics_path) {
+        app.metrics_out = fopen(metrics_path, "a");
+        if (!app.metrics_out) {
+            g_printerr("Could not open metrics file %s.\n", metrics_path);
+            goto cleanup;
+        }
+    }
+
+    // 스트리밍 스레드 CPU 고정: 카메라를 만들 때 CPU 묶음을 차례로 배정
+    if (!affinity_configure(cpus, (guint)cpus_per_camera, thread_nice))
+        goto cleanup;
+    if (affinity_is_enabled())
+        g_print("Streaming threads: CPUs %s, %d per camera (0 = all), nice %d\n", cpus ? cpus : "unchanged", cpus_per_camera, thread_nice);
+
+    // HLS 세그먼트 캐시: 카메라를 만들기 전에 http_proxy를 바꿔야 souphttpsrc가 프록시를 거침
+    // (이미 설정된 http_proxy는 캐시가 원 서버 대신 연결하는 상위 프록시가 됨)
+    if (segment_cache_dir) {
+        const gchar* upstream_proxy = g_getenv("http_proxy");
+
+        if (!prefer_proxied_hls_demuxer())
+            goto cleanup;
+        app.segment_cache = segment_cache_new(segment_cache_dir, (guint64)segment_cache_mb * 1024 * 1024, upstream_proxy, &error);
+        if (!app.segment_cache) {
+            g_printerr("Could not start the segment cache in %s: %s\n", segment_cache_dir, error->message);
+            g_error_free(error);
+            goto cleanup;
+        }
+        if (upstream_proxy && *upstream_proxy)
+            g_print("Segment cache: forwarding to the previous http_proxy %s\n", upstream_proxy);
+        g_setenv("http_proxy", segment_cache_get_proxy_uri(app.segment_cache), TRUE);
+        g_print("Segment cache: %s via %s\n", segment_cache_dir, segment_cache_get_proxy_uri(app.segment_cache));
+    }
+
+    // --- 1. 카메라별 파이프라인 생성 ---
+    // 플러그인을 미리 로드하면 첫 카메라의 엘리먼트 생성 시간에서 dlopen 비용이 빠짐
+    if (preload || pool_size > 0) {
+        start = g_get_monotonic_time();
+        if (!camera_preload_plugins(&app.config))
+            goto cleanup;
+        g_print("Startup: plugin preload %.1f ms\n", (g_get_monotonic_time() - start) / 1000.0);
+    }
+    if (config_path && !load_cameras_from_config(&app, config_path))
+        goto cleanup;
+    for (i = 0; uris && uris[i]; i++) {
+        gchar* name = g_strdup_printf("cam%u", app.cameras->len);
+        gboolean ok = add_camera(&app, name, uris[i]);
+        g_free(name);
+        if (!ok)
+            goto cleanup;
+    }
+    if (test_source && !add_camera(&app, "test", CAMERA_TEST_URI_PREFIX))
+        goto cleanup;
+    if (app.cameras->len == 0 && !add_camera(&app, "cam0", DEFAULT_RTSP_URI))
+        goto cleanup;
+    if (pool_size > 0) {
+        start = g_get_monotonic_time();
+        refill_pool(&app);
+        g_print("Pipeline pool: %u READY pipelines in %.1f ms\n", app.pool->len, (g_get_monotonic_time() - start) / 1000.0);
+    }
+
+    // 제어 소켓 (메인 루프에서 비동기로 처리)
+    if (control_path) {
+        app.control = control_server_new(control_path, (ControlCommandFunc)handle_command, &app, &error);
+        if (!app.control) {
+            g_printerr("Could not listen on control socket %s: %s\n", control_path, error->message);
+            g_error_free(error);
+            goto cleanup;
+        }
+        g_print("Control socket: %s\n", control_path);
+    }
 
     // 표준 입력 처리 설정
     io_stdin = g_io_channel_unix_new(fileno(stdin));
     if (!io_stdin) {
         g_printerr("Could not create GIOChannel for stdin.\n");
-        gst_object_unref(data.pipeline);
-        return -1;
+        goto cleanup;
     }
     // G_IO_HUP (hang-up) 조건도 감시하여 채널이 닫혔을 때 처리
-    g_io_add_watch(io_stdin, G_IO_IN | G_IO_HUP, (GIOFunc)handle_keyboard, &data);
-
-
-    // --- 5. 파이프라인 시작 ---
-    g_print("Setting pipeline to PLAYING...\n");
-    g_print("Using URI source: %s\n", hls_uri);
-    g_print("Press 'r' to start/stop recording, 'q' to quit.\n");
-    if (gst_element_set_state(data.pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
-        g_printerr("Unable to set the pipeline to the playing state.\n");
-        gst_object_unref(data.pipeline);
-        g_io_channel_unref(io_stdin);
-        return -1;
+    g_io_add_watch(io_stdin, G_IO_IN | G_IO_HUP, (GIOFunc)handle_keyboard, &app);
+    if (report_interval > 0)
+        g_timeout_add_seconds(report_interval, (GSourceFunc)report_timeout, &app);
+    if (metrics_interval > 0)
+        g_timeout_add_seconds(metrics_interval, (GSourceFunc)metrics_timeout, &app);
+
+    // --- 2. 파이프라인 시작 ---
+    g_print("Setting %u pipeline(s) to PLAYING...\n", app.cameras->len);
+    if (passthrough)
+        g_print("Record mode: passthrough (no re-encode)\n");
+    else
+        g_print("Record mode: re-encode (x264enc, profile %s)\n", encoder_profile ? encoder_profile : "default");
+    if (app.config.record_mode == RECORD_MODE_CONTINUOUS)
+        g_print("Continuous recording: new file every %d s / %d MiB (0 = no limit)\n", segment_sec, segment_mb);
+    else
+        g_print("Pre-roll: %.1f s (ring limit %.1f s / %d MiB)\n", preroll_sec, MAX(preroll_sec, preroll_max_sec), preroll_max_mb);
+    if (async_writer)
+        g_print("Async writer: %d KiB writes, %d MiB in flight per camera, fdatasync every %d MiB / %d ms (0 = off)\n",
+            writer_chunk_kb, writer_inflight_mb, writer_sync_mb, writer_sync_ms);
+    if (headless)
+        g_print("Headless: no display branch%s\n", thumbnail_sec > 0 ? ", thumbnails only" : "");
+    g_print("Commands: 'r [camera]' toggle, 'start|stop [camera]', 'clip SEC [camera]', 'stop camera:id', 'preroll SEC [camera]', 'status [camera]', 'cache', 'add NAME URI', 's' report, 'q' quit.\n");
+    for (i = 0; i < app.cameras->len; i++) {
+        if (!camera_play(g_ptr_array_index(app.cameras, i))) {
+            g_io_channel_unref(io_stdin);
+            goto cleanup;
+        }
     }
 
-
-    // --- 6. 메인 루프 실행 ---
+    // --- 3. 메인 루프 실행 (모든 카메라가 공유) ---
     g_print("Running...\n");
-    g_main_loop_run(data.loop);
+    g_main_loop_run(app.loop);
 
-    // --- 7. 정리 ---
-    g_print("Stopping pipeline...\n");
+    // --- 4. 정리 ---
+    g_print("Stopping pipelines...\n");
     // 입력 채널 감시 제거
     g_io_channel_shutdown(io_stdin, TRUE, NULL); // Ensure channel is closed before unref
     g_io_channel_unref(io_stdin);
+    ret = 0;
 
-    gst_element_set_state(data.pipeline, GST_STATE_NULL);
+cleanup:
     g_print("Cleaning up...\n");
-    g_main_loop_unref(data.loop);
-    gst_object_unref(data.pipeline); // 파이프라인 해제 (포함된 엘리먼트들도 해제됨)
+    control_server_free(app.control);
+    if (app.pool_refill_id)
+        g_source_remove(app.pool_refill_id);
+    if (app.pool)
+        g_ptr_array_free(app.pool, TRUE);
+    if (app.cameras)
+        g_ptr_array_free(app.cameras, TRUE); // 카메라별 파이프라인 해제
+    // 파이프라인이 멈춘 뒤에 (남은 요청은 segment_cache_free가 끝날 때까지 기다림)
+    segment_cache_free(app.segment_cache);
+    affinity_shutdown();
+    if (app.loop)
+        g_main_loop_unref(app.loop);
+    if (app.metrics_out && app.metrics_out != stdout)
+        fclose(app.metrics_out);
+    g_strfreev(uris);
+    g_free(config_path);
+    g_free(record_mode);
+    g_free(output_dir);
+    g_free(encoder_profile);
+    g_free(metrics_path);
+    g_free(control_path);
+    g_free(shm_dir);
+    g_free(segment_cache_dir);
+    g_free(cpus);
+
+    return ret;
+}
 
-    return 0;
+static gboolean add_camera(AppData* app, const gchar* name, const gchar* uri) {
+    Camera* camera;
+
+    if (find_camera(app, name)) {
+        g_printerr("Duplicate camera name '%s'.\n", name);
+        return FALSE;
+    }
+    camera = camera_new(name, uri, &app->config, (CameraFinishedFunc)camera_finished, app);
+    if (!camera)
+        return FALSE;
+    g_print("[%s] Graph built: create %.1f ms, link %.1f ms\n", name,
+        camera->startup.create_us / 1000.0, camera->startup.link_us / 1000.0);
+    g_ptr_array_add(app->cameras, camera);
+    return TRUE;
 }
 
-// pad_added_handler 수정: uridecodebin에서 나오는 raw 패드를 Tee에 연결
-static void pad_added_handler(GstElement* src, GstPad* new_pad, CustomData* data) {
-    GstPad* tee_sink_pad = NULL;
-    GstPadLinkReturn ret;
-    GstCaps* new_pad_caps = NULL;
-    GstStructure* new_pad_struct = NULL;
-    const gchar* new_pad_type = NULL;
-
-    // src가 uridecodebin인지 확인 (디버깅 목적)
-    g_print("Received new pad '%s' from '%s':\n", GST_PAD_NAME(new_pad), GST_ELEMENT_NAME(src));
-
-    // 패드 캡 가져오기 (uridecodebin은 이미 디코딩된 raw 포맷 제공)
-    new_pad_caps = gst_pad_get_current_caps(new_pad);
-    if (!new_pad_caps) {
-        new_pad_caps = gst_pad_query_caps(new_pad, NULL);
-    }
-    if (!new_pad_caps) {
-        g_printerr("Could not get caps for new pad %s.\n", GST_PAD_NAME(new_pad));
-        goto exit;
-    }
-    new_pad_struct = gst_caps_get_structure(new_pad_caps, 0);
-    new_pad_type = gst_structure_get_name(new_pad_struct);
-
-    // 비디오 패드 처리 (raw video)
-    if (g_str_has_prefix(new_pad_type, "video/x-raw")) {
-        // video_tee의 싱크 패드 가져오기
-        tee_sink_pad = gst_element_get_static_pad(data->video_tee, "sink");
-        if (!tee_sink_pad) {
-            g_printerr("Could not get sink pad from video_tee.\n");
-            goto exit;
+// 풀을 pool_size까지 채움 (URI 없는 그래프를 만들어 READY로 올려 둠)
+static gboolean refill_pool(AppData* app) {
+    app->pool_refill_id = 0;
+    while (app->pool->len < app->pool_size) {
+        gchar* name = g_strdup_printf("pool%u", app->n_pooled++);
+        Camera* camera = camera_new(name, NULL, &app->config, (CameraFinishedFunc)camera_finished, app);
+
+        g_free(name);
+        if (!camera)
+            break;
+        if (!camera_prepare(camera)) {
+            camera_free(camera);
+            break;
         }
-        // 이미 연결되어 있는지 확인
-        if (gst_pad_is_linked(tee_sink_pad)) {
-            g_print("Video Tee sink pad already linked. Ignoring new pad '%s'.\n", GST_PAD_NAME(new_pad));
-            goto exit;
+        g_ptr_array_add(app->pool, camera);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+// 실행 중에 카메라 추가: 풀에 미리 만든 파이프라인이 있으면 URI만 붙여서 바로 재생, 없으면 새로 만듦
+static gboolean start_camera(AppData* app, const gchar* name, const gchar* uri, GString* reply) {
+    Camera* camera = NULL;
+    gboolean pooled = FALSE;
+    gint64 start = g_get_monotonic_time();
+
+    if (find_camera(app, name)) {
+        g_string_printf(reply, "error duplicate camera name '%s'", name);
+        return FALSE;
+    }
+    if (app->pool->len > 0 && !g_str_has_prefix(uri, CAMERA_TEST_URI_PREFIX)) {
+        camera = g_ptr_array_steal_index(app->pool, app->pool->len - 1);
+        pooled = camera_bind(camera, name, uri);
+        if (!pooled) {
+            camera_free(camera);
+            camera = NULL;
         }
-        // 연결 시도
-        ret = gst_pad_link(new_pad, tee_sink_pad);
-        if (GST_PAD_LINK_FAILED(ret)) {
-            g_printerr("Link failed for raw video pad: %s\n", gst_pad_link_get_name(ret));
+    }
+    if (!camera)
+        camera = camera_new(name, uri, &app->config, (CameraFinishedFunc)camera_finished, app);
+    if (!camera) {
+        g_string_printf(reply, "error camera '%s' could not be built", name);
+        return FALSE;
+    }
+    g_ptr_array_add(app->cameras, camera);
+    if (!camera_play(camera)) {
+        g_ptr_array_remove(app->cameras, camera);
+        g_string_printf(reply, "error camera '%s' could not be started", name);
+        return FALSE;
+    }
+    g_string_append_printf(reply, " %s %s %.3f ms", name, pooled ? "pooled" : "built",
+        (g_get_monotonic_time() - start) / 1000.0);
+    // 꺼낸 만큼 메인 루프가 한가할 때 다시 채움
+    if (pooled && !app->pool_refill_id)
+        app->pool_refill_id = g_idle_add((GSourceFunc)refill_pool, app);
+    return TRUE;
+}
+
+// 설정 파일의 [camera NAME] 그룹마다 카메라 하나를 만든다
+static gboolean load_cameras_from_config(AppData* app, const gchar* path) {
+    GKeyFile* key_file = g_key_file_new();
+    GError* error = NULL;
+    gchar** groups;
+    gboolean ok = TRUE;
+    guint i;
+
+    if (!g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, &error)) {
+        g_printerr("Could not load config file %s: %s\n", path, error->message);
+        g_error_free(error);
+        g_key_file_free(key_file);
+        return FALSE;
+    }
+
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (i = 0; ok && groups[i]; i++) {
+        const gchar* name;
+        gchar* uri;
+
+        if (!g_str_has_prefix(groups[i], CONFIG_CAMERA_GROUP_PREFIX))
+            continue;
+        name = groups[i] + strlen(CONFIG_CAMERA_GROUP_PREFIX);
+        uri = g_key_file_get_string(key_file, groups[i], "uri", &error);
+        if (!uri) {
+            g_printerr("Camera '%s' in %s: %s\n", name, path, error->message);
+            g_clear_error(&error);
+            ok = FALSE;
+            break;
         }
-        else {
-            g_print("Link succeeded for raw video pad (type '%s').\n", new_pad_type);
+        ok = add_camera(app, name, uri);
+        g_free(uri);
+    }
+    g_strfreev(groups);
+    g_key_file_free(key_file);
+    return ok;
+}
+
+// 모든 카메라가 끝나면 메인 루프 종료
+static void camera_finished(Camera* camera, AppData* app) {
+    // 풀에서 대기 중인 카메라는 집계하지 않음
+    if (!g_ptr_array_find(app->cameras, camera, NULL))
+        return;
+    gst_element_set_state(camera->pipeline, GST_STATE_NULL);
+    app->n_finished++;
+    if (app->n_finished == app->cameras->len && g_main_loop_is_running(app->loop))
+        g_main_loop_quit(app->loop);
+}
+
+// 이름 또는 인덱스로 카메라 찾기
+static Camera* find_camera(AppData* app, const gchar* key) {
+    gchar* end = NULL;
+    guint64 index;
+    guint i;
+
+    for (i = 0; i < app->cameras->len; i++) {
+        Camera* camera = g_ptr_array_index(app->cameras, i);
+        if (g_strcmp0(camera->name, key) == 0)
+            return camera;
+    }
+    index = g_ascii_strtoull(key, &end, 10);
+    if (end != key && *end == '\0' && index < app->cameras->len)
+        return g_ptr_array_index(app->cameras, index);
+    return NULL;
+}
+
+// 카메라별 보고서 + 프로세스 전체 RSS/스레드 수
+static void print_report(AppData* app) {
+    gchar* status = NULL;
+    guint i;
+
+    for (i = 0; i < app->cameras->len; i++)
+        camera_print_report(g_ptr_array_index(app->cameras, i));
+
+    if (g_file_get_contents("/proc/self/status", &status, NULL, NULL)) {
+        gchar** lines = g_strsplit(status, "\n", -1);
+        const gchar* rss = "?";
+        const gchar* threads = "?";
+        glong rss_kb = 0;
+        guint j;
+
+        for (j = 0; lines[j]; j++) {
+            if (g_str_has_prefix(lines[j], "VmRSS:"))
+                rss = g_strstrip(lines[j] + strlen("VmRSS:"));
+            else if (g_str_has_prefix(lines[j], "Threads:"))
+                threads = g_strstrip(lines[j] + strlen("Threads:"));
         }
+        // "123456 kB": 첫 보고서 이후 증가량 (정상 상태에서 프레임마다 할당하지 않으면 0 근처)
+        rss_kb = strtol(rss, NULL, 10);
+        if (app->rss_base_kb == 0)
+            app->rss_base_kb = rss_kb;
+        g_print("[process] cameras=%u rss=%s rss-growth=%+ld kB threads=%s workers=%u/%u\n", app->cameras->len, rss,
+            rss_kb - app->rss_base_kb, threads, workers_get_in_use(), workers_get_limit());
+        g_strfreev(lines);
+        g_free(status);
     }
     else {
-        g_print("Ignoring pad with type '%s'.\n", new_pad_type);
+        // /proc이 없는 플랫폼 (macOS): 최대 RSS만 보고
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        g_print("[process] cameras=%u max-rss=%ld\n", app->cameras->len, (long)usage.ru_maxrss);
+    }
+    if (app->segment_cache) {
+        GString* json = g_string_new(NULL);
+
+        segment_cache_append_json(app->segment_cache, json);
+        g_print("[segment-cache] %s\n", json->str);
+        g_string_free(json, TRUE);
     }
+    if (affinity_is_enabled()) {
+        GString* json = g_string_new(NULL);
 
-exit:
-    // 자원 해제
-    if (new_pad_caps != NULL)
-        gst_caps_unref(new_pad_caps);
-    if (tee_sink_pad != NULL)
-        gst_object_unref(tee_sink_pad);
+        affinity_append_json(json);
+        g_print("[affinity] %s\n", json->str);
+        g_string_free(json, TRUE);
+    }
 }
 
+// hlsdemux2는 souphttpsrc 대신 자체 다운로더를 쓰고 http_proxy가 아닌 시스템 프록시 설정(GProxyResolver)을 따르므로,
+// 둘 다 설치되어 있으면 souphttpsrc로 받는 hlsdemux를 고르게 함.
+// hlsdemux2만 있으면 HLS 세그먼트가 캐시를 거치지 않으므로 시작하지 않음 (FALSE)
+static gboolean prefer_proxied_hls_demuxer(void) {
+    GstPluginFeature* hlsdemux = gst_registry_lookup_feature(gst_registry_get(), "hlsdemux");
+    GstPluginFeature* hlsdemux2 = gst_registry_lookup_feature(gst_registry_get(), "hlsdemux2");
+    gboolean ok = TRUE;
+
+    if (hlsdemux && hlsdemux2) {
+        gst_plugin_feature_set_rank(hlsdemux2, GST_RANK_NONE);
+        g_print("Segment cache: using hlsdemux instead of hlsdemux2.\n");
+    }
+    else if (hlsdemux2) {
+        g_printerr("Segment cache: only hlsdemux2 is installed and it does not use http_proxy, so HLS segments would bypass the cache.\n"
+            "Install the legacy hlsdemux (hls plugin in gst-plugins-bad) or run without --segment-cache.\n");
+        ok = FALSE;
+    }
+    if (hlsdemux)
+        gst_object_unref(hlsdemux);
+    if (hlsdemux2)
+        gst_object_unref(hlsdemux2);
+    return ok;
+}
 
-// bus_call 구현 (이전과 동일)
-static gboolean bus_call(GstBus* bus, GstMessage* msg, CustomData* data) {
-    switch (GST_MESSAGE_TYPE(msg)) {
-    case GST_MESSAGE_EOS:
-        g_print("End-of-stream\n");
-        g_main_loop_quit(data->loop);
-        break;
-    case GST_MESSAGE_ERROR: {
-        gchar* debug = NULL;
-        GError* error = NULL;
-        gst_message_parse_error(msg, &error, &debug);
-        g_printerr("ERROR from element %s: %s\n", GST_OBJECT_NAME(GST_MESSAGE_SRC(msg)), error->message);
-        g_printerr("Debugging info: %s\n", (debug) ? debug : "none");
-        g_error_free(error);
-        g_free(debug);
-        g_main_loop_quit(data->loop);
-        break;
-    }
-    case GST_MESSAGE_WARNING: {
-        gchar* debug = NULL;
-        GError* error = NULL;
-        gst_message_parse_warning(msg, &error, &debug);
-        g_printerr("WARNING from element %s: %s\n", GST_OBJECT_NAME(GST_MESSAGE_SRC(msg)), error->message);
-        g_printerr("Debugging info: %s\n", (debug) ? debug : "none");
-        g_error_free(error);
-        g_free(debug);
-        break;
-    }
-    case GST_MESSAGE_STATE_CHANGED: {
-        if (GST_IS_PIPELINE(GST_MESSAGE_SRC(msg))) {
-            GstState old_state, new_state, pending_state;
-            gst_message_parse_state_changed(msg, &old_state, &new_state, &pending_state);
-            g_print("Pipeline state changed from %s to %s:\n",
-                gst_element_state_get_name(old_state), gst_element_state_get_name(new_state));
-        }
-        break;
+static gboolean report_timeout(AppData* app) {
+    print_report(app);
+    return TRUE;
+}
+
+static gboolean metrics_timeout(AppData* app) {
+    guint i;
+
+    for (i = 0; i < app->cameras->len; i++) {
+        Camera* camera = g_ptr_array_index(app->cameras, i);
+        if (camera->metrics)
+            metrics_dump(camera->metrics, app->metrics_out);
+    }
+    return TRUE;
+}
+
+// target이 NULL이면 모든 카메라, 아니면 이름/인덱스로 하나
+static gboolean select_cameras(AppData* app, const gchar* target, GPtrArray* selected, GString* reply) {
+    Camera* camera;
+    guint i;
+
+    if (!target) {
+        for (i = 0; i < app->cameras->len; i++)
+            g_ptr_array_add(selected, g_ptr_array_index(app->cameras, i));
+        return TRUE;
     }
-    default:
-        break;
+    camera = find_camera(app, target);
+    if (!camera) {
+        g_string_printf(reply, "error unknown camera '%s'", target);
+        return FALSE;
     }
+    g_ptr_array_add(selected, camera);
     return TRUE;
 }
 
-// start_recording 구현 (이전과 동일)
-static void start_recording(CustomData* data) {
-    if (!data->recording) {
-        g_print("Starting recording...\n");
-        g_object_set(G_OBJECT(data->video_valve), "drop", FALSE, NULL);
-        // 오디오 Valve 제어 (필요시)
-        data->recording = TRUE;
+// stdin과 제어 소켓이 공유하는 명령 처리. reply에는 한 줄 응답 ("ok ..." / "error ...")
+// 명령: start|stop|r [camera], clip SEC [camera], stop camera:id, preroll SEC [camera], status [camera],
+//       cache (세그먼트 캐시), add NAME URI, s (보고서), q (종료)
+static void handle_command(const gchar* line, GString* reply, AppData* app) {
+    gchar** tokens = g_strsplit_set(line, " \t", -1);
+    const gchar* args[3] = { NULL, NULL, NULL };
+    GPtrArray* selected = g_ptr_array_new();
+    const gchar* cmd;
+    guint n_args = 0;
+    guint i;
+
+    // 연속된 공백으로 생긴 빈 토큰 제외
+    for (i = 0; tokens[i] && n_args < G_N_ELEMENTS(args); i++) {
+        if (*tokens[i] != '\0')
+            args[n_args++] = tokens[i];
+    }
+    cmd = args[0] ? args[0] : "";
+    g_string_assign(reply, "ok");
+
+    if (g_ascii_strcasecmp(cmd, "r") == 0 || g_ascii_strcasecmp(cmd, "toggle") == 0) {
+        if (select_cameras(app, args[1], selected, reply))
+            g_ptr_array_foreach(selected, (GFunc)camera_toggle_recording, NULL);
+    }
+    else if (g_ascii_strcasecmp(cmd, "start") == 0 || g_ascii_strcasecmp(cmd, "clip") == 0) {
+        // start [camera] / clip SEC [camera]: 새 클립 (녹화 중인 클립과 겹쳐도 됨), 응답에 "카메라:id"
+        gboolean timed = g_ascii_strcasecmp(cmd, "clip") == 0;
+        guint64 duration = 0;
+        gchar* end = NULL;
+
+        if (timed) {
+            duration = args[1] ? g_ascii_strtoull(args[1], &end, 10) : 0;
+            if (!args[1] || end == args[1] || *end != '\0' || duration == 0 || duration > G_MAXUINT) {
+                g_string_assign(reply, "error usage: clip SEC [camera]");
+                duration = 0;
+            }
+        }
+        if ((!timed || duration > 0) && select_cameras(app, timed ? args[2] : args[1], selected, reply)) {
+            for (i = 0; i < selected->len; i++) {
+                Camera* camera = g_ptr_array_index(selected, i);
+                guint id = camera_start_clip(camera, (guint)duration);
+                if (id == 0) {
+                    g_string_printf(reply, "error camera '%s' could not start a clip", camera->name);
+                    break;
+                }
+                g_string_append_printf(reply, " %s:%u", camera->name, id);
+            }
+        }
+    }
+    else if (g_ascii_strcasecmp(cmd, "stop") == 0) {
+        // stop [camera]: 녹화 중인 모든 클립, stop camera:id: 클립 하나
+        const gchar* colon = args[1] ? strrchr(args[1], ':') : NULL;
+
+        if (colon) {
+            gchar* name = g_strndup(args[1], colon - args[1]);
+            guint64 id = g_ascii_strtoull(colon + 1, NULL, 10);
+            Camera* camera = find_camera(app, name);
+
+            if (!camera)
+                g_string_printf(reply, "error unknown camera '%s'", name);
+            else if (id == 0 || id > G_MAXUINT || !camera_stop_clip(camera, (guint)id))
+                g_string_printf(reply, "error no active clip '%s'", args[1]);
+            g_free(name);
+        }
+        else if (select_cameras(app, args[1], selected, reply)) {
+            g_ptr_array_foreach(selected, (GFunc)camera_stop_recording, NULL);
+        }
     }
+    else if (g_ascii_strcasecmp(cmd, "preroll") == 0) {
+        gchar* end = NULL;
+        gdouble seconds = args[1] ? g_ascii_strtod(args[1], &end) : -1.0;
+
+        if (!args[1] || end == args[1] || *end != '\0' || seconds < 0) {
+            g_string_assign(reply, "error usage: preroll SEC [camera]");
+        }
+        else if (select_cameras(app, args[2], selected, reply)) {
+            for (i = 0; i < selected->len; i++) {
+                Camera* camera = g_ptr_array_index(selected, i);
+                if (!camera_set_preroll(camera, (GstClockTime)(seconds * GST_SECOND)))
+                    g_string_printf(reply, "error camera '%s' is not in clip mode", camera->name);
+            }
+        }
+    }
+    else if (g_ascii_strcasecmp(cmd, "status") == 0) {
+        if (select_cameras(app, args[1], selected, reply)) {
+            g_string_append(reply, " [");
+            for (i = 0; i < selected->len; i++) {
+                if (i > 0)
+                    g_string_append_c(reply, ',');
+                camera_append_status_json(g_ptr_array_index(selected, i), reply);
+            }
+            g_string_append_c(reply, ']');
+        }
+    }
+    else if (g_ascii_strcasecmp(cmd, "cache") == 0) {
+        // cache: 세그먼트 캐시 통계 JSON
+        if (!app->segment_cache) {
+            g_string_assign(reply, "error segment cache is disabled");
+        }
+        else {
+            g_string_append_c(reply, ' ');
+            segment_cache_append_json(app->segment_cache, reply);
+        }
+    }
+    else if (g_ascii_strcasecmp(cmd, "add") == 0) {
+        // add NAME URI: 응답에 "NAME pooled|built <ms>" (명령 ~ PLAYING 요청까지)
+        if (!args[1] || !args[2])
+            g_string_assign(reply, "error usage: add NAME URI");
+        else
+            start_camera(app, args[1], args[2], reply);
+    }
+    else if (g_ascii_strcasecmp(cmd, "s") == 0 || g_ascii_strcasecmp(cmd, "report") == 0) {
+        print_report(app);
+    }
+    else if (g_ascii_strcasecmp(cmd, "q") == 0 || g_ascii_strcasecmp(cmd, "quit") == 0) {
+        g_print("Quitting...\n");
+        if (app->loop && g_main_loop_is_running(app->loop)) {
+            g_main_loop_quit(app->loop);
+        }
+    }
+    else if (strlen(cmd) > 0) {
+        g_string_printf(reply, "error unknown command '%s'", cmd);
+    }
+
+    g_ptr_array_free(selected, TRUE);
+    g_strfreev(tokens);
 }
 
-// stop_recording 구현 (이전과 동일)
-static void stop_recording(CustomData* data) {
-    if (data->recording) {
-        g_print("Stopping recording...\n");
-        g_object_set(G_OBJECT(data->video_valve), "drop", TRUE, NULL);
-        // 오디오 Valve 제어 (필요시)
-        data->recording = FALSE;
+// stdin이 닫히면: 제어 소켓이 없으면 종료, 있으면 stdin 감시만 멈춤 (데몬 실행)
+static gboolean stdin_closed(AppData* app, const gchar* reason) {
+    if (app->control) {
+        g_print("Input channel closed (%s). Still listening on the control socket.\n", reason);
+        return FALSE; // 소스 제거
+    }
+    g_print("Input channel closed (%s). Quitting...\n", reason);
+    if (app->loop && g_main_loop_is_running(app->loop)) {
+        g_main_loop_quit(app->loop);
     }
+    return FALSE; // 소스 제거
 }
 
-// handle_keyboard 구현 (이전과 동일, 입력 처리 강화)
-static gboolean handle_keyboard(GIOChannel* source, GIOCondition condition, CustomData* data) {
+// handle_keyboard 구현 (명령 처리는 제어 소켓과 공유)
+static gboolean handle_keyboard(GIOChannel* source, GIOCondition condition, AppData* app) {
     gchar* str = NULL;
     gsize len;
     GError* error = NULL;
     GIOStatus status;
 
     // 채널이 닫혔는지 확인 (예: Ctrl+D 입력)
-    if (condition & G_IO_HUP) {
-        g_print("Input channel closed (HUP). Quitting...\n");
-        if (data->loop && g_main_loop_is_running(data->loop)) {
-            g_main_loop_quit(data->loop);
-        }
-        return FALSE; // 소스 제거
-    }
+    if (condition & G_IO_HUP)
+        return stdin_closed(app, "HUP");
 
     // 입력 읽기
     status = g_io_channel_read_line(source, &str, &len, NULL, &error);
 
     if (status == G_IO_STATUS_NORMAL) {
         if (str) {
-            // 개행 문자 제거
-            str = g_strchomp(str);
-
-            if (g_strcmp0(str, "r") == 0 || g_strcmp0(str, "R") == 0) {
-                if (data->recording) stop_recording(data);
-                else start_recording(data);
-            }
-            else if (g_strcmp0(str, "q") == 0 || g_strcmp0(str, "Q") == 0) {
-                g_print("Quitting...\n");
-                if (data->loop && g_main_loop_is_running(data->loop)) {
-                    g_main_loop_quit(data->loop);
-                }
-                g_free(str);
-                return FALSE; // 소스 제거
-            }
-            else if (strlen(str) > 0) { // 빈 입력 무시
-                g_print("Unknown command: '%s'. Press 'r' to toggle recording, 'q' to quit.\n", str);
-            }
+            GString* reply = g_string_new(NULL);
+
+            // 개행 문자 제거 후 명령 처리
+            handle_command(g_strstrip(str), reply, app);
+            // 단순 "ok"는 생략 (각 동작이 이미 로그를 남김)
+            if (g_strcmp0(reply->str, "ok") != 0)
+                g_print("%s\n", reply->str);
+            g_string_free(reply, TRUE);
             g_free(str);
+            if (!g_main_loop_is_running(app->loop))
+                return FALSE; // 소스 제거
         }
     }
     else if (status == G_IO_STATUS_ERROR) {
         g_printerr("Error reading input: %s\n", error->message);
         g_error_free(error);
-        if (data->loop && g_main_loop_is_running(data->loop)) {
-            g_main_loop_quit(data->loop);
+        if (app->loop && g_main_loop_is_running(app->loop)) {
+            g_main_loop_quit(app->loop);
         }
         return FALSE; // 소스 제거
     }
     else if (status == G_IO_STATUS_EOF) {
-        g_print("Input channel closed (EOF). Quitting...\n");
-        if (data->loop && g_main_loop_is_running(data->loop)) {
-            g_main_loop_quit(data->loop);
-        }
-        return FALSE; // 소스 제거
+        return stdin_closed(app, "EOF");
     }
 
     // 소스 감시 유지
@@ -405,4 +885,4 @@ int main(int argc, char* argv[]) {
 #else
     return clipper_main(argc, argv);
 #endif
-}
\ No newline at end of file
+}
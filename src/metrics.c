@@ -0,0 +1,326 @@
+#include "metrics.h"
+
+#include <string.h>
+
+// 지연 히스토그램: i번째 칸은 [2^i, 2^(i+1)) µs
+#define LATENCY_BUCKETS 32
+// 엘리먼트 안에 동시에 머무를 수 있는 버퍼 수 (큐 용량보다 넉넉하게)
+#define INFLIGHT_SLOTS 1024
+// 이보다 오래된 (pts 기준) 미매칭 기록은 버려진 버퍼로 간주
+#define STALE_PTS (GST_SECOND)
+
+typedef struct _Inflight {
+    GstClockTime pts;
+    GstClockTime arrival;
+    gint done;                      // g_atomic_int
+} Inflight;
+
+// 엘리먼트 하나(구간 하나)의 통계. sink probe가 producer, src probe가 consumer인 SPSC 링으로
+// 같은 pts의 도착/출발 시각을 맞춰 구간 지연을 계산한다.
+typedef struct _HopStats {
+    GstElement* element;
+    gchar* name;
+    gboolean is_queue;
+
+    // g_atomic_pointer_add로 더하는 포인터 크기 카운터 (64비트 시스템에서는 바이트 수도 넘치지 않음)
+    gsize buffers_in;
+    gsize bytes_in;
+    gsize buffers_out;
+    gsize bytes_out;
+    gsize latency_count;
+    gsize latency_sum_us;
+    gsize latency_hist[LATENCY_BUCKETS];
+
+    Inflight inflight[INFLIGHT_SLOTS];
+    guint head;                     // sink probe만 증가 (g_atomic_int)
+    guint tail;                     // src probe만 증가 (g_atomic_int)
+
+    guint64 last_buffers_out;       // dump 간 처리율 계산용 (메인 스레드)
+} HopStats;
+
+struct _Metrics {
+    gchar* camera_name;
+    GMutex lock;                    // hops 배열 보호 (probe 경로에서는 사용하지 않음)
+    GPtrArray* hops;                // HopStats*
+    gint64 last_dump;
+};
+
+static void walk_downstream(Metrics* metrics, GstPad* src_pad);
+
+static void hop_stats_free(HopStats* hop) {
+    gst_object_unref(hop->element);
+    g_free(hop->name);
+    g_free(hop);
+}
+
+static guint latency_bucket(guint64 us) {
+    guint bucket = 0;
+    while (us > 1 && bucket < LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static GstPadProbeReturn hop_sink_probe(GstPad* pad, GstPadProbeInfo* info, HopStats* hop) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    guint head = g_atomic_int_get(&hop->head);
+    guint tail = g_atomic_int_get(&hop->tail);
+
+    g_atomic_pointer_add(&hop->buffers_in, 1);
+    g_atomic_pointer_add(&hop->bytes_in, gst_buffer_get_size(buffer));
+
+    // 링이 가득 차면 이 버퍼의 지연은 측정하지 않음
+    if (GST_BUFFER_PTS_IS_VALID(buffer) && head - tail < INFLIGHT_SLOTS) {
+        Inflight* slot = &hop->inflight[head % INFLIGHT_SLOTS];
+        slot->pts = GST_BUFFER_PTS(buffer);
+        slot->arrival = gst_util_get_timestamp();
+        g_atomic_int_set(&slot->done, FALSE);
+        g_atomic_int_set(&hop->head, head + 1);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn hop_src_probe(GstPad* pad, GstPadProbeInfo* info, HopStats* hop) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstClockTime pts = GST_BUFFER_PTS(buffer);
+    guint tail = g_atomic_int_get(&hop->tail);
+    guint head = g_atomic_int_get(&hop->head);
+    guint i;
+
+    g_atomic_pointer_add(&hop->buffers_out, 1);
+    g_atomic_pointer_add(&hop->bytes_out, gst_buffer_get_size(buffer));
+    if (!GST_CLOCK_TIME_IS_VALID(pts))
+        return GST_PAD_PROBE_OK;
+
+    // 인코더의 재정렬(B 프레임)을 고려해 아직 나가지 않은 기록 중 같은 pts를 찾음
+    for (i = tail; i != head; i++) {
+        Inflight* slot = &hop->inflight[i % INFLIGHT_SLOTS];
+        if (g_atomic_int_get(&slot->done))
+            continue;
+        if (slot->pts == pts) {
+            guint64 us = (gst_util_get_timestamp() - slot->arrival) / GST_USECOND;
+            g_atomic_pointer_add(&hop->latency_count, 1);
+            g_atomic_pointer_add(&hop->latency_sum_us, us);
+            g_atomic_pointer_add(&hop->latency_hist[latency_bucket(us)], 1);
+            g_atomic_int_set(&slot->done, TRUE);
+            break;
+        }
+        // 큐에서 버려졌거나 엘리먼트가 삼킨 버퍼
+        if (slot->pts + STALE_PTS < pts)
+            g_atomic_int_set(&slot->done, TRUE);
+    }
+    while (tail != head && g_atomic_int_get(&hop->inflight[tail % INFLIGHT_SLOTS].done))
+        tail++;
+    g_atomic_int_set(&hop->tail, tail);
+    return GST_PAD_PROBE_OK;
+}
+
+static HopStats* add_hop(Metrics* metrics, GstElement* element) {
+    HopStats* hop = g_new0(HopStats, 1);
+    GstElementFactory* factory = gst_element_get_factory(element);
+
+    hop->element = gst_object_ref(element);
+    hop->name = gst_element_get_name(element);
+    hop->is_queue = factory && g_strcmp0(GST_OBJECT_NAME(factory), "queue") == 0;
+    g_mutex_lock(&metrics->lock);
+    g_ptr_array_add(metrics->hops, hop);
+    g_mutex_unlock(&metrics->lock);
+    return hop;
+}
+
+static void attach_src_pad(Metrics* metrics, HopStats* hop, GstPad* src_pad) {
+    gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)hop_src_probe, hop, NULL);
+    walk_downstream(metrics, src_pad);
+}
+
+// decodebin 처럼 출력 패드가 나중에 생기는 엘리먼트
+static void dynamic_pad_added(GstElement* element, GstPad* new_pad, Metrics* metrics) {
+    HopStats* hop = g_object_get_data(G_OBJECT(element), "clipper-metrics-hop");
+
+    if (hop && GST_PAD_IS_SRC(new_pad))
+        attach_src_pad(metrics, hop, new_pad);
+}
+
+typedef struct _SrcPadSearch {
+    GstPad* pad;
+    guint n_pads;
+} SrcPadSearch;
+
+static void count_src_pad(const GValue* value, SrcPadSearch* search) {
+    GstPad* pad = g_value_get_object(value);
+    if (search->n_pads++ == 0)
+        search->pad = gst_object_ref(pad);
+}
+
+// tee처럼 요청 패드로 출력을 늘리는 엘리먼트 (record_tee의 클립별 패드는 클립마다 생겼다 사라짐)
+static gboolean has_request_src_pads(GstElement* element) {
+    GList* templates = gst_element_class_get_pad_template_list(GST_ELEMENT_GET_CLASS(element));
+
+    for (; templates; templates = templates->next) {
+        GstPadTemplate* templ = templates->data;
+
+        if (GST_PAD_TEMPLATE_DIRECTION(templ) == GST_PAD_SRC && GST_PAD_TEMPLATE_PRESENCE(templ) == GST_PAD_REQUEST)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void walk_downstream(Metrics* metrics, GstPad* src_pad) {
+    GstPad* peer = gst_pad_get_peer(src_pad);
+    GstElement* element;
+    GstIterator* it;
+    SrcPadSearch search = { NULL, 0 };
+    HopStats* hop;
+
+    if (!peer)
+        return;
+    element = gst_pad_get_parent_element(peer);
+    if (!element) {
+        gst_object_unref(peer);
+        return;
+    }
+
+    hop = add_hop(metrics, element);
+    gst_pad_add_probe(peer, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)hop_sink_probe, hop, NULL);
+
+    it = gst_element_iterate_src_pads(element);
+    gst_iterator_foreach(it, (GstIteratorForeachFunction)count_src_pad, &search);
+    gst_iterator_free(it);
+
+    if (search.n_pads == 1) {
+        attach_src_pad(metrics, hop, search.pad);
+    }
+    else if (search.n_pads == 0 && !GST_OBJECT_FLAG_IS_SET(element, GST_ELEMENT_FLAG_SINK) && !has_request_src_pads(element)) {
+        // 싱크가 아닌 bin인데 출력 패드가 없으면 나중에 생길 패드를 따라감
+        g_object_set_data(G_OBJECT(element), "clipper-metrics-hop", hop);
+        g_signal_connect(element, "pad-added", G_CALLBACK(dynamic_pad_added), metrics);
+    }
+    // 출력 패드가 여러 개이거나 요청 패드로 늘리는 엘리먼트(tee 등)는 여기서 멈춤
+    // (클립 bin은 요청 패드마다 hop이 쌓이고 클립들의 통계가 섞이므로 계측하지 않음)
+
+    if (search.pad)
+        gst_object_unref(search.pad);
+    gst_object_unref(element);
+    gst_object_unref(peer);
+}
+
+Metrics* metrics_new(const gchar* camera_name) {
+    Metrics* metrics = g_new0(Metrics, 1);
+
+    metrics->camera_name = g_strdup(camera_name);
+    g_mutex_init(&metrics->lock);
+    metrics->hops = g_ptr_array_new_with_free_func((GDestroyNotify)hop_stats_free);
+    metrics->last_dump = g_get_monotonic_time();
+    return metrics;
+}
+
+void metrics_free(Metrics* metrics) {
+    if (!metrics)
+        return;
+    g_ptr_array_free(metrics->hops, TRUE);
+    g_mutex_clear(&metrics->lock);
+    g_free(metrics->camera_name);
+    g_free(metrics);
+}
+
+void metrics_set_camera_name(Metrics* metrics, const gchar* camera_name) {
+    g_free(metrics->camera_name);
+    metrics->camera_name = g_strdup(camera_name);
+}
+
+void metrics_attach_tee(Metrics* metrics, GstElement* tee) {
+    GstIterator* it = gst_element_iterate_src_pads(tee);
+    GValue item = G_VALUE_INIT;
+    gboolean done = FALSE;
+
+    while (!done) {
+        switch (gst_iterator_next(it, &item)) {
+        case GST_ITERATOR_OK:
+            walk_downstream(metrics, g_value_get_object(&item));
+            g_value_reset(&item);
+            break;
+        case GST_ITERATOR_RESYNC:
+            gst_iterator_resync(it);
+            break;
+        default:
+            done = TRUE;
+            break;
+        }
+    }
+    g_value_unset(&item);
+    gst_iterator_free(it);
+}
+
+// 히스토그램에서 백분위 칸의 상한 (µs)
+static guint64 latency_percentile(HopStats* hop, gdouble fraction) {
+    guint64 total = g_atomic_pointer_get(&hop->latency_count);
+    guint64 target = (guint64)(total * fraction);
+    guint64 seen = 0;
+    guint i;
+
+    if (total == 0)
+        return 0;
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += g_atomic_pointer_get(&hop->latency_hist[i]);
+        if (seen > target)
+            return G_GUINT64_CONSTANT(1) << (i + 1);
+    }
+    return G_GUINT64_CONSTANT(1) << LATENCY_BUCKETS;
+}
+
+void metrics_append_json(Metrics* metrics, GString* line) {
+    gint64 now = g_get_monotonic_time();
+    gdouble elapsed = (now - metrics->last_dump) / 1e6;
+    gchar* camera_name = g_strescape(metrics->camera_name, NULL);
+    guint i;
+
+    g_string_append_printf(line, "{\"camera\":\"%s\",\"time\":%.3f,\"hops\":[",
+        camera_name, now / 1e6);
+    g_free(camera_name);
+    g_mutex_lock(&metrics->lock);
+    for (i = 0; i < metrics->hops->len; i++) {
+        HopStats* hop = g_ptr_array_index(metrics->hops, i);
+        guint64 buffers_out = g_atomic_pointer_get(&hop->buffers_out);
+        guint64 latency_count = g_atomic_pointer_get(&hop->latency_count);
+        guint64 latency_sum = g_atomic_pointer_get(&hop->latency_sum_us);
+        gchar* name = g_strescape(hop->name, NULL);
+
+        g_string_append_printf(line,
+            "%s{\"element\":\"%s\",\"buffers_in\":%" G_GUINT64_FORMAT ",\"bytes_in\":%" G_GUINT64_FORMAT
+            ",\"buffers_out\":%" G_GUINT64_FORMAT ",\"bytes_out\":%" G_GUINT64_FORMAT ",\"rate\":%.1f"
+            ",\"latency_avg_us\":%.1f,\"latency_p50_us\":%" G_GUINT64_FORMAT ",\"latency_p99_us\":%" G_GUINT64_FORMAT,
+            i > 0 ? "," : "", name,
+            (guint64)g_atomic_pointer_get(&hop->buffers_in),
+            (guint64)g_atomic_pointer_get(&hop->bytes_in),
+            buffers_out,
+            (guint64)g_atomic_pointer_get(&hop->bytes_out),
+            elapsed > 0 ? (buffers_out - hop->last_buffers_out) / elapsed : 0.0,
+            latency_count > 0 ? (gdouble)latency_sum / latency_count : 0.0,
+            latency_percentile(hop, 0.50), latency_percentile(hop, 0.99));
+        g_free(name);
+        if (hop->is_queue) {
+            guint level_buffers = 0, level_bytes = 0;
+            guint64 level_time = 0;
+            g_object_get(G_OBJECT(hop->element), "current-level-buffers", &level_buffers,
+                "current-level-bytes", &level_bytes, "current-level-time", &level_time, NULL);
+            g_string_append_printf(line, ",\"queue_buffers\":%u,\"queue_bytes\":%u,\"queue_ms\":%.1f",
+                level_buffers, level_bytes, (gdouble)level_time / GST_MSECOND);
+        }
+        g_string_append_c(line, '}');
+        hop->last_buffers_out = buffers_out;
+    }
+    g_mutex_unlock(&metrics->lock);
+    g_string_append(line, "]}");
+    metrics->last_dump = now;
+}
+
+void metrics_dump(Metrics* metrics, FILE* out) {
+    GString* line = g_string_new(NULL);
+
+    metrics_append_json(metrics, line);
+    g_string_append_c(line, '\n');
+    fputs(line->str, out);
+    fflush(out);
+    g_string_free(line, TRUE);
+}
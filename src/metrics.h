@@ -0,0 +1,29 @@
+#ifndef CLIPPER_METRICS_H
+#define CLIPPER_METRICS_H
+
+#include <gst/gst.h>
+#include <stdio.h>
+
+G_BEGIN_DECLS
+
+// tee 브랜치의 엘리먼트 경계마다 pad probe를 붙여 버퍼/바이트 수, 구간 지연 히스토그램,
+// 큐 점유량을 수집한다. 스트리밍 스레드에서는 원자적 카운터만 갱신한다 (락 없음).
+// 계측을 끄면 Metrics 자체를 만들지 않으므로 probe도 붙지 않는다.
+typedef struct _Metrics Metrics;
+
+Metrics* metrics_new(const gchar* camera_name);
+void metrics_free(Metrics* metrics);
+// 파이프라인 풀에서 꺼낸 카메라에 이름을 붙일 때 (메인 루프 스레드)
+void metrics_set_camera_name(Metrics* metrics, const gchar* camera_name);
+
+// tee의 각 src 패드에서 시작해 하류 엘리먼트를 따라가며 probe 설치 (동적 패드는 pad-added에서 이어감)
+void metrics_attach_tee(Metrics* metrics, GstElement* tee);
+
+// 현재 카운터를 JSON 객체로 추가 (이전 dump 이후의 처리율 포함)
+void metrics_append_json(Metrics* metrics, GString* line);
+// 같은 내용을 JSON 한 줄로 출력
+void metrics_dump(Metrics* metrics, FILE* out);
+
+G_END_DECLS
+
+#endif // CLIPPER_METRICS_H
@@ -0,0 +1,220 @@
+#include "motion.h"
+
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MOTION_KERNEL_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MOTION_KERNEL_NEON 1
+#endif
+
+// 이보다 밝기가 많이 바뀐 픽셀만 센다 (센서 노이즈/압축 잡음 무시)
+#define MOTION_PIXEL_THRESHOLD 25
+// CPU 예산 구간 (이 구간마다 사용량을 초기화)
+#define MOTION_BUDGET_WINDOW_US G_USEC_PER_SEC
+
+struct _MotionDetector {
+    gdouble min_area;
+    gdouble cpu_budget;
+
+    // 이하 분석 스레드에서만 사용 (gate/sink probe는 같은 큐 스레드에서 돎)
+    guint8* previous;
+    gsize previous_size;
+    gint64 window_start_us;         // 예산 구간 시작 (monotonic)
+    gint64 window_cpu_start_us;     // 구간 시작 시점의 스레드 CPU 시간
+    gboolean throttled;             // 이번 구간의 예산을 다 씀
+
+    // 메인 루프에서 읽는 카운터
+    gint motion_frames;
+    gint analyzed;
+    gint skipped;
+    gint cpu_permille;              // 마지막 구간의 분석 스레드 CPU 사용률 (코어 하나 = 1000)
+    gint changed_permille;          // 마지막 프레임의 바뀐 픽셀 비율
+};
+
+guint32 motion_count_changed_scalar(const guint8* a, const guint8* b, gsize n, guint8 threshold) {
+    guint32 count = 0;
+    gsize i;
+
+    for (i = 0; i < n; i++) {
+        guint8 diff = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+        count += diff > threshold;
+    }
+    return count;
+}
+
+#if defined(MOTION_KERNEL_SSE2)
+
+// 16픽셀씩: 포화 뺄셈 두 번으로 |a - b|, threshold를 빼고 남은 바이트가 바뀐 픽셀. _mm_sad_epu8로 1을 합산
+guint32 motion_count_changed(const guint8* a, const guint8* b, gsize n, guint8 threshold) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i limit = _mm_set1_epi8((char)threshold);
+    __m128i total = zero;
+    guint64 lanes[2];
+    gsize i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+        __m128i over = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_subs_epu8(diff, limit), zero), one);
+        total = _mm_add_epi64(total, _mm_sad_epu8(over, zero));
+    }
+    _mm_storeu_si128((__m128i*)lanes, total);
+    return (guint32)(lanes[0] + lanes[1]) + motion_count_changed_scalar(a + i, b + i, n - i, threshold);
+}
+
+const gchar* motion_kernel_name(void) {
+    return "sse2";
+}
+
+#elif defined(MOTION_KERNEL_NEON)
+
+// 16픽셀씩: vabdq_u8로 |a - b|, threshold보다 크면 0xff -> 1로 줄여 쌍끼리 더해 누적
+guint32 motion_count_changed(const guint8* a, const guint8* b, gsize n, guint8 threshold) {
+    const uint8x16_t limit = vdupq_n_u8(threshold);
+    uint32x4_t total = vdupq_n_u32(0);
+    gsize i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+        uint8x16_t over = vshrq_n_u8(vcgtq_u8(diff, limit), 7);
+        total = vpadalq_u16(total, vpaddlq_u8(over));
+    }
+    return vgetq_lane_u32(total, 0) + vgetq_lane_u32(total, 1) + vgetq_lane_u32(total, 2) + vgetq_lane_u32(total, 3) +
+        motion_count_changed_scalar(a + i, b + i, n - i, threshold);
+}
+
+const gchar* motion_kernel_name(void) {
+    return "neon";
+}
+
+#else
+
+guint32 motion_count_changed(const guint8* a, const guint8* b, gsize n, guint8 threshold) {
+    return motion_count_changed_scalar(a, b, n, threshold);
+}
+
+const gchar* motion_kernel_name(void) {
+    return "scalar";
+}
+
+#endif
+
+static gint64 thread_cpu_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+// 큐 출구: 이번 구간의 예산을 다 썼으면 축소/변환 전에 버림
+static GstPadProbeReturn motion_gate_probe(GstPad* pad, GstPadProbeInfo* info, MotionDetector* motion) {
+    gint64 now = g_get_monotonic_time();
+
+    if (now - motion->window_start_us >= MOTION_BUDGET_WINDOW_US) {
+        gint64 cpu = thread_cpu_us();
+
+        if (motion->window_start_us > 0) {
+            g_atomic_int_set(&motion->cpu_permille,
+                (gint)((cpu - motion->window_cpu_start_us) * 1000 / (now - motion->window_start_us)));
+        }
+        motion->window_start_us = now;
+        motion->window_cpu_start_us = cpu;
+        motion->throttled = FALSE;
+    }
+    if (motion->throttled) {
+        g_atomic_int_inc(&motion->skipped);
+        return GST_PAD_PROBE_DROP;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// 싱크 입구: GRAY8 프레임을 이전 프레임과 비교 (분석 스레드에서 축소/변환까지 끝난 뒤)
+static GstPadProbeReturn motion_frame_probe(GstPad* pad, GstPadProbeInfo* info, MotionDetector* motion) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    const GstStructure* structure;
+    GstMapInfo map;
+    gint width = 0, height = 0;
+    gsize stride;
+    gint64 used;
+
+    if (!caps)
+        return GST_PAD_PROBE_OK;
+    structure = gst_caps_get_structure(caps, 0);
+    gst_structure_get_int(structure, "width", &width);
+    gst_structure_get_int(structure, "height", &height);
+    gst_caps_unref(caps);
+    // GRAY8의 기본 행 간격은 4바이트 정렬
+    stride = GST_ROUND_UP_4(width);
+    if (width <= 0 || height <= 0 || !gst_buffer_map(buffer, &map, GST_MAP_READ))
+        return GST_PAD_PROBE_OK;
+
+    if (map.size >= stride * height) {
+        if (motion->previous && motion->previous_size == stride * height) {
+            guint32 changed = 0;
+            gint y;
+
+            if (stride == (gsize)width) {
+                changed = motion_count_changed(map.data, motion->previous, stride * height, MOTION_PIXEL_THRESHOLD);
+            }
+            else {
+                for (y = 0; y < height; y++)
+                    changed += motion_count_changed(map.data + y * stride, motion->previous + y * stride, width, MOTION_PIXEL_THRESHOLD);
+            }
+            g_atomic_int_set(&motion->changed_permille, (gint)((guint64)changed * 1000 / ((guint64)width * height)));
+            if (changed >= motion->min_area * width * height)
+                g_atomic_int_inc(&motion->motion_frames);
+        }
+        else {
+            g_free(motion->previous);
+            motion->previous = g_malloc(stride * height);
+            motion->previous_size = stride * height;
+        }
+        memcpy(motion->previous, map.data, stride * height);
+        g_atomic_int_inc(&motion->analyzed);
+    }
+    gst_buffer_unmap(buffer, &map);
+
+    // 이 스레드가 이번 구간에 쓴 CPU (큐 이후의 videorate/축소/변환 포함)
+    used = thread_cpu_us() - motion->window_cpu_start_us;
+    if (motion->window_start_us > 0 && used > motion->cpu_budget * MOTION_BUDGET_WINDOW_US)
+        motion->throttled = TRUE;
+    return GST_PAD_PROBE_OK;
+}
+
+MotionDetector* motion_detector_new(gdouble min_area, gdouble cpu_budget) {
+    MotionDetector* motion = g_new0(MotionDetector, 1);
+
+    motion->min_area = min_area;
+    motion->cpu_budget = cpu_budget;
+    return motion;
+}
+
+void motion_detector_free(MotionDetector* motion) {
+    if (!motion)
+        return;
+    g_free(motion->previous);
+    g_free(motion);
+}
+
+void motion_detector_attach(MotionDetector* motion, GstPad* gate_pad, GstPad* sink_pad) {
+    gst_pad_add_probe(gate_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)motion_gate_probe, motion, NULL);
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)motion_frame_probe, motion, NULL);
+}
+
+guint motion_detector_get_motion_frames(MotionDetector* motion) {
+    return (guint)g_atomic_int_get(&motion->motion_frames);
+}
+
+void motion_detector_append_json(MotionDetector* motion, GString* json) {
+    g_string_append_printf(json,
+        "{\"kernel\":\"%s\",\"analyzed\":%d,\"skipped\":%d,\"motion_frames\":%d,\"changed\":%.3f,\"cpu\":%.3f,\"cpu_budget\":%.3f}",
+        motion_kernel_name(), g_atomic_int_get(&motion->analyzed), g_atomic_int_get(&motion->skipped),
+        g_atomic_int_get(&motion->motion_frames), g_atomic_int_get(&motion->changed_permille) / 1000.0,
+        g_atomic_int_get(&motion->cpu_permille) / 1000.0, motion->cpu_budget);
+}
@@ -0,0 +1,34 @@
+#ifndef CLIPPER_MOTION_H
+#define CLIPPER_MOTION_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// 분석 브랜치(작게 줄인 GRAY8 프레임)에서 이전 프레임과의 차이로 움직임을 찾는다 (카메라당 하나).
+// 분석은 분석 브랜치 큐의 스트리밍 스레드에서만 돌고, 그 스레드의 CPU 시간이 예산을 넘으면
+// 남은 구간 동안 큐 출구에서 프레임을 버려 축소/변환/차분 비용을 함께 줄인다.
+typedef struct _MotionDetector MotionDetector;
+
+// min_area: 움직임으로 볼 바뀐 픽셀 비율 (0~1), cpu_budget: 분석 스레드가 쓸 수 있는 코어 비율 (0~1)
+MotionDetector* motion_detector_new(gdouble min_area, gdouble cpu_budget);
+void motion_detector_free(MotionDetector* motion);
+
+// gate_pad: 분석 브랜치 큐의 src 패드 (예산 초과 시 버림), sink_pad: 마지막 싱크의 sink 패드 (GRAY8 프레임 차분)
+void motion_detector_attach(MotionDetector* motion, GstPad* gate_pad, GstPad* sink_pad);
+
+// 움직임이 있던 프레임 수 (메인 루프에서 늘어났는지 봄)
+guint motion_detector_get_motion_frames(MotionDetector* motion);
+
+// 분석/예산으로 건너뛴 프레임 수, 분석 스레드 CPU 사용률, 마지막 바뀐 픽셀 비율
+void motion_detector_append_json(MotionDetector* motion, GString* json);
+
+// 같은 크기의 두 GRAY8 영역에서 |a - b| > threshold 인 픽셀 수.
+// motion_count_changed는 컴파일 대상에 따라 SSE2/NEON, 없으면 스칼라 구현
+guint32 motion_count_changed(const guint8* a, const guint8* b, gsize n, guint8 threshold);
+guint32 motion_count_changed_scalar(const guint8* a, const guint8* b, gsize n, guint8 threshold);
+const gchar* motion_kernel_name(void);
+
+G_END_DECLS
+
+#endif // CLIPPER_MOTION_H
@@ -0,0 +1,304 @@
+#include "preroll.h"
+
+struct _PrerollBuffer {
+    GMutex lock;            // 링과 이 링을 쓰는 모든 브랜치의 상태를 보호
+    GQueue frames;          // 인코딩된 GstBuffer* (오래된 것부터, 항상 키프레임으로 시작)
+    guint64 bytes;
+
+    GstClockTime preroll;
+    GstClockTime max_time;
+    guint64 max_bytes;
+
+    GstPad* pad;
+    gulong probe_id;
+
+    guint flushes;          // 프리롤 구간을 내보낸 클립 수
+    guint64 flushed_buffers;
+};
+
+struct _PrerollBranch {
+    PrerollBuffer* ring;
+
+    gboolean recording;
+    gboolean flush_pending; // 다음 버퍼에서 프리롤 구간을 먼저 내보내야 함
+    gboolean pushing;       // 링에서 꺼낸 버퍼를 push 중 (같은 스트리밍 스레드에서 probe 재진입)
+    gboolean stopping;      // 다음 키프레임에서 멈춤
+    PrerollStoppedFunc stopped_func;
+    gpointer stopped_data;
+
+    GstPad* pad;
+    gulong probe_id;
+};
+
+static inline gboolean is_keyframe(GstBuffer* buffer) {
+    return !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+}
+
+static GstClockTime queue_duration(GQueue* frames) {
+    GstBuffer* head;
+    GstBuffer* tail;
+    GstClockTime head_ts, tail_ts;
+
+    if (g_queue_is_empty(frames))
+        return 0;
+    head = g_queue_peek_head(frames);
+    tail = g_queue_peek_tail(frames);
+    head_ts = GST_BUFFER_DTS_OR_PTS(head);
+    tail_ts = GST_BUFFER_DTS_OR_PTS(tail);
+    if (!GST_CLOCK_TIME_IS_VALID(head_ts) || !GST_CLOCK_TIME_IS_VALID(tail_ts) || tail_ts < head_ts)
+        return 0;
+    return tail_ts - head_ts;
+}
+
+static void drop_head(PrerollBuffer* ring) {
+    GstBuffer* buffer = g_queue_pop_head(&ring->frames);
+    ring->bytes -= gst_buffer_get_size(buffer);
+    gst_buffer_unref(buffer);
+}
+
+// 용량/시간 제한을 넘으면 앞에서부터 버리고, 링이 항상 키프레임으로 시작하도록 유지
+static void trim(PrerollBuffer* ring) {
+    while (!g_queue_is_empty(&ring->frames) &&
+        (ring->bytes > ring->max_bytes || queue_duration(&ring->frames) > ring->max_time)) {
+        drop_head(ring);
+    }
+    while (!g_queue_is_empty(&ring->frames) && !is_keyframe(g_queue_peek_head(&ring->frames))) {
+        drop_head(ring);
+    }
+}
+
+// preroll 이전의 가장 가까운 키프레임 위치를 찾는다. 없으면 링의 첫 키프레임.
+static GList* find_start(PrerollBuffer* ring) {
+    GList* start = ring->frames.head;
+    GstClockTime newest, target;
+    GList* l;
+
+    newest = GST_BUFFER_DTS_OR_PTS((GstBuffer*)g_queue_peek_tail(&ring->frames));
+    if (!GST_CLOCK_TIME_IS_VALID(newest))
+        return start;
+    target = newest > ring->preroll ? newest - ring->preroll : 0;
+
+    for (l = ring->frames.head; l != NULL; l = l->next) {
+        GstBuffer* buffer = l->data;
+        GstClockTime ts = GST_BUFFER_DTS_OR_PTS(buffer);
+        if (!is_keyframe(buffer))
+            continue;
+        if (GST_CLOCK_TIME_IS_VALID(ts) && ts > target)
+            break;
+        start = l;
+    }
+    return start;
+}
+
+// 링 probe: 지나가는 모든 버퍼를 저장 (버리지 않음)
+static GstPadProbeReturn ring_probe(GstPad* pad, GstPadProbeInfo* info, PrerollBuffer* ring) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+
+    g_mutex_lock(&ring->lock);
+    if (is_keyframe(buffer) || !g_queue_is_empty(&ring->frames)) {
+        g_queue_push_tail(&ring->frames, gst_buffer_ref(buffer));
+        ring->bytes += gst_buffer_get_size(buffer);
+        trim(ring);
+    }
+    g_mutex_unlock(&ring->lock);
+    return GST_PAD_PROBE_OK;
+}
+
+// 브랜치 probe: 녹화 중이 아니면 버리고, 시작할 때 링의 프리롤 구간을 이 패드로만 먼저 내보냄
+static GstPadProbeReturn branch_probe(GstPad* pad, GstPadProbeInfo* info, PrerollBranch* branch) {
+    PrerollBuffer* ring = branch->ring;
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    PrerollStoppedFunc stopped_func;
+    gpointer stopped_data;
+    GList* pending = NULL;
+    GList* l;
+
+    // 링에서 꺼내 보내는 버퍼는 그대로 통과
+    if (branch->pushing)
+        return GST_PAD_PROBE_OK;
+
+    g_mutex_lock(&ring->lock);
+    if (!branch->recording) {
+        g_mutex_unlock(&ring->lock);
+        return GST_PAD_PROBE_DROP;
+    }
+
+    if (branch->stopping && is_keyframe(buffer)) {
+        // GOP 경계: 이 키프레임부터는 다음 클립 몫
+        stopped_func = branch->stopped_func;
+        stopped_data = branch->stopped_data;
+        branch->recording = FALSE;
+        branch->stopping = FALSE;
+        branch->stopped_func = NULL;
+        branch->stopped_data = NULL;
+        g_mutex_unlock(&ring->lock);
+        if (stopped_func)
+            stopped_func(branch, stopped_data);
+        return GST_PAD_PROBE_DROP;
+    }
+
+    if (branch->flush_pending) {
+        // 키프레임이 아직 없으면 다음 키프레임까지 대기
+        if (g_queue_is_empty(&ring->frames)) {
+            g_mutex_unlock(&ring->lock);
+            return GST_PAD_PROBE_DROP;
+        }
+        if (ring->preroll == 0) {
+            // 프리롤 없음: 지금 이후의 첫 키프레임(재인코딩 모드에서는 요청한 IDR)부터 시작
+            if (!is_keyframe(buffer)) {
+                g_mutex_unlock(&ring->lock);
+                return GST_PAD_PROBE_DROP;
+            }
+            branch->flush_pending = FALSE;
+            g_mutex_unlock(&ring->lock);
+            return GST_PAD_PROBE_OK;
+        }
+        branch->flush_pending = FALSE;
+        // 현재 버퍼(링 probe가 방금 저장한 링의 마지막)는 probe가 끝나면 그대로 흘러가므로 제외
+        for (l = find_start(ring); l != NULL && l != ring->frames.tail; l = l->next) {
+            pending = g_list_prepend(pending, gst_buffer_ref(l->data));
+            ring->flushed_buffers++;
+        }
+        pending = g_list_reverse(pending);
+        if (pending)
+            ring->flushes++;
+    }
+    g_mutex_unlock(&ring->lock);
+
+    if (pending) {
+        GstFlowReturn ret = GST_FLOW_OK;
+
+        branch->pushing = TRUE;
+        for (l = pending; l != NULL; l = l->next) {
+            if (ret == GST_FLOW_OK)
+                ret = gst_pad_push(pad, l->data);
+            else
+                gst_buffer_unref(l->data);
+        }
+        branch->pushing = FALSE;
+        g_list_free(pending);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+PrerollBuffer* preroll_buffer_new(GstClockTime preroll, GstClockTime max_time, guint64 max_bytes) {
+    PrerollBuffer* ring = g_new0(PrerollBuffer, 1);
+
+    g_mutex_init(&ring->lock);
+    g_queue_init(&ring->frames);
+    ring->preroll = preroll;
+    // 링은 최소한 preroll 구간을 담을 수 있어야 함
+    ring->max_time = MAX(max_time, preroll);
+    ring->max_bytes = max_bytes;
+    return ring;
+}
+
+void preroll_buffer_free(PrerollBuffer* ring) {
+    if (!ring)
+        return;
+    if (ring->pad) {
+        gst_pad_remove_probe(ring->pad, ring->probe_id);
+        gst_object_unref(ring->pad);
+    }
+    g_queue_clear_full(&ring->frames, (GDestroyNotify)gst_buffer_unref);
+    g_mutex_clear(&ring->lock);
+    g_free(ring);
+}
+
+gboolean preroll_buffer_attach(PrerollBuffer* ring, GstPad* pad) {
+    g_return_val_if_fail(ring->pad == NULL, FALSE);
+
+    ring->probe_id = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER,
+        (GstPadProbeCallback)ring_probe, ring, NULL);
+    if (ring->probe_id == 0)
+        return FALSE;
+    ring->pad = gst_object_ref(pad);
+    return TRUE;
+}
+
+PrerollBranch* preroll_branch_new(PrerollBuffer* ring, GstPad* pad) {
+    PrerollBranch* branch = g_new0(PrerollBranch, 1);
+
+    branch->ring = ring;
+    branch->probe_id = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER,
+        (GstPadProbeCallback)branch_probe, branch, NULL);
+    if (branch->probe_id == 0) {
+        g_free(branch);
+        return NULL;
+    }
+    branch->pad = gst_object_ref(pad);
+    return branch;
+}
+
+void preroll_branch_free(PrerollBranch* branch) {
+    if (!branch)
+        return;
+    gst_pad_remove_probe(branch->pad, branch->probe_id);
+    gst_object_unref(branch->pad);
+    g_free(branch);
+}
+
+void preroll_branch_start(PrerollBranch* branch) {
+    g_mutex_lock(&branch->ring->lock);
+    if (!branch->recording) {
+        branch->recording = TRUE;
+        branch->flush_pending = TRUE;
+        branch->stopping = FALSE;
+    }
+    g_mutex_unlock(&branch->ring->lock);
+}
+
+void preroll_branch_stop(PrerollBranch* branch, PrerollStoppedFunc stopped_func, gpointer user_data) {
+    gboolean stopped = FALSE;
+
+    g_mutex_lock(&branch->ring->lock);
+    if (!branch->recording || branch->flush_pending) {
+        // 아직 아무것도 내보내지 않았으면 바로 멈춤
+        branch->recording = FALSE;
+        branch->flush_pending = FALSE;
+        stopped = TRUE;
+    }
+    else {
+        branch->stopping = TRUE;
+        branch->stopped_func = stopped_func;
+        branch->stopped_data = user_data;
+    }
+    g_mutex_unlock(&branch->ring->lock);
+
+    if (stopped && stopped_func)
+        stopped_func(branch, user_data);
+}
+
+void preroll_buffer_set_preroll(PrerollBuffer* ring, GstClockTime preroll) {
+    g_mutex_lock(&ring->lock);
+    ring->preroll = preroll;
+    ring->max_time = MAX(ring->max_time, preroll);
+    g_mutex_unlock(&ring->lock);
+}
+
+GstClockTime preroll_buffer_get_preroll(PrerollBuffer* ring) {
+    GstClockTime preroll;
+
+    g_mutex_lock(&ring->lock);
+    preroll = ring->preroll;
+    g_mutex_unlock(&ring->lock);
+    return preroll;
+}
+
+void preroll_buffer_get_flush_stats(PrerollBuffer* ring, guint* flushes, guint64* flushed_buffers) {
+    g_mutex_lock(&ring->lock);
+    *flushes = ring->flushes;
+    *flushed_buffers = ring->flushed_buffers;
+    g_mutex_unlock(&ring->lock);
+}
+
+void preroll_buffer_get_stats(PrerollBuffer* ring, guint* n_buffers, guint64* bytes, GstClockTime* duration) {
+    g_mutex_lock(&ring->lock);
+    if (n_buffers)
+        *n_buffers = g_queue_get_length(&ring->frames);
+    if (bytes)
+        *bytes = ring->bytes;
+    if (duration)
+        *duration = queue_duration(&ring->frames);
+    g_mutex_unlock(&ring->lock);
+}
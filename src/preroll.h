@@ -0,0 +1,43 @@
+#ifndef CLIPPER_PREROLL_H
+#define CLIPPER_PREROLL_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// 녹화 브랜치의 인코딩된 프레임을 메모리에 계속 보관하는 링 버퍼 (카메라당 하나).
+// 클립마다 PrerollBranch가 링을 공유하며, 녹화 시작 시 preroll 만큼 이전의 키프레임(IDR)부터
+// 재인코딩 없이 자기 브랜치로만 내보낸다.
+typedef struct _PrerollBuffer PrerollBuffer;
+typedef struct _PrerollBranch PrerollBranch;
+
+// 브랜치가 GOP 경계에서 실제로 멈췄을 때 호출됨 (스트리밍 스레드 또는 preroll_branch_stop을 부른 스레드)
+typedef void (*PrerollStoppedFunc)(PrerollBranch* branch, gpointer user_data);
+
+PrerollBuffer* preroll_buffer_new(GstClockTime preroll, GstClockTime max_time, guint64 max_bytes);
+void preroll_buffer_free(PrerollBuffer* ring);
+
+// pad(인코딩된 스트림의 src 패드, 클립 tee 앞)에 probe를 붙여 모든 버퍼를 링에 저장한다.
+gboolean preroll_buffer_attach(PrerollBuffer* ring, GstPad* pad);
+
+// 클립 하나의 게이트: pad(클립 tee의 src 패드)로 가는 버퍼를 녹화 중이 아닐 때 버린다.
+// 링 probe보다 하류에 있어야 함 (같은 스트리밍 스레드에서 링에 먼저 저장된 버퍼를 받음)
+PrerollBranch* preroll_branch_new(PrerollBuffer* ring, GstPad* pad);
+void preroll_branch_free(PrerollBranch* branch);
+
+// preroll이 0이면 링을 건너뛰고 다음 키프레임부터 내보낸다.
+void preroll_branch_start(PrerollBranch* branch);
+// 다음 키프레임 직전(GOP 경계)에서 멈춘다. 그 키프레임은 링에 남아 다음 클립의 시작이 된다.
+void preroll_branch_stop(PrerollBranch* branch, PrerollStoppedFunc stopped_func, gpointer user_data);
+
+// 프리롤 길이 변경 (다음 녹화 시작부터 적용, 링 상한은 최소한 이 길이로 늘어남)
+void preroll_buffer_set_preroll(PrerollBuffer* ring, GstClockTime preroll);
+GstClockTime preroll_buffer_get_preroll(PrerollBuffer* ring);
+
+void preroll_buffer_get_stats(PrerollBuffer* ring, guint* n_buffers, guint64* bytes, GstClockTime* duration);
+// 프리롤 구간을 내보낸 클립 수와 그동안 링에서 꺼내 보낸 버퍼 수
+void preroll_buffer_get_flush_stats(PrerollBuffer* ring, guint* flushes, guint64* flushed_buffers);
+
+G_END_DECLS
+
+#endif // CLIPPER_PREROLL_H
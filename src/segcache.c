@@ -0,0 +1,713 @@
+#include "segcache.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// 동시에 처리하는 요청 수 (카메라마다 플레이리스트 + 세그먼트 한두 개)
+#define SEGMENT_CACHE_MAX_THREADS 32
+#define SEGMENT_CACHE_IO_TIMEOUT_SEC 15
+// 같은 세그먼트를 받는 다른 요청을 기다리는 최대 시간
+#define SEGMENT_CACHE_WAIT_US (30 * G_USEC_PER_SEC)
+#define SEGMENT_CACHE_CHUNK (64 * 1024)
+// 캐시 파일 이름: URL의 SHA-256 (16진수)
+#define SEGMENT_CACHE_KEY_LENGTH 64
+
+typedef struct _CacheEntry {
+    guint64 size;
+    gint64 last_used;               // 실시간 (us), 재시작 후에는 파일 mtime
+} CacheEntry;
+
+struct _SegmentCache {
+    GSocketService* service;
+    gchar* dir;
+    gchar* proxy_uri;
+    guint64 max_bytes;
+    // 원 서버 대신 연결하는 상위 프록시 (캐시를 켜기 전의 http_proxy, 없으면 NULL)
+    gchar* upstream_host;
+    gint upstream_port;
+    gchar* upstream_auth;           // "Basic ..." (프록시 URI에 사용자 정보가 있을 때)
+
+    GMutex lock;
+    GCond fetched;                  // 받던 세그먼트 하나가 끝남
+    GCond idle;                     // 처리 중인 요청이 모두 끝남
+    guint active;                   // run_handler 안에 있는 작업 스레드 수
+    gboolean closing;               // segment_cache_free 이후: 새 요청은 받지 않고 대기 중인 요청은 깨움
+    GHashTable* entries;            // 키 -> CacheEntry*
+    GHashTable* fetching;           // 지금 받고 있는 키
+    guint64 bytes;
+    guint64 requests;
+    guint64 hits;
+    guint64 misses;
+    guint64 coalesced;              // 다른 요청이 받는 것을 기다렸다가 캐시에서 읽은 수
+    guint64 uncached;               // 저장하지 않고 전달한 요청 (플레이리스트, Range, 200이 아닌 응답)
+    guint64 evictions;
+    guint64 errors;
+    guint64 hit_bytes;
+    guint64 miss_bytes;
+};
+
+// claim_fetch 결과
+typedef enum {
+    FETCH_CLAIM_HIT,                // 캐시에 있음
+    FETCH_CLAIM_FETCH,              // 이 요청이 받아서 저장
+    FETCH_CLAIM_BYPASS              // 다른 요청이 아직 받는 중 (기다리다 시간 초과): 저장하지 않고 전달만
+} FetchClaim;
+
+// 요청 하나 (프록시 형식: GET http://host/path HTTP/1.1)
+typedef struct _ProxyRequest {
+    gchar* url;
+    gchar* host;
+    gint port;
+    gchar* target;                  // path?query
+    GPtrArray* headers;             // 전달할 요청 헤더 줄
+    gboolean cacheable;
+    gchar* key;
+} ProxyRequest;
+
+static void proxy_request_free(ProxyRequest* request) {
+    g_free(request->url);
+    g_free(request->host);
+    g_free(request->target);
+    g_ptr_array_free(request->headers, TRUE);
+    g_free(request->key);
+    g_free(request);
+}
+
+static gchar* entry_path(SegmentCache* cache, const gchar* key) {
+    return g_build_filename(cache->dir, key, NULL);
+}
+
+static gboolean is_cache_key(const gchar* name) {
+    guint i;
+
+    for (i = 0; name[i]; i++) {
+        if (!g_ascii_isxdigit(name[i]))
+            return FALSE;
+    }
+    return i == SEGMENT_CACHE_KEY_LENGTH;
+}
+
+// hop-by-hop 헤더는 전달하지 않음 (프록시가 연결마다 정함)
+static gboolean is_hop_header(const gchar* line) {
+    static const gchar* const names[] = { "Connection:", "Keep-Alive:", "Proxy-", "TE:", "Trailer:", "Transfer-Encoding:", "Upgrade:", NULL };
+    guint i;
+
+    for (i = 0; names[i]; i++) {
+        if (g_ascii_strncasecmp(line, names[i], strlen(names[i])) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+// "Name: value" 줄에서 값 (앞 공백 제외), 다른 이름이면 NULL
+static const gchar* header_value(const gchar* line, const gchar* name) {
+    gsize length = strlen(name);
+
+    if (g_ascii_strncasecmp(line, name, length) != 0 || line[length] != ':')
+        return NULL;
+    line += length + 1;
+    while (*line == ' ' || *line == '\t')
+        line++;
+    return line;
+}
+
+// lock을 잡은 상태에서: 색인에서만 뺌 (파일은 호출한 쪽이 처리)
+static void remove_locked(SegmentCache* cache, const gchar* key) {
+    CacheEntry* entry = g_hash_table_lookup(cache->entries, key);
+
+    if (entry) {
+        cache->bytes -= entry->size;
+        g_hash_table_remove(cache->entries, key);
+    }
+}
+
+// lock을 잡은 상태에서: 상한 아래로 내려갈 때까지 가장 오래 쓰지 않은 항목부터 지움
+static void evict_locked(SegmentCache* cache) {
+    while (cache->bytes > cache->max_bytes && g_hash_table_size(cache->entries) > 0) {
+        GHashTableIter iter;
+        gpointer key, value;
+        const gchar* oldest_key = NULL;
+        CacheEntry* oldest = NULL;
+        gchar* path;
+
+        g_hash_table_iter_init(&iter, cache->entries);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            CacheEntry* entry = value;
+
+            if (!oldest || entry->last_used < oldest->last_used) {
+                oldest = entry;
+                oldest_key = key;
+            }
+        }
+        // 읽고 있는 요청이 있어도 열린 파일은 끝까지 읽힘
+        path = entry_path(cache, oldest_key);
+        g_unlink(path);
+        g_free(path);
+        cache->evictions++;
+        remove_locked(cache, oldest_key);
+    }
+}
+
+// lock을 잡은 상태에서
+static void insert_locked(SegmentCache* cache, const gchar* key, guint64 size, gint64 last_used) {
+    CacheEntry* entry = g_hash_table_lookup(cache->entries, key);
+
+    if (entry) {
+        cache->bytes -= entry->size;
+    }
+    else {
+        entry = g_new0(CacheEntry, 1);
+        g_hash_table_insert(cache->entries, g_strdup(key), entry);
+    }
+    entry->size = size;
+    entry->last_used = last_used;
+    cache->bytes += size;
+}
+
+// 이전 실행(또는 같은 디렉터리를 쓰는 다른 프로세스)이 남긴 세그먼트를 색인에 올림
+static void scan_dir(SegmentCache* cache) {
+    GDir* dir = g_dir_open(cache->dir, 0, NULL);
+    const gchar* name;
+
+    if (!dir)
+        return;
+    while ((name = g_dir_read_name(dir))) {
+        gchar* path = g_build_filename(cache->dir, name, NULL);
+        GStatBuf st;
+
+        // 쓰다가 끝난 임시 파일
+        if (g_str_has_suffix(name, ".tmp"))
+            g_unlink(path);
+        else if (is_cache_key(name) && g_stat(path, &st) == 0 && S_ISREG(st.st_mode))
+            insert_locked(cache, name, (guint64)st.st_size, (gint64)st.st_mtime * G_USEC_PER_SEC);
+        g_free(path);
+    }
+    g_dir_close(dir);
+    evict_locked(cache);
+}
+
+static const gchar* segment_content_type(const gchar* url) {
+    if (strstr(url, ".ts"))
+        return "video/mp2t";
+    if (strstr(url, ".m4s") || strstr(url, ".mp4"))
+        return "video/mp4";
+    if (strstr(url, ".aac"))
+        return "audio/aac";
+    return "application/octet-stream";
+}
+
+static gboolean write_string(GOutputStream* output, const gchar* text, GError** error) {
+    return g_output_stream_write_all(output, text, strlen(text), NULL, NULL, error);
+}
+
+static void send_error(GOutputStream* output, const gchar* status) {
+    gchar* response = g_strdup_printf("HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+
+    write_string(output, response, NULL);
+    g_free(response);
+}
+
+// 요청 줄과 헤더 읽기. 프록시 형식의 http:// GET만 받음
+static ProxyRequest* read_request(GDataInputStream* input, GOutputStream* output) {
+    ProxyRequest* request;
+    GUri* uri;
+    gchar* line;
+    gchar** parts;
+    gboolean range = FALSE;
+
+    line = g_data_input_stream_read_line(input, NULL, NULL, NULL);
+    if (!line)
+        return NULL;
+    parts = g_strsplit(line, " ", 3);
+    g_free(line);
+    if (g_strv_length(parts) != 3 || g_strcmp0(parts[0], "GET") != 0 ||
+        !(uri = g_uri_parse(parts[1], G_URI_FLAGS_ENCODED, NULL))) {
+        // https(CONNECT)는 내용을 볼 수 없으므로 받지 않음
+        send_error(output, "501 Not Implemented");
+        g_strfreev(parts);
+        return NULL;
+    }
+    if (g_strcmp0(g_uri_get_scheme(uri), "http") != 0 || !g_uri_get_host(uri)) {
+        send_error(output, "501 Not Implemented");
+        g_uri_unref(uri);
+        g_strfreev(parts);
+        return NULL;
+    }
+
+    request = g_new0(ProxyRequest, 1);
+    request->url = g_strdup(parts[1]);
+    request->host = g_strdup(g_uri_get_host(uri));
+    request->port = g_uri_get_port(uri) > 0 ? g_uri_get_port(uri) : 80;
+    request->target = g_strdup_printf("%s%s%s", *g_uri_get_path(uri) ? g_uri_get_path(uri) : "/",
+        g_uri_get_query(uri) ? "?" : "", g_uri_get_query(uri) ? g_uri_get_query(uri) : "");
+    request->headers = g_ptr_array_new_with_free_func(g_free);
+    while ((line = g_data_input_stream_read_line(input, NULL, NULL, NULL)) && *line) {
+        if (header_value(line, "Range"))
+            range = TRUE;
+        if (is_hop_header(line) || header_value(line, "Host"))
+            g_free(line);
+        else
+            g_ptr_array_add(request->headers, line);
+    }
+    g_free(line);
+    // 라이브 플레이리스트는 계속 바뀌므로 세그먼트만 저장
+    request->cacheable = !range && !g_str_has_suffix(g_uri_get_path(uri), ".m3u8") && !g_str_has_suffix(g_uri_get_path(uri), ".m3u");
+    request->key = g_compute_checksum_for_string(G_CHECKSUM_SHA256, request->url, -1);
+    g_uri_unref(uri);
+    g_strfreev(parts);
+    return request;
+}
+
+// 캐시 파일을 그대로 보냄. 다른 프로세스가 지웠으면 FALSE (받아서 다시 저장)
+static gboolean serve_cached(SegmentCache* cache, ProxyRequest* request, GOutputStream* output) {
+    gchar* path = entry_path(cache, request->key);
+    GFile* file = g_file_new_for_path(path);
+    GFileInputStream* input = g_file_read(file, NULL, NULL);
+    GStatBuf st;
+    gchar* header;
+    gssize sent = -1;
+    gboolean found = input && g_stat(path, &st) == 0;
+
+    if (found) {
+        header = g_strdup_printf("HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %" G_GUINT64_FORMAT "\r\n"
+            "X-Cache: HIT\r\nConnection: close\r\n\r\n", segment_content_type(request->url), (guint64)st.st_size);
+        if (write_string(output, header, NULL))
+            sent = g_output_stream_splice(output, G_INPUT_STREAM(input), G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE, NULL, NULL);
+        g_free(header);
+        g_mutex_lock(&cache->lock);
+        if (sent >= 0) {
+            cache->hit_bytes += (guint64)sent;
+        }
+        else {
+            // 헤더를 보낸 뒤라 다시 받을 수 없음 (받는 쪽이 끊었거나 읽기 오류)
+            cache->errors++;
+        }
+        g_mutex_unlock(&cache->lock);
+        // 재시작 후에도 LRU 순서를 유지
+        g_utime(path, NULL);
+    }
+    if (input)
+        g_object_unref(input);
+    g_object_unref(file);
+    g_free(path);
+    return found;
+}
+
+// length 바이트 (음수면 끝까지)를 받는 쪽과 캐시 파일에 씀
+static gboolean copy_body(GInputStream* input, gint64 length, GOutputStream* output, FILE* file, guint64* copied) {
+    guint8 buffer[SEGMENT_CACHE_CHUNK];
+
+    while (length != 0) {
+        gsize wanted = length > 0 ? (gsize)MIN(length, (gint64)sizeof(buffer)) : sizeof(buffer);
+        gssize n = g_input_stream_read(input, buffer, wanted, NULL, NULL);
+
+        if (n < 0)
+            return FALSE;
+        if (n == 0)
+            return length < 0;
+        if (!g_output_stream_write_all(output, buffer, (gsize)n, NULL, NULL, NULL))
+            return FALSE;
+        if (file && fwrite(buffer, 1, (gsize)n, file) != (gsize)n)
+            return FALSE;
+        *copied += (guint64)n;
+        if (length > 0)
+            length -= n;
+    }
+    return TRUE;
+}
+
+// chunked 본문을 풀어서 전달
+static gboolean copy_chunked_body(GDataInputStream* input, GOutputStream* output, FILE* file, guint64* copied) {
+    for (;;) {
+        gchar* line = g_data_input_stream_read_line(input, NULL, NULL, NULL);
+        gint64 size;
+
+        if (!line)
+            return FALSE;
+        size = (gint64)strtoull(line, NULL, 16);
+        g_free(line);
+        if (size == 0) {
+            // 트레일러는 버림
+            while ((line = g_data_input_stream_read_line(input, NULL, NULL, NULL)) && *line)
+                g_free(line);
+            g_free(line);
+            return TRUE;
+        }
+        if (!copy_body(G_INPUT_STREAM(input), size, output, file, copied))
+            return FALSE;
+        line = g_data_input_stream_read_line(input, NULL, NULL, NULL);
+        g_free(line);
+    }
+}
+
+// 원 서버에서 받아 전달하면서, 저장할 수 있으면 임시 파일에 쓰고 끝까지 받은 뒤에 캐시에 넣음
+static void fetch_and_serve(SegmentCache* cache, ProxyRequest* request, GOutputStream* output) {
+    GSocketClient* client = g_socket_client_new();
+    GSocketConnection* connection;
+    GDataInputStream* input = NULL;
+    GString* text = g_string_new(NULL);
+    GError* error = NULL;
+    gchar* line;
+    gchar* temp_path = NULL;
+    FILE* file = NULL;
+    gint64 content_length = -1;
+    gboolean chunked = FALSE;
+    gboolean store = FALSE;
+    gboolean ok = FALSE;
+    guint64 copied = 0;
+    gint status = 0;
+    guint i;
+
+    g_socket_client_set_timeout(client, SEGMENT_CACHE_IO_TIMEOUT_SEC);
+    if (cache->upstream_host)
+        connection = g_socket_client_connect_to_host(client, cache->upstream_host, (guint16)cache->upstream_port, NULL, &error);
+    else
+        connection = g_socket_client_connect_to_host(client, request->host, (guint16)request->port, NULL, &error);
+    if (!connection) {
+        g_printerr("Segment cache: %s: %s\n", request->url, error->message);
+        g_error_free(error);
+        send_error(output, "502 Bad Gateway");
+        goto done;
+    }
+    // 상위 프록시에는 프록시 형식(절대 URL)으로 요청
+    g_string_append_printf(text, "GET %s HTTP/1.1\r\nHost: %s", cache->upstream_host ? request->url : request->target, request->host);
+    if (request->port != 80)
+        g_string_append_printf(text, ":%d", request->port);
+    g_string_append(text, "\r\n");
+    if (cache->upstream_auth)
+        g_string_append_printf(text, "Proxy-Authorization: %s\r\n", cache->upstream_auth);
+    for (i = 0; i < request->headers->len; i++)
+        g_string_append_printf(text, "%s\r\n", (const gchar*)g_ptr_array_index(request->headers, i));
+    g_string_append(text, "Connection: close\r\n\r\n");
+    if (!write_string(g_io_stream_get_output_stream(G_IO_STREAM(connection)), text->str, NULL)) {
+        send_error(output, "502 Bad Gateway");
+        goto done;
+    }
+
+    // 응답 헤더: hop-by-hop만 빼고 그대로 전달
+    input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    g_data_input_stream_set_newline_type(input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+    line = g_data_input_stream_read_line(input, NULL, NULL, NULL);
+    if (!line || !g_str_has_prefix(line, "HTTP/1.") || !strchr(line, ' ')) {
+        g_free(line);
+        send_error(output, "502 Bad Gateway");
+        goto done;
+    }
+    status = atoi(strchr(line, ' ') + 1);
+    store = request->cacheable && status == 200;
+    g_string_printf(text, "%s\r\n", line);
+    g_free(line);
+    while ((line = g_data_input_stream_read_line(input, NULL, NULL, NULL)) && *line) {
+        const gchar* value;
+
+        if ((value = header_value(line, "Content-Length")))
+            content_length = g_ascii_strtoll(value, NULL, 10);
+        else if ((value = header_value(line, "Transfer-Encoding")))
+            chunked = g_ascii_strcasecmp(value, "chunked") == 0;
+        // 플레이리스트인데 확장자가 .m3u8이 아닌 경우
+        else if ((value = header_value(line, "Content-Type")) && strstr(value, "mpegurl"))
+            store = FALSE;
+        if (!is_hop_header(line))
+            g_string_append_printf(text, "%s\r\n", line);
+        g_free(line);
+    }
+    g_free(line);
+    g_string_append_printf(text, "X-Cache: %s\r\nConnection: close\r\n\r\n", store ? "MISS" : "BYPASS");
+    if (!write_string(output, text->str, NULL))
+        goto done;
+
+    if (store) {
+        gchar* name = g_strdup_printf("%s.%08x.tmp", request->key, g_random_int());
+
+        temp_path = g_build_filename(cache->dir, name, NULL);
+        g_free(name);
+        file = g_fopen(temp_path, "wb");
+    }
+    // chunked가 아니면 Content-Length 또는 연결이 닫힐 때까지
+    ok = chunked ? copy_chunked_body(input, output, file, &copied)
+                 : copy_body(G_INPUT_STREAM(input), content_length, output, file, &copied);
+    if (file && fclose(file) != 0)
+        ok = FALSE;
+    file = NULL;
+
+done:
+    g_mutex_lock(&cache->lock);
+    if (!ok) {
+        cache->errors++;
+    }
+    else if (store && temp_path && (content_length < 0 || copied == (guint64)content_length)) {
+        gchar* path = entry_path(cache, request->key);
+
+        if (g_rename(temp_path, path) == 0) {
+            insert_locked(cache, request->key, copied, g_get_real_time());
+            cache->misses++;
+            cache->miss_bytes += copied;
+            evict_locked(cache);
+        }
+        g_free(path);
+    }
+    else {
+        cache->uncached++;
+    }
+    g_mutex_unlock(&cache->lock);
+    if (temp_path) {
+        g_unlink(temp_path);
+        g_free(temp_path);
+    }
+    if (file)
+        fclose(file);
+    if (input)
+        g_object_unref(input);
+    if (connection)
+        g_object_unref(connection);
+    g_object_unref(client);
+    g_string_free(text, TRUE);
+}
+
+// 색인에 있거나 디스크에 있으면 적중. 다른 요청이 받고 있으면 끝날 때까지 기다림.
+// 적중이 아니면 이 요청이 받을 차례 (fetching에 넣음). 기다리다 시간이 지나면 받는 요청을 하나로 유지하기 위해
+// fetching에 넣지 않고 저장 없이 전달만 함 (먼저 받던 요청의 release_fetch가 표시를 지움)
+static FetchClaim claim_fetch(SegmentCache* cache, ProxyRequest* request, gboolean* waited) {
+    gint64 deadline = g_get_monotonic_time() + SEGMENT_CACHE_WAIT_US;
+    CacheEntry* entry;
+
+    g_mutex_lock(&cache->lock);
+    while (g_hash_table_contains(cache->fetching, request->key)) {
+        *waited = TRUE;
+        if ((!g_cond_wait_until(&cache->fetched, &cache->lock, deadline) || cache->closing) &&
+            g_hash_table_contains(cache->fetching, request->key)) {
+            g_mutex_unlock(&cache->lock);
+            return FETCH_CLAIM_BYPASS;
+        }
+    }
+    entry = g_hash_table_lookup(cache->entries, request->key);
+    if (!entry) {
+        // 같은 디렉터리를 쓰는 다른 프로세스가 받아 둔 세그먼트
+        gchar* path = entry_path(cache, request->key);
+        GStatBuf st;
+
+        if (g_stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            insert_locked(cache, request->key, (guint64)st.st_size, g_get_real_time());
+            evict_locked(cache);
+            entry = g_hash_table_lookup(cache->entries, request->key);
+        }
+        g_free(path);
+    }
+    if (entry) {
+        entry->last_used = g_get_real_time();
+        g_mutex_unlock(&cache->lock);
+        return FETCH_CLAIM_HIT;
+    }
+    g_hash_table_add(cache->fetching, g_strdup(request->key));
+    g_mutex_unlock(&cache->lock);
+    return FETCH_CLAIM_FETCH;
+}
+
+static void release_fetch(SegmentCache* cache, ProxyRequest* request) {
+    g_mutex_lock(&cache->lock);
+    g_hash_table_remove(cache->fetching, request->key);
+    g_cond_broadcast(&cache->fetched);
+    g_mutex_unlock(&cache->lock);
+}
+
+// 연결 하나에 요청 하나 (Connection: close)
+static gboolean run_handler(GThreadedSocketService* service, GSocketConnection* connection, GObject* source_object,
+    SegmentCache* cache) {
+    GOutputStream* output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+    GDataInputStream* input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+    ProxyRequest* request;
+    gboolean waited = FALSE;
+    gboolean retried = FALSE;
+
+    g_mutex_lock(&cache->lock);
+    if (cache->closing) {
+        g_mutex_unlock(&cache->lock);
+        g_object_unref(input);
+        return TRUE;
+    }
+    cache->active++;
+    g_mutex_unlock(&cache->lock);
+
+    g_socket_set_timeout(g_socket_connection_get_socket(connection), SEGMENT_CACHE_IO_TIMEOUT_SEC);
+    g_data_input_stream_set_newline_type(input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+    request = read_request(input, output);
+    g_object_unref(input);
+    if (!request)
+        goto done;
+
+    g_mutex_lock(&cache->lock);
+    cache->requests++;
+    g_mutex_unlock(&cache->lock);
+    for (;;) {
+        FetchClaim claim = request->cacheable ? claim_fetch(cache, request, &waited) : FETCH_CLAIM_BYPASS;
+
+        if (claim == FETCH_CLAIM_BYPASS) {
+            request->cacheable = FALSE;
+            fetch_and_serve(cache, request, output);
+            break;
+        }
+        if (claim == FETCH_CLAIM_FETCH) {
+            fetch_and_serve(cache, request, output);
+            release_fetch(cache, request);
+            break;
+        }
+        if (serve_cached(cache, request, output)) {
+            g_mutex_lock(&cache->lock);
+            cache->hits++;
+            if (waited)
+                cache->coalesced++;
+            g_mutex_unlock(&cache->lock);
+            break;
+        }
+        // 색인에는 있었지만 다른 프로세스가 지움: 색인에서 빼고 다시 차례를 받음 (동시 요청은 하나만 받음).
+        // 파일이 있는데 열 수 없으면 다시 적중으로 돌아오므로 한 번만 다시 시도하고 그다음은 전달만
+        g_mutex_lock(&cache->lock);
+        remove_locked(cache, request->key);
+        g_mutex_unlock(&cache->lock);
+        if (retried)
+            request->cacheable = FALSE;
+        retried = TRUE;
+    }
+    proxy_request_free(request);
+
+done:
+    g_mutex_lock(&cache->lock);
+    if (--cache->active == 0)
+        g_cond_broadcast(&cache->idle);
+    g_mutex_unlock(&cache->lock);
+    return TRUE;
+}
+
+// "http://[user:password@]host[:port]" (http 프록시만, CONNECT를 쓰는 https 프록시는 받지 않음)
+static gboolean set_upstream_proxy(SegmentCache* cache, const gchar* upstream, GError** error) {
+    GUri* uri = g_uri_parse(upstream, G_URI_FLAGS_HAS_PASSWORD, NULL);
+
+    if (!uri || g_strcmp0(g_uri_get_scheme(uri), "http") != 0 || !g_uri_get_host(uri) || !*g_uri_get_host(uri)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Unsupported upstream proxy '%s' (expected http://host:port)", upstream);
+        if (uri)
+            g_uri_unref(uri);
+        return FALSE;
+    }
+    cache->upstream_host = g_strdup(g_uri_get_host(uri));
+    cache->upstream_port = g_uri_get_port(uri) > 0 ? g_uri_get_port(uri) : 80;
+    if (g_uri_get_user(uri)) {
+        gchar* credentials = g_strdup_printf("%s:%s", g_uri_get_user(uri), g_uri_get_password(uri) ? g_uri_get_password(uri) : "");
+        gchar* encoded = g_base64_encode((const guchar*)credentials, strlen(credentials));
+
+        cache->upstream_auth = g_strdup_printf("Basic %s", encoded);
+        g_free(encoded);
+        g_free(credentials);
+    }
+    g_uri_unref(uri);
+    return TRUE;
+}
+
+static void segment_cache_clear(SegmentCache* cache) {
+    g_free(cache->upstream_host);
+    g_free(cache->upstream_auth);
+    g_hash_table_destroy(cache->entries);
+    g_hash_table_destroy(cache->fetching);
+    g_cond_clear(&cache->fetched);
+    g_cond_clear(&cache->idle);
+    g_mutex_clear(&cache->lock);
+    g_free(cache->dir);
+    g_free(cache->proxy_uri);
+}
+
+static void segment_cache_release(SegmentCache* cache) {
+    g_atomic_rc_box_release_full(cache, (GDestroyNotify)segment_cache_clear);
+}
+
+SegmentCache* segment_cache_new(const gchar* dir, guint64 max_bytes, const gchar* upstream_proxy, GError** error) {
+    SegmentCache* cache;
+    GInetAddress* loopback;
+    GSocketAddress* address;
+    GSocketAddress* bound = NULL;
+    gboolean ok;
+
+    if (g_mkdir_with_parents(dir, 0755) != 0) {
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errno), "Could not create %s: %s", dir, g_strerror(errno));
+        return NULL;
+    }
+    // 참조 하나는 호출한 쪽, 하나는 "run" 핸들러 (작업이 남아 있는 동안 서비스가 살아 있으므로)
+    cache = g_atomic_rc_box_new0(SegmentCache);
+    cache->dir = g_strdup(dir);
+    cache->max_bytes = max_bytes;
+    if (upstream_proxy && *upstream_proxy && !set_upstream_proxy(cache, upstream_proxy, error)) {
+        g_free(cache->dir);
+        g_atomic_rc_box_release(cache);
+        return NULL;
+    }
+    g_mutex_init(&cache->lock);
+    g_cond_init(&cache->fetched);
+    g_cond_init(&cache->idle);
+    cache->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    cache->fetching = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    scan_dir(cache);
+
+    // 다른 호스트에서 프록시로 쓰지 못하도록 루프백에만, 포트는 커널이 고름
+    cache->service = g_threaded_socket_service_new(SEGMENT_CACHE_MAX_THREADS);
+    loopback = g_inet_address_new_loopback(G_SOCKET_FAMILY_IPV4);
+    address = g_inet_socket_address_new(loopback, 0);
+    ok = g_socket_listener_add_address(G_SOCKET_LISTENER(cache->service), address,
+        G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, NULL, &bound, error);
+    g_object_unref(address);
+    g_object_unref(loopback);
+    if (!ok) {
+        segment_cache_free(cache);
+        return NULL;
+    }
+    cache->proxy_uri = g_strdup_printf("http://127.0.0.1:%u", g_inet_socket_address_get_port(G_INET_SOCKET_ADDRESS(bound)));
+    g_object_unref(bound);
+    g_signal_connect_data(cache->service, "run", G_CALLBACK(run_handler), g_atomic_rc_box_acquire(cache),
+        (GClosureNotify)segment_cache_release, 0);
+    g_socket_service_start(cache->service);
+    return cache;
+}
+
+void segment_cache_free(SegmentCache* cache) {
+    if (!cache)
+        return;
+    // stop은 새 연결만 막으므로 이미 받은 요청은 끝날 때까지 기다림 (차례를 기다리던 요청은 바로 전달로 돌림).
+    // 아직 run_handler에 들어오지 않은 작업은 closing을 보고 바로 돌아가고, 그때까지 구조체는 핸들러의 참조로 남음
+    g_mutex_lock(&cache->lock);
+    cache->closing = TRUE;
+    g_cond_broadcast(&cache->fetched);
+    g_mutex_unlock(&cache->lock);
+    g_socket_service_stop(cache->service);
+    g_socket_listener_close(G_SOCKET_LISTENER(cache->service));
+    g_mutex_lock(&cache->lock);
+    while (cache->active > 0)
+        g_cond_wait(&cache->idle, &cache->lock);
+    g_mutex_unlock(&cache->lock);
+    g_object_unref(cache->service);
+    segment_cache_release(cache);
+}
+
+const gchar* segment_cache_get_proxy_uri(SegmentCache* cache) {
+    return cache->proxy_uri;
+}
+
+void segment_cache_append_json(SegmentCache* cache, GString* json) {
+    gchar* dir = g_strescape(cache->dir, NULL);
+
+    g_mutex_lock(&cache->lock);
+    g_string_append_printf(json, "{\"dir\":\"%s\",\"proxy\":\"%s\",", dir, cache->proxy_uri);
+    if (cache->upstream_host)
+        g_string_append_printf(json, "\"upstream\":\"%s:%d\",", cache->upstream_host, cache->upstream_port);
+    g_string_append_printf(json,
+        "\"entries\":%u,\"bytes\":%" G_GUINT64_FORMAT ",\"max_bytes\":%" G_GUINT64_FORMAT ","
+        "\"requests\":%" G_GUINT64_FORMAT ",\"hits\":%" G_GUINT64_FORMAT ",\"misses\":%" G_GUINT64_FORMAT ","
+        "\"coalesced\":%" G_GUINT64_FORMAT ",\"uncached\":%" G_GUINT64_FORMAT ",\"evictions\":%" G_GUINT64_FORMAT ","
+        "\"errors\":%" G_GUINT64_FORMAT ",\"hit_bytes\":%" G_GUINT64_FORMAT ",\"miss_bytes\":%" G_GUINT64_FORMAT ",\"hit_ratio\":%.3f}",
+        g_hash_table_size(cache->entries), cache->bytes, cache->max_bytes,
+        cache->requests, cache->hits, cache->misses, cache->coalesced, cache->uncached, cache->evictions,
+        cache->errors, cache->hit_bytes, cache->miss_bytes,
+        cache->hits + cache->misses > 0 ? (gdouble)cache->hits / (cache->hits + cache->misses) : 0.0);
+    g_mutex_unlock(&cache->lock);
+    g_free(dir);
+}
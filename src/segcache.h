@@ -0,0 +1,31 @@
+#ifndef CLIPPER_SEGCACHE_H
+#define CLIPPER_SEGCACHE_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+// HLS 세그먼트 디스크 캐시 (프로세스에 하나). 127.0.0.1의 임의 포트에서 HTTP 프록시로 동작하고,
+// souphttpsrc/hlsdemux가 http_proxy로 이 프록시를 거치게 하면 같은 세그먼트를 다시 받지 않는다.
+// - 세그먼트 응답(200, 플레이리스트 제외)을 URL의 SHA-256 이름으로 디렉터리에 저장 (임시 파일 + rename).
+//   디렉터리는 재시작이나 같은 디렉터리를 쓰는 다른 프로세스와도 공유된다.
+// - 크기 상한을 넘으면 가장 오래 쓰지 않은 세그먼트부터 지움 (LRU, 마지막 사용 시각은 파일 mtime에도 남김)
+// - 여러 파이프라인이 같은 세그먼트를 동시에 요청하면 하나만 받고 나머지는 끝날 때까지 기다렸다가 캐시에서 읽음
+// - 플레이리스트(.m3u8)와 Range 요청, 200이 아닌 응답은 저장하지 않고 그대로 전달
+// 요청마다 GThreadedSocketService의 작업 스레드에서 블로킹 입출력으로 처리한다.
+typedef struct _SegmentCache SegmentCache;
+
+// dir이 없으면 만들고, 남아 있는 세그먼트를 색인에 올린 뒤 프록시를 시작.
+// upstream_proxy: 원 서버 대신 요청을 보낼 http 프록시 (캐시를 켜기 전의 http_proxy, NULL이면 직접 연결)
+SegmentCache* segment_cache_new(const gchar* dir, guint64 max_bytes, const gchar* upstream_proxy, GError** error);
+void segment_cache_free(SegmentCache* cache);
+
+// "http://127.0.0.1:PORT" (http_proxy 값)
+const gchar* segment_cache_get_proxy_uri(SegmentCache* cache);
+
+// 항목 수/크기, 적중/실패/대기/저장하지 않은 요청 수, 지운 항목 수, 적중률
+void segment_cache_append_json(SegmentCache* cache, GString* json);
+
+G_END_DECLS
+
+#endif // CLIPPER_SEGCACHE_H
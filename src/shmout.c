@@ -0,0 +1,203 @@
+#include "shmout.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <glib/gstdio.h>
+#include <gst/video/video.h>
+
+// 앞의 leaky 큐가 이만큼 차 있어야 shmsink가 멈춘 것으로 봄 (카메라의 큐 설정과 같은 값)
+#define SHM_STALL_LEVEL 2
+
+struct _ShmOutput {
+    guint frames;
+    GstClockTime reader_timeout;
+    GstElement* queue;
+    GstElement* sink;
+
+    GMutex lock;
+    gchar* socket_path;
+    gchar* caps_path;
+    GArray* clients;                // 연결된 읽기 프로세스 소켓 fd (shmsink 폴링 스레드에서 추가/삭제)
+    gint64 last_publish_us;         // 마지막으로 shmsink에 프레임이 들어간 시각 (monotonic)
+
+    // 스트리밍/폴링 스레드에서 증가
+    gint frame_size;
+    gint published;                 // shmsink에 들어간 프레임 수
+    gint dropped;                   // 큐가 가득 차서 버린 프레임 수
+    gint connects;
+    gint disconnects;
+    gint kicked;                    // 멈춘 영역을 돌려받으려고 끊은 연결 수
+};
+
+static void client_connected_handler(GstElement* sink, gint fd, ShmOutput* shm) {
+    g_mutex_lock(&shm->lock);
+    g_array_append_val(shm->clients, fd);
+    g_mutex_unlock(&shm->lock);
+    g_atomic_int_inc(&shm->connects);
+}
+
+// shmsink는 이 시그널 뒤에 fd를 닫으므로 닫힌 fd 번호가 재사용되기 전에 목록에서 빠짐
+static void client_disconnected_handler(GstElement* sink, gint fd, ShmOutput* shm) {
+    guint i;
+
+    g_mutex_lock(&shm->lock);
+    for (i = 0; i < shm->clients->len; i++) {
+        if (g_array_index(shm->clients, gint, i) == fd) {
+            g_array_remove_index_fast(shm->clients, i);
+            break;
+        }
+    }
+    g_mutex_unlock(&shm->lock);
+    g_atomic_int_inc(&shm->disconnects);
+}
+
+static void queue_overrun_handler(GstElement* queue, ShmOutput* shm) {
+    g_atomic_int_inc(&shm->dropped);
+}
+
+// caps가 정해지면 영역 크기를 프레임 수에 맞추고 읽는 쪽을 위해 caps 파일을 씀
+static void apply_caps(ShmOutput* shm, GstCaps* caps) {
+    GstVideoInfo info;
+    gchar* caps_string;
+    gchar* caps_path;
+    GError* error = NULL;
+    guint size = 0;
+    guint wanted;
+
+    if (!gst_video_info_from_caps(&info, caps))
+        return;
+    g_atomic_int_set(&shm->frame_size, (gint)GST_VIDEO_INFO_SIZE(&info));
+    // 할당 조각이 남을 수 있으므로 한 프레임 여유. 줄이지는 않음 (읽는 쪽이 아직 잡고 있을 수 있음)
+    wanted = (guint)MIN((guint64)(shm->frames + 1) * GST_VIDEO_INFO_SIZE(&info), G_MAXUINT);
+    g_object_get(G_OBJECT(shm->sink), "shm-size", &size, NULL);
+    if (wanted > size)
+        g_object_set(G_OBJECT(shm->sink), "shm-size", wanted, NULL);
+
+    g_mutex_lock(&shm->lock);
+    caps_path = g_strdup(shm->caps_path);
+    g_mutex_unlock(&shm->lock);
+    caps_string = gst_caps_to_string(caps);
+    // 임시 파일 + rename이므로 읽는 쪽이 반쯤 쓴 caps를 보지 않음
+    if (caps_path && !g_file_set_contents(caps_path, caps_string, -1, &error)) {
+        g_printerr("Could not write %s: %s\n", caps_path, error->message);
+        g_error_free(error);
+    }
+    g_free(caps_string);
+    g_free(caps_path);
+}
+
+static GstPadProbeReturn shm_sink_probe(GstPad* pad, GstPadProbeInfo* info, ShmOutput* shm) {
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        g_atomic_int_inc(&shm->published);
+        g_mutex_lock(&shm->lock);
+        shm->last_publish_us = g_get_monotonic_time();
+        g_mutex_unlock(&shm->lock);
+    }
+    else if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) == GST_EVENT_CAPS) {
+        GstCaps* caps;
+
+        gst_event_parse_caps(GST_PAD_PROBE_INFO_EVENT(info), &caps);
+        apply_caps(shm, caps);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+ShmOutput* shm_output_new(guint frames, GstClockTime reader_timeout) {
+    ShmOutput* shm = g_new0(ShmOutput, 1);
+
+    shm->frames = MAX(frames, 1);
+    shm->reader_timeout = reader_timeout;
+    g_mutex_init(&shm->lock);
+    shm->clients = g_array_new(FALSE, FALSE, sizeof(gint));
+    return shm;
+}
+
+void shm_output_free(ShmOutput* shm) {
+    if (!shm)
+        return;
+    if (shm->caps_path)
+        g_unlink(shm->caps_path);
+    if (shm->queue)
+        gst_object_unref(shm->queue);
+    if (shm->sink)
+        gst_object_unref(shm->sink);
+    g_array_free(shm->clients, TRUE);
+    g_mutex_clear(&shm->lock);
+    g_free(shm->socket_path);
+    g_free(shm->caps_path);
+    g_free(shm);
+}
+
+void shm_output_attach(ShmOutput* shm, GstElement* queue, GstElement* sink) {
+    GstPad* sink_pad = gst_element_get_static_pad(sink, "sink");
+
+    shm->queue = gst_object_ref(queue);
+    shm->sink = gst_object_ref(sink);
+    g_signal_connect(queue, "overrun", G_CALLBACK(queue_overrun_handler), shm);
+    g_signal_connect(sink, "client-connected", G_CALLBACK(client_connected_handler), shm);
+    g_signal_connect(sink, "client-disconnected", G_CALLBACK(client_disconnected_handler), shm);
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+        (GstPadProbeCallback)shm_sink_probe, shm, NULL);
+    gst_object_unref(sink_pad);
+}
+
+void shm_output_set_path(ShmOutput* shm, const gchar* socket_path) {
+    g_mutex_lock(&shm->lock);
+    if (shm->caps_path)
+        g_unlink(shm->caps_path);
+    g_free(shm->socket_path);
+    g_free(shm->caps_path);
+    shm->socket_path = g_strdup(socket_path);
+    shm->caps_path = g_strconcat(socket_path, ".caps", NULL);
+    g_array_set_size(shm->clients, 0);
+    g_mutex_unlock(&shm->lock);
+    // 이전 실행이 남긴 소켓이 있으면 shmsink가 시작하지 못함
+    g_unlink(socket_path);
+    g_object_set(G_OBJECT(shm->sink), "socket-path", socket_path, NULL);
+}
+
+// 큐가 가득 찼는데 shmsink에 reader_timeout 넘게 프레임이 못 들어갔으면 영역이 읽는 쪽에 잡혀 있는 것.
+// 어느 연결이 느린지는 shmsink가 알려 주지 않으므로 모두 끊음 (빠른 읽기 프로세스는 다시 붙으면 됨)
+void shm_output_check(ShmOutput* shm) {
+    gint64 now = g_get_monotonic_time();
+    guint level = 0;
+    guint i;
+
+    if (shm->reader_timeout == 0 || !shm->queue)
+        return;
+    g_object_get(G_OBJECT(shm->queue), "current-level-buffers", &level, NULL);
+    if (level < SHM_STALL_LEVEL)
+        return;
+    g_mutex_lock(&shm->lock);
+    if (shm->clients->len > 0 && shm->last_publish_us > 0 &&
+        now - shm->last_publish_us > (gint64)(shm->reader_timeout / GST_USECOND)) {
+        g_printerr("%s: no frame published for %.0f ms, disconnecting %u reader(s).\n", shm->socket_path,
+            (now - shm->last_publish_us) / 1000.0, shm->clients->len);
+        // 닫는 것은 shmsink 폴링 스레드가 함 (끊김을 보고 잡혀 있던 버퍼를 풀고 client-disconnected)
+        for (i = 0; i < shm->clients->len; i++) {
+            if (shutdown(g_array_index(shm->clients, gint, i), SHUT_RDWR) < 0)
+                g_printerr("%s: shutdown failed: %s\n", shm->socket_path, g_strerror(errno));
+        }
+        g_atomic_int_add(&shm->kicked, (gint)shm->clients->len);
+        // 끊긴 연결이 정리될 시간을 줌
+        shm->last_publish_us = now;
+    }
+    g_mutex_unlock(&shm->lock);
+}
+
+void shm_output_append_json(ShmOutput* shm, GString* json) {
+    guint readers;
+    gchar* path;
+
+    g_mutex_lock(&shm->lock);
+    readers = shm->clients->len;
+    path = g_strescape(shm->socket_path ? shm->socket_path : "", NULL);
+    g_mutex_unlock(&shm->lock);
+    g_string_append_printf(json,
+        "{\"socket\":\"%s\",\"frame_bytes\":%d,\"readers\":%u,\"connects\":%d,\"disconnects\":%d,\"kicked\":%d,"
+        "\"published\":%d,\"dropped\":%d}",
+        path, g_atomic_int_get(&shm->frame_size), readers, g_atomic_int_get(&shm->connects),
+        g_atomic_int_get(&shm->disconnects), g_atomic_int_get(&shm->kicked),
+        g_atomic_int_get(&shm->published), g_atomic_int_get(&shm->dropped));
+    g_free(path);
+}
@@ -0,0 +1,34 @@
+#ifndef CLIPPER_SHMOUT_H
+#define CLIPPER_SHMOUT_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+// 디코딩된 프레임을 같은 호스트의 다른 프로세스에 공유 메모리로 내보내는 브랜치 (카메라당 하나).
+// shmsink가 프레임을 공유 메모리 영역에 한 번 쓰고 유닉스 소켓으로 위치만 알리므로
+// 읽는 쪽(shmsrc) 수가 늘어도 프레임 복사는 늘지 않고, 읽는 쪽은 아무 때나 붙었다 떨어질 수 있다.
+// 느린 읽기 프로세스가 영역을 다 잡고 있으면 shmsink가 멈추는데, 앞의 leaky 큐가 프레임을 버려 tee는 막히지 않고,
+// reader_timeout 동안 한 프레임도 못 내보내면 연결된 읽기 프로세스들의 소켓을 끊어 잡고 있던 영역을 돌려받는다.
+// caps는 소켓 경로 + ".caps" 파일에 caps 문자열로 남긴다 (shmsrc에는 caps가 전달되지 않음).
+typedef struct _ShmOutput ShmOutput;
+
+// frames: 공유 메모리 영역에 담을 프레임 수 (caps를 알면 프레임 크기 x frames로 영역 크기를 정함)
+ShmOutput* shm_output_new(guint frames, GstClockTime reader_timeout);
+// 파이프라인을 해제한 뒤에 호출 (caps 파일 삭제)
+void shm_output_free(ShmOutput* shm);
+
+// queue: 브랜치 앞의 leaky 큐 (버린 프레임 수), sink: shmsink (연결/끊김, caps, 내보낸 프레임 수)
+void shm_output_attach(ShmOutput* shm, GstElement* queue, GstElement* sink);
+// 소켓 경로 지정 (shmsink가 시작하기 전, READY 이하에서)
+void shm_output_set_path(ShmOutput* shm, const gchar* socket_path);
+
+// 메인 루프에서 주기적으로 호출: shmsink가 reader_timeout 넘게 멈춰 있으면 읽기 프로세스 연결을 끊음
+void shm_output_check(ShmOutput* shm);
+
+// 소켓 경로, 연결 수, 내보낸/버린 프레임 수, 끊은 연결 수
+void shm_output_append_json(ShmOutput* shm, GString* json);
+
+G_END_DECLS
+
+#endif // CLIPPER_SHMOUT_H
@@ -0,0 +1,36 @@
+#include "workers.h"
+
+static guint worker_limit;
+static gboolean worker_limit_set;
+static guint workers_in_use;
+
+void workers_set_limit(guint limit) {
+    worker_limit = limit > 0 ? limit : MAX(g_get_num_processors(), 2) - 1;
+    worker_limit_set = TRUE;
+}
+
+guint workers_get_limit(void) {
+    if (!worker_limit_set)
+        workers_set_limit(0);
+    return worker_limit;
+}
+
+guint workers_get_in_use(void) {
+    return workers_in_use;
+}
+
+guint workers_acquire(guint wanted) {
+    guint limit = workers_get_limit();
+    guint extra;
+
+    if (wanted <= 1)
+        return 1;
+    // 스트리밍 스레드가 한 슬라이스를 맡으므로 추가 스레드는 wanted - 1개
+    extra = MIN(wanted - 1, limit > workers_in_use ? limit - workers_in_use : 0);
+    workers_in_use += extra;
+    return extra + 1;
+}
+
+void workers_release(guint extra) {
+    workers_in_use -= MIN(extra, workers_in_use);
+}
@@ -0,0 +1,26 @@
+#ifndef CLIPPER_WORKERS_H
+#define CLIPPER_WORKERS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// 프로세스 전체 변환 작업 스레드 예산.
+// videoconvert/videoscale의 n-threads는 프레임을 줄 단위 슬라이스로 나눠 엘리먼트 자신의 작업 스레드
+// (n-threads - 1개)와 스트리밍 스레드가 함께 처리한다. 카메라가 많을 때 코어보다 많은 작업 스레드가
+// 생기지 않도록 모든 카메라가 이 예산에서 추가 스레드를 받고, 카메라를 해제할 때 돌려준다.
+// 엘리먼트를 만들고 해제하는 메인 루프 스레드에서만 호출한다.
+
+// 추가 작업 스레드 상한 (0 = 코어 수 - 1)
+void workers_set_limit(guint limit);
+guint workers_get_limit(void);
+guint workers_get_in_use(void);
+
+// wanted개 슬라이스를 원할 때 실제로 쓸 n-threads (예산이 없으면 1 = 스트리밍 스레드만)
+guint workers_acquire(guint wanted);
+// workers_acquire로 받은 추가 스레드(n-threads - 1)를 반납 (카메라 하나의 합계를 한 번에 반납해도 됨)
+void workers_release(guint extra);
+
+G_END_DECLS
+
+#endif // CLIPPER_WORKERS_H
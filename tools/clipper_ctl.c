@@ -0,0 +1,194 @@
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+// main_app --control-socket 용 클라이언트.
+//   clipper_ctl -s /tmp/clipper.sock status
+//   clipper_ctl -s /tmp/clipper.sock start lobby
+//   clipper_ctl -s /tmp/clipper.sock --latency 20 --camera lobby
+// --latency 모드는 start를 보낸 순간부터 status에서 clip_started가 참이 될 때까지(첫 키프레임이 muxer에 도착)
+// 시간을 재고, stop 후 클립이 닫힐 때까지 기다리기를 반복한다.
+
+#define POLL_INTERVAL_US 1000
+#define WAIT_TIMEOUT_US (30 * G_USEC_PER_SEC)
+
+typedef struct _Control {
+    GSocketConnection* connection;
+    GDataInputStream* input;
+    GOutputStream* output;
+} Control;
+
+static gboolean control_connect(Control* control, const gchar* path, GError** error) {
+    GSocketClient* client = g_socket_client_new();
+    GSocketAddress* address = g_unix_socket_address_new(path);
+
+    control->connection = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, error);
+    g_object_unref(address);
+    g_object_unref(client);
+    if (!control->connection)
+        return FALSE;
+    control->input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(control->connection)));
+    control->output = g_io_stream_get_output_stream(G_IO_STREAM(control->connection));
+    return TRUE;
+}
+
+static void control_close(Control* control) {
+    if (control->input)
+        g_object_unref(control->input);
+    if (control->connection)
+        g_object_unref(control->connection);
+}
+
+// 명령 한 줄을 보내고 응답 한 줄을 받음 (개행 제외, 호출자가 해제)
+static gchar* control_request(Control* control, const gchar* command, GError** error) {
+    gchar* line = g_strdup_printf("%s\n", command);
+    gboolean ok = g_output_stream_write_all(control->output, line, strlen(line), NULL, NULL, error);
+    gchar* reply;
+
+    g_free(line);
+    if (!ok)
+        return NULL;
+    reply = g_data_input_stream_read_line_utf8(control->input, NULL, NULL, error);
+    if (!reply && error && !*error)
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_CLOSED, "connection closed");
+    return reply;
+}
+
+// status 응답에 needle이 나타날 때까지 폴링
+static gboolean wait_status(Control* control, const gchar* status_command, const gchar* needle, GError** error) {
+    gint64 deadline = g_get_monotonic_time() + WAIT_TIMEOUT_US;
+
+    while (g_get_monotonic_time() < deadline) {
+        gchar* reply = control_request(control, status_command, error);
+        gboolean found;
+
+        if (!reply)
+            return FALSE;
+        if (!g_str_has_prefix(reply, "ok")) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "%s", reply);
+            g_free(reply);
+            return FALSE;
+        }
+        found = strstr(reply, needle) != NULL;
+        g_free(reply);
+        if (found)
+            return TRUE;
+        g_usleep(POLL_INTERVAL_US);
+    }
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "timed out waiting for %s", needle);
+    return FALSE;
+}
+
+static gint compare_double(gconstpointer a, gconstpointer b) {
+    gdouble x = *(const gdouble*)a;
+    gdouble y = *(const gdouble*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static gboolean run_latency(Control* control, const gchar* camera, gint runs, GError** error) {
+    gchar* start_command = g_strdup_printf("start %s", camera);
+    gchar* stop_command = g_strdup_printf("stop %s", camera);
+    gchar* status_command = g_strdup_printf("status %s", camera);
+    GArray* samples = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    gboolean ok = TRUE;
+    gdouble sum = 0;
+    gint i;
+
+    for (i = 0; ok && i < runs; i++) {
+        gint64 sent;
+        gdouble ms;
+        gchar* reply;
+
+        sent = g_get_monotonic_time();
+        reply = control_request(control, start_command, error);
+        ok = reply && g_str_has_prefix(reply, "ok");
+        if (reply && !ok)
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "%s", reply);
+        g_free(reply);
+        ok = ok && wait_status(control, status_command, "\"clip_started\":true", error);
+        if (!ok)
+            break;
+        ms = (g_get_monotonic_time() - sent) / 1000.0;
+        g_array_append_val(samples, ms);
+        sum += ms;
+        g_printerr("run %d: %.1f ms\n", i + 1, ms);
+
+        // 다음 클립을 시작하기 전에 이전 클립이 GOP 경계에서 닫히길 기다림
+        reply = control_request(control, stop_command, error);
+        ok = reply != NULL;
+        g_free(reply);
+        ok = ok && wait_status(control, status_command, "\"closing\":false", error);
+    }
+
+    if (samples->len > 0) {
+        gdouble* values = (gdouble*)samples->data;
+
+        g_array_sort(samples, compare_double);
+        printf("{\"camera\":\"%s\",\"runs\":%u,\"min_ms\":%.3f,\"avg_ms\":%.3f,\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}\n",
+            camera, samples->len, values[0], sum / samples->len, values[samples->len / 2],
+            values[MIN(samples->len - 1, samples->len * 99 / 100)], values[samples->len - 1]);
+    }
+    g_array_free(samples, TRUE);
+    g_free(start_command);
+    g_free(stop_command);
+    g_free(status_command);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    GOptionContext* context;
+    GError* error = NULL;
+    Control control = { NULL };
+    gchar* socket_path = NULL;
+    gchar* camera = NULL;
+    gint latency_runs = 0;
+    gboolean ok;
+    GOptionEntry entries[] = {
+        { "socket", 's', 0, G_OPTION_ARG_FILENAME, &socket_path, "Control socket of main_app", "PATH" },
+        { "latency", 'l', 0, G_OPTION_ARG_INT, &latency_runs, "Measure command-to-first-frame latency over N clips", "N" },
+        { "camera", 'c', 0, G_OPTION_ARG_STRING, &camera, "Camera for --latency (default: 0)", "NAME" },
+        { NULL }
+    };
+
+    context = g_option_context_new("[COMMAND...] - send commands to main_app");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+    if (!socket_path || (latency_runs <= 0 && argc < 2)) {
+        g_printerr("Usage: %s --socket PATH (COMMAND... | --latency N [--camera NAME])\n", argv[0]);
+        return -1;
+    }
+
+    ok = control_connect(&control, socket_path, &error);
+    if (ok && latency_runs > 0) {
+        ok = run_latency(&control, camera ? camera : "0", latency_runs, &error);
+    }
+    else if (ok) {
+        // 나머지 인자를 공백으로 이어 명령 한 줄로 보냄
+        gchar* command = g_strjoinv(" ", argv + 1);
+        gchar* reply = control_request(&control, command, &error);
+
+        ok = reply != NULL;
+        if (reply)
+            printf("%s\n", reply);
+        ok = ok && g_str_has_prefix(reply, "ok");
+        g_free(reply);
+        g_free(command);
+    }
+    if (error) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+    }
+
+    control_close(&control);
+    g_free(socket_path);
+    g_free(camera);
+    return ok ? 0 : -1;
+}
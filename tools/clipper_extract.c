@@ -0,0 +1,414 @@
+#include <gst/gst.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#include <TargetConditionals.h>
+#endif
+
+// 녹화된 MP4에서 시간 목록대로 클립을 잘라냄 (재인코딩 없이 remux).
+//   clipper_extract --input cam0.mp4 --list ranges.txt --output-dir clips --jobs 4
+// 목록은 한 줄에 "시작 끝 [이름]" (초 또는 HH:MM:SS.mmm, '#'은 주석).
+// 클립마다 filesrc → qtdemux → mp4mux → filesink 파이프라인을 따로 만들어 [시작, 끝] 구간으로 seek하고
+// 실시간 클럭 없이(sink sync=false) 디스크가 허락하는 속도로 흘린다. 여러 클립은 스레드 풀에서 동시에 처리한다.
+// 재인코딩하지 않으므로 클립은 시작 시각 이전의 가장 가까운 키프레임에서 시작한다 (keyframe_start로 보고).
+
+#define DEFAULT_MAX_JOBS 4
+
+typedef struct _ExtractJob {
+    guint index;
+    const gchar* input;
+    gchar* location;
+    GstClockTime start;
+    GstClockTime end;
+
+    GMutex lock;
+    GCond cond;
+    gboolean pads_ready;            // qtdemux no-more-pads (스트리밍 스레드)
+    GPtrArray* gates;               // StreamGate (연결한 디먹서 src 패드)
+    GstClockTime keyframe_start;    // seek 후 첫 비디오 버퍼의 PTS
+
+    gboolean ok;
+    gint64 elapsed_us;
+    gint64 bytes;
+    gchar* error;
+} ExtractJob;
+
+// 디먹서 src 패드: seek을 보낼 때까지 스트리밍 스레드를 막아(BLOCK) 파일 처음부터 읽어 나가지 않게 하고,
+// seek의 FLUSH_STOP 전 버퍼(파일 처음 부분)는 muxer에 보내지 않음
+typedef struct _StreamGate {
+    ExtractJob* job;
+    GstPad* pad;
+    gulong block_id;                // seek을 보낸 뒤 제거
+    gboolean video;
+    gboolean flushed;
+} StreamGate;
+
+// "90", "12.5", "01:02:03.250", "02:03" → GstClockTime
+static gboolean parse_time(const gchar* text, GstClockTime* time) {
+    gchar** parts = g_strsplit(text, ":", -1);
+    guint n = g_strv_length(parts);
+    gdouble seconds = 0;
+    gboolean ok = n >= 1 && n <= 3;
+    guint i;
+
+    for (i = 0; ok && i < n; i++) {
+        gchar* end;
+        gdouble value = g_ascii_strtod(parts[i], &end);
+
+        ok = end != parts[i] && *end == '\0' && value >= 0;
+        seconds = seconds * 60 + value;
+    }
+    g_strfreev(parts);
+    if (ok)
+        *time = (GstClockTime)(seconds * GST_SECOND);
+    return ok;
+}
+
+// 공백/탭/쉼표로 구분 (연속된 구분자가 만든 빈 필드는 제거)
+static gchar** split_fields(const gchar* line) {
+    gchar** fields = g_strsplit_set(line, " \t,", -1);
+    guint from, to = 0;
+
+    for (from = 0; fields[from]; from++) {
+        if (fields[from][0] != '\0')
+            fields[to++] = fields[from];
+        else
+            g_free(fields[from]);
+    }
+    fields[to] = NULL;
+    return fields;
+}
+
+static void job_free(ExtractJob* job) {
+    g_ptr_array_free(job->gates, TRUE);
+    g_mutex_clear(&job->lock);
+    g_cond_clear(&job->cond);
+    g_free(job->location);
+    g_free(job->error);
+    g_free(job);
+}
+
+static GPtrArray* load_ranges(const gchar* path, const gchar* input, const gchar* output_dir, GError** error) {
+    GPtrArray* jobs;
+    gchar* contents;
+    gchar** lines;
+    gchar* base;
+    gchar* dot;
+    guint i;
+
+    if (!g_file_get_contents(path, &contents, NULL, error))
+        return NULL;
+    base = g_path_get_basename(input);
+    dot = strrchr(base, '.');
+    if (dot)
+        *dot = '\0';
+    jobs = g_ptr_array_new_with_free_func((GDestroyNotify)job_free);
+    lines = g_strsplit(contents, "\n", -1);
+    for (i = 0; lines[i]; i++) {
+        gchar** fields;
+        ExtractJob* job;
+        GstClockTime start, end;
+        gchar* name;
+
+        g_strstrip(lines[i]);
+        if (lines[i][0] == '\0' || lines[i][0] == '#')
+            continue;
+        fields = split_fields(lines[i]);
+        if (g_strv_length(fields) < 2 || !parse_time(fields[0], &start) || !parse_time(fields[1], &end) || end <= start) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "%s:%u: expected 'START END [NAME]' with START < END", path, i + 1);
+            g_strfreev(fields);
+            break;
+        }
+        name = fields[2] ? g_strdup_printf("%s.mp4", fields[2]) : g_strdup_printf("%s-%03u.mp4", base, jobs->len + 1);
+        job = g_new0(ExtractJob, 1);
+        job->index = jobs->len + 1;
+        job->input = input;
+        job->location = g_build_filename(output_dir, name, NULL);
+        job->start = start;
+        job->end = end;
+        job->keyframe_start = GST_CLOCK_TIME_NONE;
+        job->gates = g_ptr_array_new();
+        g_mutex_init(&job->lock);
+        g_cond_init(&job->cond);
+        g_ptr_array_add(jobs, job);
+        g_free(name);
+        g_strfreev(fields);
+    }
+    g_strfreev(lines);
+    g_free(contents);
+    g_free(base);
+    if (error && *error) {
+        g_ptr_array_free(jobs, TRUE);
+        return NULL;
+    }
+    return jobs;
+}
+
+// 차단만 함 (FLUSH_START가 오면 막혀 있던 버퍼는 버려지고 스트리밍 스레드가 풀림)
+static GstPadProbeReturn stream_block_probe(GstPad* pad, GstPadProbeInfo* info, StreamGate* gate) {
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn stream_gate_probe(GstPad* pad, GstPadProbeInfo* info, StreamGate* gate) {
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+
+        if (!gate->flushed)
+            return GST_PAD_PROBE_DROP;
+        if (gate->video && !GST_CLOCK_TIME_IS_VALID(gate->job->keyframe_start))
+            gate->job->keyframe_start = GST_BUFFER_PTS(buffer);
+        return GST_PAD_PROBE_OK;
+    }
+    if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) == GST_EVENT_FLUSH_STOP)
+        gate->flushed = TRUE;
+    return GST_PAD_PROBE_OK;
+}
+
+// H.264/H.265/AAC 등 mp4mux가 받는 스트림만 연결 (나머지는 not-linked로 버려짐)
+static void demux_pad_added_handler(GstElement* demux, GstPad* pad, GstElement* muxer) {
+    ExtractJob* job = g_object_get_data(G_OBJECT(demux), "job");
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    const gchar* media = caps ? gst_structure_get_name(gst_caps_get_structure(caps, 0)) : "";
+    const gchar* template_name = NULL;
+    GstPad* mux_pad;
+    StreamGate* gate;
+
+    if (g_str_has_prefix(media, "video/"))
+        template_name = "video_%u";
+    else if (g_str_has_prefix(media, "audio/"))
+        template_name = "audio_%u";
+    if (!template_name) {
+        if (caps)
+            gst_caps_unref(caps);
+        return;
+    }
+    mux_pad = gst_element_request_pad_simple(muxer, template_name);
+    if (!mux_pad || GST_PAD_LINK_FAILED(gst_pad_link(pad, mux_pad))) {
+        g_printerr("[%u] %s stream could not be linked to mp4mux.\n", job->index, media);
+        if (mux_pad) {
+            gst_element_release_request_pad(muxer, mux_pad);
+            gst_object_unref(mux_pad);
+        }
+        gst_caps_unref(caps);
+        return;
+    }
+    gst_object_unref(mux_pad);
+    gst_caps_unref(caps);
+
+    gate = g_new0(StreamGate, 1);
+    gate->job = job;
+    gate->pad = pad;
+    gate->video = template_name[0] == 'v';
+    // 차단 probe를 먼저 달아야 seek 전 첫 버퍼가 gate에서 버려지지 않고 여기서 멈춤
+    gate->block_id = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        (GstPadProbeCallback)stream_block_probe, gate, NULL);
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+        (GstPadProbeCallback)stream_gate_probe, gate, g_free);
+    g_mutex_lock(&job->lock);
+    g_ptr_array_add(job->gates, gate);
+    g_mutex_unlock(&job->lock);
+}
+
+static void demux_no_more_pads_handler(GstElement* demux, ExtractJob* job) {
+    g_mutex_lock(&job->lock);
+    job->pads_ready = TRUE;
+    g_cond_signal(&job->cond);
+    g_mutex_unlock(&job->lock);
+}
+
+// 스레드 풀 작업: 클립 하나를 처음부터 끝까지 (버스는 이 스레드에서 직접 읽음)
+static void extract_job(ExtractJob* job, gpointer user_data) {
+    GstElement* pipeline = gst_pipeline_new(NULL);
+    GstElement* source = gst_element_factory_make("filesrc", NULL);
+    GstElement* demux = gst_element_factory_make("qtdemux", NULL);
+    GstElement* muxer = gst_element_factory_make("mp4mux", NULL);
+    GstElement* sink = gst_element_factory_make("filesink", NULL);
+    gint64 start_us = g_get_monotonic_time();
+    GstMessage* msg = NULL;
+    GstBus* bus = NULL;
+    GStatBuf st;
+    gboolean ready;
+    gboolean seeked;
+    guint i;
+
+    if (!pipeline || !source || !demux || !muxer || !sink) {
+        job->error = g_strdup("qtdemux/mp4mux elements are missing");
+        // 파이프라인에 넣지 못한 엘리먼트 해제
+        if (source) gst_object_unref(source);
+        if (demux) gst_object_unref(demux);
+        if (muxer) gst_object_unref(muxer);
+        if (sink) gst_object_unref(sink);
+        goto cleanup;
+    }
+    g_object_set(G_OBJECT(source), "location", job->input, NULL);
+    g_object_set(G_OBJECT(sink), "location", job->location, "sync", FALSE, "async", FALSE, NULL);
+    gst_bin_add_many(GST_BIN(pipeline), source, demux, muxer, sink, NULL);
+    if (!gst_element_link(source, demux) || !gst_element_link(muxer, sink)) {
+        job->error = g_strdup("elements could not be linked");
+        goto cleanup;
+    }
+    g_object_set_data(G_OBJECT(demux), "job", job);
+    g_signal_connect(demux, "pad-added", G_CALLBACK(demux_pad_added_handler), muxer);
+    g_signal_connect(demux, "no-more-pads", G_CALLBACK(demux_no_more_pads_handler), job);
+
+    // PAUSED: qtdemux가 moov를 읽고 패드를 만들 때까지 (패드는 첫 버퍼에서 막히므로 프리롤은 끝나지 않음)
+    bus = gst_element_get_bus(pipeline);
+    if (gst_element_set_state(pipeline, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE) {
+        job->error = g_strdup("could not open the input");
+        goto cleanup;
+    }
+    g_mutex_lock(&job->lock);
+    while (!job->pads_ready) {
+        msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR);
+        if (msg)
+            break;
+        g_cond_wait_until(&job->cond, &job->lock, g_get_monotonic_time() + 10 * G_TIME_SPAN_MILLISECOND);
+    }
+    ready = job->pads_ready;
+    g_mutex_unlock(&job->lock);
+    if (!ready)
+        goto finish;
+
+    // 키프레임 단위 seek: 시작 이전의 가장 가까운 키프레임부터 끝(segment stop)까지, 끝에서 디먹서가 EOS
+    seeked = gst_element_seek(demux, 1.0, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT | GST_SEEK_FLAG_SNAP_BEFORE,
+        GST_SEEK_TYPE_SET, (gint64)job->start, GST_SEEK_TYPE_SET, (gint64)job->end);
+    // seek 후의 버퍼만 흐르도록 차단 해제 (pads_ready 이후에는 gate가 추가되지 않음)
+    for (i = 0; i < job->gates->len; i++) {
+        StreamGate* gate = g_ptr_array_index(job->gates, i);
+
+        gst_pad_remove_probe(gate->pad, gate->block_id);
+    }
+    if (!seeked) {
+        job->error = g_strdup("seek failed");
+        goto cleanup;
+    }
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+finish:
+    if (msg && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+        GError* err;
+        gst_message_parse_error(msg, &err, NULL);
+        job->error = g_strdup_printf("%s: %s", GST_OBJECT_NAME(msg->src), err->message);
+        g_error_free(err);
+    }
+    job->ok = msg && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+
+cleanup:
+    if (msg)
+        gst_message_unref(msg);
+    if (bus)
+        gst_object_unref(bus);
+    if (pipeline) {
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+    }
+    job->elapsed_us = g_get_monotonic_time() - start_us;
+    if (job->ok && g_stat(job->location, &st) == 0)
+        job->bytes = st.st_size;
+    g_printerr("[%u] %s %s (%.1f ms)%s%s\n", job->index, job->ok ? "wrote" : "failed", job->location,
+        job->elapsed_us / 1000.0, job->error ? ": " : "", job->error ? job->error : "");
+}
+
+static int extract_main(int argc, char* argv[]) {
+    GOptionContext* context;
+    GError* error = NULL;
+    GPtrArray* jobs;
+    GThreadPool* pool;
+    GString* json;
+    gchar* escaped;
+    gchar* input = NULL;
+    gchar* list_path = NULL;
+    gchar* output_dir = NULL;
+    gint max_jobs = MIN(g_get_num_processors(), DEFAULT_MAX_JOBS);
+    gdouble media_sec = 0;
+    gint64 start_us;
+    gint64 total_bytes = 0;
+    guint failed = 0;
+    guint i;
+    GOptionEntry entries[] = {
+        { "input", 'i', 0, G_OPTION_ARG_FILENAME, &input, "Recorded MP4 to cut", "FILE" },
+        { "list", 'l', 0, G_OPTION_ARG_FILENAME, &list_path, "Time ranges, one 'START END [NAME]' per line", "FILE" },
+        { "output-dir", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir, "Directory for the clips (default: current directory)", "DIR" },
+        { "jobs", 'j', 0, G_OPTION_ARG_INT, &max_jobs, "Clips extracted at the same time", "N" },
+        { NULL }
+    };
+
+    context = g_option_context_new("- cut clips out of a recorded MP4 without re-encoding");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+    if (!input || !list_path || max_jobs <= 0) {
+        g_printerr("Usage: %s --input FILE --list FILE [--output-dir DIR] [--jobs N]\n", argv[0]);
+        return -1;
+    }
+
+    if (output_dir && g_mkdir_with_parents(output_dir, 0755) != 0) {
+        g_printerr("Could not create %s: %s\n", output_dir, g_strerror(errno));
+        return -1;
+    }
+    jobs = load_ranges(list_path, input, output_dir ? output_dir : ".", &error);
+    if (!jobs) {
+        g_printerr("Could not load %s: %s\n", list_path, error->message);
+        g_error_free(error);
+        return -1;
+    }
+
+    start_us = g_get_monotonic_time();
+    pool = g_thread_pool_new((GFunc)extract_job, NULL, max_jobs, TRUE, NULL);
+    for (i = 0; i < jobs->len; i++)
+        g_thread_pool_push(pool, g_ptr_array_index(jobs, i), NULL);
+    // 남은 작업을 모두 끝낸 뒤 반환
+    g_thread_pool_free(pool, FALSE, TRUE);
+
+    json = g_string_new(NULL);
+    escaped = g_strescape(input, NULL);
+    g_string_append_printf(json, "{\"input\":\"%s\",\"jobs\":%d,\"clips\":[", escaped, max_jobs);
+    g_free(escaped);
+    for (i = 0; i < jobs->len; i++) {
+        ExtractJob* job = g_ptr_array_index(jobs, i);
+
+        escaped = g_strescape(job->location, NULL);
+
+        g_string_append_printf(json,
+            "%s{\"index\":%u,\"file\":\"%s\",\"start_s\":%.3f,\"end_s\":%.3f,\"keyframe_start_s\":%.3f,\"bytes\":%" G_GINT64_FORMAT ",\"ms\":%.1f,\"ok\":%s}",
+            i > 0 ? "," : "", job->index, escaped, (gdouble)job->start / GST_SECOND, (gdouble)job->end / GST_SECOND,
+            GST_CLOCK_TIME_IS_VALID(job->keyframe_start) ? (gdouble)job->keyframe_start / GST_SECOND : -1.0,
+            job->bytes, job->elapsed_us / 1000.0, job->ok ? "true" : "false");
+        g_free(escaped);
+        media_sec += (gdouble)(job->end - job->start) / GST_SECOND;
+        total_bytes += job->bytes;
+        if (!job->ok)
+            failed++;
+    }
+    // 실시간 대비 속도: 잘라낸 영상 길이 / 걸린 시간
+    g_string_append_printf(json, "],\"wall_s\":%.3f,\"media_s\":%.3f,\"realtime_factor\":%.1f,\"bytes\":%" G_GINT64_FORMAT ",\"failed\":%u}\n",
+        (g_get_monotonic_time() - start_us) / 1e6, media_sec,
+        media_sec * 1e6 / MAX(g_get_monotonic_time() - start_us, 1), total_bytes, failed);
+    fputs(json->str, stdout);
+
+    g_string_free(json, TRUE);
+    g_ptr_array_free(jobs, TRUE);
+    g_free(input);
+    g_free(list_path);
+    g_free(output_dir);
+    return failed == 0 ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+#if defined(__APPLE__) && TARGET_OS_MAC && !TARGET_OS_IPHONE
+    return gst_macos_main((GstMainFunc)extract_main, argc, argv, NULL);
+#else
+    return extract_main(argc, argv);
+#endif
+}
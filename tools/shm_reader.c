@@ -0,0 +1,400 @@
+#include <gst/gst.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "shmout.h"
+
+#ifdef __APPLE__
+#include <TargetConditionals.h>
+#endif
+
+// 클리퍼의 공유 메모리 브랜치(--shm-dir)에서 프레임을 읽어 처리량과 프레임 간격을 JSON으로 출력.
+//   shm_reader --socket /run/clipper/shm-cam0.sock --readers 2 --seconds 10
+//   shm_reader --self-test --readers 3 --slow-ms 200
+// 읽기 프로세스는 shmsrc → capsfilter(<소켓>.caps) → fakesink. 연결이 끊기면(클리퍼 재시작, 느려서 끊김) 다시 붙는다.
+// --self-test는 같은 프로세스에서 videotestsrc → 클리퍼와 같은 leaky 큐 → shmsink(ShmOutput)를 띄우고
+// 프레임 앞 8바이트에 쓰기 시각을 적어 읽기까지의 지연도 잰다. --slow-ms를 주면 0번 읽기 프로세스가 프레임마다
+// 그만큼 붙잡고 있어서 영역이 가득 차고, 나머지 읽기 프로세스가 계속 프레임을 받는지(느린 쪽이 끊기는지) 확인한다.
+
+#define DEFAULT_SECONDS 10
+#define DEFAULT_READERS 1
+#define DEFAULT_WIDTH 1280
+#define DEFAULT_HEIGHT 720
+#define DEFAULT_FPS 30
+#define DEFAULT_SHM_FRAMES 4
+#define DEFAULT_READER_TIMEOUT_MS 1000
+#define RECONNECT_DELAY_MS 100
+#define CHECK_INTERVAL_MS 250
+// 느리지 않은 읽기 프로세스가 받아야 하는 프레임 비율 (--self-test 통과 기준)
+#define MIN_DELIVERED_RATIO 0.5
+
+typedef struct _ShmReader {
+    guint index;
+    const gchar* socket_path;
+    guint slow_ms;                  // 프레임마다 붙잡고 있는 시간
+    gboolean stamped;               // 프레임 앞 8바이트가 쓰기 시각 (--self-test)
+    GstElement* pipeline;
+    guint bus_watch_id;
+    guint restart_id;
+    guint connects;
+
+    // 스트리밍 스레드 (파이프라인은 한 번에 하나, 결과는 멈춘 뒤에 읽음)
+    guint64 frames;
+    guint64 bytes;
+    gint64 last_us;
+    GArray* gaps_ms;                // gdouble
+    GArray* latencies_ms;           // gdouble
+} ShmReader;
+
+typedef struct _SelfTestWriter {
+    GstElement* pipeline;
+    ShmOutput* shm;
+    guint check_id;
+} SelfTestWriter;
+
+static gboolean reader_start(ShmReader* reader);
+
+static GstPadProbeReturn reader_probe(GstPad* pad, GstPadProbeInfo* info, ShmReader* reader) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    gint64 now = g_get_monotonic_time();
+    gint64 stamp = 0;
+
+    if (reader->last_us > 0) {
+        gdouble gap = (now - reader->last_us) / 1000.0;
+        g_array_append_val(reader->gaps_ms, gap);
+    }
+    reader->last_us = now;
+    reader->frames++;
+    reader->bytes += gst_buffer_get_size(buffer);
+    if (reader->stamped && gst_buffer_extract(buffer, 0, &stamp, sizeof(stamp)) == sizeof(stamp) && stamp > 0 && stamp <= now) {
+        gdouble latency = (now - stamp) / 1000.0;
+        g_array_append_val(reader->latencies_ms, latency);
+    }
+    // 버퍼를 잡고 있는 동안 쓰는 쪽은 그 영역을 다시 쓸 수 없음
+    if (reader->slow_ms > 0)
+        g_usleep(reader->slow_ms * 1000);
+    return GST_PAD_PROBE_OK;
+}
+
+static void reader_stop(ShmReader* reader) {
+    if (reader->bus_watch_id) {
+        g_source_remove(reader->bus_watch_id);
+        reader->bus_watch_id = 0;
+    }
+    if (reader->pipeline) {
+        gst_element_set_state(reader->pipeline, GST_STATE_NULL);
+        gst_object_unref(reader->pipeline);
+        reader->pipeline = NULL;
+    }
+}
+
+static void reader_schedule_restart(ShmReader* reader) {
+    if (!reader->restart_id)
+        reader->restart_id = g_timeout_add(RECONNECT_DELAY_MS, (GSourceFunc)reader_start, reader);
+}
+
+static gboolean reader_bus_call(GstBus* bus, GstMessage* msg, ShmReader* reader) {
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+        GError* err;
+
+        gst_message_parse_error(msg, &err, NULL);
+        g_printerr("Reader %u: %s (reconnecting)\n", reader->index, err->message);
+        g_error_free(err);
+    }
+    else if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_EOS) {
+        return G_SOURCE_CONTINUE;
+    }
+    // 이 watch는 reader_stop에서 지우지 않고 여기서 끝냄
+    reader->bus_watch_id = 0;
+    reader_stop(reader);
+    reader_schedule_restart(reader);
+    return G_SOURCE_REMOVE;
+}
+
+// <소켓>.caps가 생길 때까지(쓰는 쪽이 첫 caps를 받을 때까지) 다시 시도
+static gboolean reader_start(ShmReader* reader) {
+    gchar* caps_path = g_strconcat(reader->socket_path, ".caps", NULL);
+    gchar* caps_string = NULL;
+    GstElement* source;
+    GstElement* filter;
+    GstElement* sink;
+    GstCaps* caps;
+    GstBus* bus;
+    GstPad* sink_pad;
+
+    reader->restart_id = 0;
+    if (!g_file_get_contents(caps_path, &caps_string, NULL, NULL) || !(caps = gst_caps_from_string(g_strstrip(caps_string)))) {
+        g_free(caps_string);
+        g_free(caps_path);
+        reader_schedule_restart(reader);
+        return G_SOURCE_REMOVE;
+    }
+    g_free(caps_string);
+    g_free(caps_path);
+
+    source = gst_element_factory_make("shmsrc", NULL);
+    filter = gst_element_factory_make("capsfilter", NULL);
+    sink = gst_element_factory_make("fakesink", NULL);
+    if (!source || !filter || !sink) {
+        g_printerr("shmsrc, capsfilter or fakesink could not be created. Check GStreamer plugin installations (e.g., -base, -bad).\n");
+        gst_caps_unref(caps);
+        return G_SOURCE_REMOVE;
+    }
+    reader->pipeline = gst_pipeline_new(NULL);
+    g_object_set(G_OBJECT(source), "socket-path", reader->socket_path, "is-live", TRUE, NULL);
+    g_object_set(G_OBJECT(filter), "caps", caps, NULL);
+    g_object_set(G_OBJECT(sink), "sync", FALSE, NULL);
+    gst_caps_unref(caps);
+    gst_bin_add_many(GST_BIN(reader->pipeline), source, filter, sink, NULL);
+    gst_element_link_many(source, filter, sink, NULL);
+    sink_pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)reader_probe, reader, NULL);
+    gst_object_unref(sink_pad);
+
+    bus = gst_pipeline_get_bus(GST_PIPELINE(reader->pipeline));
+    reader->bus_watch_id = gst_bus_add_watch(bus, (GstBusFunc)reader_bus_call, reader);
+    gst_object_unref(bus);
+    // 소켓이 아직 없으면 shmsrc가 시작하지 못함
+    if (gst_element_set_state(reader->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        reader_stop(reader);
+        reader_schedule_restart(reader);
+        return G_SOURCE_REMOVE;
+    }
+    reader->connects++;
+    return G_SOURCE_REMOVE;
+}
+
+// 프레임 앞 8바이트에 shmsink로 들어가는 시각을 적음 (같은 프로세스의 읽기 쪽이 지연 계산)
+static GstPadProbeReturn stamp_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    GstBuffer* buffer = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+    gint64 now = g_get_monotonic_time();
+
+    gst_buffer_fill(buffer, 0, &now, sizeof(now));
+    GST_PAD_PROBE_INFO_DATA(info) = buffer;
+    return GST_PAD_PROBE_OK;
+}
+
+static gboolean writer_check_timeout(SelfTestWriter* writer) {
+    shm_output_check(writer->shm);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean writer_start(SelfTestWriter* writer, const gchar* socket_path, gint width, gint height, gint fps,
+    guint shm_frames, GstClockTime reader_timeout) {
+    gchar* description = g_strdup_printf(
+        "videotestsrc is-live=true pattern=ball ! video/x-raw,format=I420,width=%d,height=%d,framerate=%d/1 ! "
+        "queue name=queue leaky=downstream max-size-buffers=2 max-size-bytes=0 max-size-time=0 ! "
+        "shmsink name=sink wait-for-connection=false sync=false async=false",
+        width, height, fps);
+    GError* error = NULL;
+    GstElement* queue;
+    GstElement* sink;
+    GstPad* sink_pad;
+
+    writer->pipeline = gst_parse_launch(description, &error);
+    g_free(description);
+    if (!writer->pipeline) {
+        g_printerr("Could not build the writer pipeline: %s\n", error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    queue = gst_bin_get_by_name(GST_BIN(writer->pipeline), "queue");
+    sink = gst_bin_get_by_name(GST_BIN(writer->pipeline), "sink");
+    sink_pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, stamp_probe, NULL, NULL);
+    gst_object_unref(sink_pad);
+    writer->shm = shm_output_new(shm_frames, reader_timeout);
+    shm_output_attach(writer->shm, queue, sink);
+    shm_output_set_path(writer->shm, socket_path);
+    gst_object_unref(queue);
+    gst_object_unref(sink);
+    if (gst_element_set_state(writer->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        g_printerr("Unable to start the writer pipeline.\n");
+        return FALSE;
+    }
+    writer->check_id = g_timeout_add(CHECK_INTERVAL_MS, (GSourceFunc)writer_check_timeout, writer);
+    return TRUE;
+}
+
+static void writer_stop(SelfTestWriter* writer) {
+    if (writer->check_id)
+        g_source_remove(writer->check_id);
+    if (writer->pipeline) {
+        gst_element_set_state(writer->pipeline, GST_STATE_NULL);
+        gst_object_unref(writer->pipeline);
+    }
+    shm_output_free(writer->shm);
+}
+
+static gint compare_double(gconstpointer a, gconstpointer b) {
+    gdouble x = *(const gdouble*)a;
+    gdouble y = *(const gdouble*)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// 정렬된 값의 p 분위수 (0~1)
+static gdouble percentile(GArray* sorted, gdouble p) {
+    if (sorted->len == 0)
+        return 0.0;
+    return g_array_index(sorted, gdouble, MIN((guint)(p * sorted->len), sorted->len - 1));
+}
+
+static void append_distribution(GString* json, const gchar* name, GArray* values) {
+    g_array_sort(values, compare_double);
+    g_string_append_printf(json, ",\"%s_p50_ms\":%.3f,\"%s_p99_ms\":%.3f,\"%s_max_ms\":%.3f",
+        name, percentile(values, 0.5), name, percentile(values, 0.99), name, percentile(values, 1.0));
+}
+
+static gboolean quit_timeout(GMainLoop* loop) {
+    g_main_loop_quit(loop);
+    return G_SOURCE_REMOVE;
+}
+
+static int reader_main(int argc, char* argv[]) {
+    GOptionContext* context;
+    GError* error = NULL;
+    GMainLoop* loop;
+    GString* json;
+    SelfTestWriter writer;
+    ShmReader* readers;
+    gchar* socket_option = NULL;
+    gchar* socket_path;
+    gboolean self_test = FALSE;
+    gint n_readers = DEFAULT_READERS;
+    gint seconds = DEFAULT_SECONDS;
+    gint slow_ms = 0;
+    gint width = DEFAULT_WIDTH;
+    gint height = DEFAULT_HEIGHT;
+    gint fps = DEFAULT_FPS;
+    gint shm_frames = DEFAULT_SHM_FRAMES;
+    gint reader_timeout_ms = DEFAULT_READER_TIMEOUT_MS;
+    gint64 start_us, elapsed_us;
+    gboolean ok = TRUE;
+    guint i;
+    GOptionEntry entries[] = {
+        { "socket", 's', 0, G_OPTION_ARG_FILENAME, &socket_option, "shmsink socket of the clipper (--shm-dir DIR/shm-<camera>.sock)", "PATH" },
+        { "readers", 'n', 0, G_OPTION_ARG_INT, &n_readers, "Attach N readers at once", "N" },
+        { "seconds", 'd', 0, G_OPTION_ARG_INT, &seconds, "Read for SEC seconds", "SEC" },
+        { "self-test", 0, 0, G_OPTION_ARG_NONE, &self_test, "Run an in-process videotestsrc writer and measure write-to-read latency", NULL },
+        { "slow-ms", 0, 0, G_OPTION_ARG_INT, &slow_ms, "Reader 0 holds every frame for MS ms (slow reader)", "MS" },
+        { "width", 0, 0, G_OPTION_ARG_INT, &width, "Self-test frame width", "PIXELS" },
+        { "height", 0, 0, G_OPTION_ARG_INT, &height, "Self-test frame height", "PIXELS" },
+        { "fps", 0, 0, G_OPTION_ARG_INT, &fps, "Self-test frame rate", "FPS" },
+        { "shm-frames", 0, 0, G_OPTION_ARG_INT, &shm_frames, "Self-test frames held in the shared memory area", "N" },
+        { "reader-timeout", 0, 0, G_OPTION_ARG_INT, &reader_timeout_ms, "Self-test: disconnect readers after N ms without a published frame (0 = never)", "MS" },
+        { NULL }
+    };
+
+    context = g_option_context_new("- shared memory frame reader");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("Failed to parse options: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return -1;
+    }
+    g_option_context_free(context);
+    if (!self_test && !socket_option) {
+        g_printerr("Either --socket or --self-test is required.\n");
+        return -1;
+    }
+    if (n_readers <= 0 || seconds <= 0 || slow_ms < 0 || width <= 0 || height <= 0 || fps <= 0 ||
+        shm_frames <= 0 || reader_timeout_ms < 0) {
+        g_printerr("Reader count, duration and frame settings must be positive.\n");
+        g_free(socket_option);
+        return -1;
+    }
+
+    if (self_test) {
+        gchar* file_name = g_strdup_printf("shm_reader-%d.sock", (gint)getpid());
+
+        socket_path = g_build_filename(g_get_tmp_dir(), file_name, NULL);
+        g_free(file_name);
+    }
+    else {
+        socket_path = g_strdup(socket_option);
+    }
+    loop = g_main_loop_new(NULL, FALSE);
+    memset(&writer, 0, sizeof(writer));
+    readers = g_new0(ShmReader, n_readers);
+    for (i = 0; i < (guint)n_readers; i++) {
+        readers[i].index = i;
+        readers[i].socket_path = socket_path;
+        readers[i].slow_ms = i == 0 ? (guint)slow_ms : 0;
+        readers[i].stamped = self_test;
+        readers[i].gaps_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+        readers[i].latencies_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    }
+
+    if (self_test && !writer_start(&writer, socket_path, width, height, fps, (guint)shm_frames,
+        (GstClockTime)reader_timeout_ms * GST_MSECOND)) {
+        ok = FALSE;
+        goto cleanup;
+    }
+    start_us = g_get_monotonic_time();
+    for (i = 0; i < (guint)n_readers; i++)
+        reader_start(&readers[i]);
+    g_timeout_add_seconds((guint)seconds, (GSourceFunc)quit_timeout, loop);
+    g_main_loop_run(loop);
+    for (i = 0; i < (guint)n_readers; i++) {
+        if (readers[i].restart_id)
+            g_source_remove(readers[i].restart_id);
+        reader_stop(&readers[i]);
+    }
+    elapsed_us = g_get_monotonic_time() - start_us;
+
+    json = g_string_new(NULL);
+    g_string_append_printf(json, "{\"benchmark\":\"shm\",\"mode\":\"%s\",\"seconds\":%.3f",
+        self_test ? "self-test" : "attach", elapsed_us / 1e6);
+    if (self_test) {
+        g_string_append_printf(json, ",\"fps\":%d,\"writer\":", fps);
+        shm_output_append_json(writer.shm, json);
+    }
+    g_string_append(json, ",\"readers\":[");
+    for (i = 0; i < (guint)n_readers; i++) {
+        ShmReader* reader = &readers[i];
+        gdouble reader_fps = reader->frames * 1e6 / elapsed_us;
+        // 느린 읽기 프로세스 말고는 원본 프레임레이트의 절반 이상을 받아야 함
+        gboolean pass = !self_test || reader->slow_ms > 0 || reader_fps >= fps * MIN_DELIVERED_RATIO;
+
+        g_string_append_printf(json,
+            "%s{\"reader\":%u,\"slow_ms\":%u,\"connects\":%u,\"frames\":%" G_GUINT64_FORMAT ",\"fps\":%.2f,\"mb_per_sec\":%.2f",
+            i > 0 ? "," : "", reader->index, reader->slow_ms, reader->connects, reader->frames, reader_fps,
+            reader->bytes / (1024.0 * 1024.0) * 1e6 / elapsed_us);
+        append_distribution(json, "gap", reader->gaps_ms);
+        if (self_test)
+            append_distribution(json, "latency", reader->latencies_ms);
+        g_string_append_printf(json, ",\"pass\":%s}", pass ? "true" : "false");
+        if (!pass) {
+            g_printerr("Reader %u received %.1f fps of %d.\n", reader->index, reader_fps, fps);
+            ok = FALSE;
+        }
+    }
+    g_string_append(json, "]}\n");
+    fputs(json->str, stdout);
+    g_string_free(json, TRUE);
+
+cleanup:
+    writer_stop(&writer);
+    for (i = 0; i < (guint)n_readers; i++) {
+        g_array_free(readers[i].gaps_ms, TRUE);
+        g_array_free(readers[i].latencies_ms, TRUE);
+    }
+    g_free(readers);
+    g_main_loop_unref(loop);
+    g_free(socket_path);
+    g_free(socket_option);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+#if defined(__APPLE__) && TARGET_OS_MAC && !TARGET_OS_IPHONE
+    return gst_macos_main((GstMainFunc)reader_main, argc, argv, NULL);
+#else
+    return reader_main(argc, argv);
+#endif
+}